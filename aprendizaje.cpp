@@ -0,0 +1,333 @@
+#include "aprendizaje.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "util.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// lee un CSV con cabecera; las celdas vacías quedan como no observadas (-1)
+DatosDiscretos DatosDiscretos::cargar_csv(const std::string& ruta){
+    std::ifstream in(ruta);
+    if(!in)
+        throw std::runtime_error("No se puede abrir datos: "+ruta);
+
+    // a diferencia de dividir(), aquí conservamos los campos vacíos porque
+    // su posición indica qué variable no fue observada
+    auto campos = [](const std::string& s){
+        std::vector<std::string> res; std::string cur;
+        for(char c: s){ if(c==','){ res.push_back(recortar(cur)); cur.clear(); } else cur.push_back(c); }
+        res.push_back(recortar(cur));
+        return res;
+    };
+
+    DatosDiscretos d;
+    std::string linea;
+    int ln=0;
+    // buscamos la cabecera (primera línea no vacía ni comentada)
+    while(std::getline(in, linea)){
+        ++ln;
+        linea = recortar(linea);
+        if(linea.empty()||linea[0]=='#') continue;
+        d.variables = campos(linea);
+        break;
+    }
+    if(d.variables.empty())
+        throw std::runtime_error("CSV sin cabecera: "+ruta);
+    // dos columnas con el mismo nombre acabarían en el mismo nodo
+    std::unordered_set<std::string> nombres;
+    for(const auto& v: d.variables)
+        if(!nombres.insert(v).second)
+            throw std::runtime_error("Columna repetida en la cabecera de "+ruta+": "+v);
+
+    const size_t n = d.variables.size();
+    d.dominios.resize(n);
+    // índice valor -> código por columna, para codificar en una sola pasada
+    std::vector<std::unordered_map<std::string,int>> codigos(n);
+
+    while(std::getline(in, linea)){
+        ++ln;
+        std::string t = recortar(linea);
+        if(t.empty()||t[0]=='#') continue;
+        auto f = campos(t);
+        if(f.size()!=n)
+            throw std::runtime_error("Número de columnas inválido en línea "+std::to_string(ln));
+        for(size_t j=0;j<n;++j){
+            if(f[j].empty()){ d.celdas.push_back(-1); continue; }
+            auto it = codigos[j].find(f[j]);
+            if(it==codigos[j].end()){
+                it = codigos[j].emplace(f[j], (int)d.dominios[j].size()).first;
+                d.dominios[j].push_back(f[j]);
+            }
+            d.celdas.push_back(it->second);
+        }
+        ++d.filas;
+    }
+    return d;
+}
+
+std::vector<size_t> DatosDiscretos::filas_completas() const{
+    std::vector<size_t> r;
+    for(size_t f=0; f<filas; ++f){
+        bool completa = true;
+        for(size_t j=0; j<variables.size() && completa; ++j) completa = celda(f, j)>=0;
+        if(completa) r.push_back(f);
+    }
+    return r;
+}
+
+namespace {
+
+// clave de la caché de puntajes locales: nodo + conjunto ordenado de padres
+struct ClaveFamilia{
+    int nodo;
+    std::vector<int> padres;
+    bool operator==(const ClaveFamilia& o) const { return nodo==o.nodo && padres==o.padres; }
+};
+
+struct HashFamilia{
+    size_t operator()(const ClaveFamilia& k) const{
+        size_t h = std::hash<int>()(k.nodo);
+        for(int p: k.padres) h = h*1000003u ^ std::hash<int>()(p);
+        return h;
+    }
+};
+
+// puntaje descomponible de una familia (nodo, padres) calculado a partir
+// de los conteos N_jk sobre las filas `filas`; solo lee, así que es
+// seguro entre hilos
+double puntaje_local(const DatosDiscretos& datos, const std::vector<size_t>& filas,
+                     const OpcionesAprendizaje& op, const ClaveFamilia& fam){
+    const int v = fam.nodo;
+    const size_t r = std::max<size_t>(1, datos.dominios[v].size());
+    size_t q = 1;
+    for(int p: fam.padres) q *= std::max<size_t>(1, datos.dominios[p].size());
+
+    // conteos densos: fila j = combinación de padres, columna k = valor del nodo
+    std::vector<double> n_jk(q*r, 0.0);
+    double n_total = 0;
+    for(size_t f: filas){
+        int x = datos.celda(f, v);
+        size_t j=0;
+        for(int p: fam.padres) j = j*datos.dominios[p].size() + (size_t)datos.celda(f, p);
+        n_jk[j*r + (size_t)x] += 1.0;
+        n_total += 1.0;
+    }
+
+    double s = 0.0;
+    if(op.puntaje==Puntaje::BIC){
+        for(size_t j=0;j<q;++j){
+            double n_j=0; for(size_t k=0;k<r;++k) n_j += n_jk[j*r+k];
+            if(n_j==0) continue;
+            for(size_t k=0;k<r;++k){
+                double n = n_jk[j*r+k];
+                if(n>0) s += n*std::log(n/n_j);
+            }
+        }
+        // penalización por número de parámetros libres
+        if(n_total>0) s -= 0.5*std::log(n_total)*(double)(q*(r-1));
+    }else{
+        // BDeu: prior Dirichlet uniforme con tamaño de muestra equivalente `ess`
+        const double a_j = op.ess/(double)q;
+        const double a_jk = op.ess/(double)(q*r);
+        for(size_t j=0;j<q;++j){
+            double n_j=0; for(size_t k=0;k<r;++k) n_j += n_jk[j*r+k];
+            s += std::lgamma(a_j) - std::lgamma(a_j+n_j);
+            for(size_t k=0;k<r;++k)
+                s += std::lgamma(a_jk+n_jk[j*r+k]) - std::lgamma(a_jk);
+        }
+    }
+    return s;
+}
+
+// ¿existe un camino dirigido desde la columna `desde` hasta `hasta`
+// siguiendo Nodo::hijos? El arco (ign_u -> ign_v) se ignora, lo que
+// permite comprobar la inversión de un arco sin modificar el grafo.
+// La pila y las marcas se conservan entre llamadas y cada búsqueda usa
+// una época nueva en vez de limpiar las marcas: pasada la primera
+// comprobación no se reserva memoria.
+class Alcance{
+public:
+    Alcance(const std::vector<Nodo*>& nodos, const std::vector<int>& columna)
+        : nodos_(nodos), columna_(columna), marca_(nodos.size(), 0) {}
+
+    bool operator()(int desde, int hasta, int ign_u = -1, int ign_v = -1){
+        if(++epoca_==0){ std::fill(marca_.begin(), marca_.end(), 0u); epoca_ = 1; }
+        pila_.clear();
+        pila_.push_back(desde);
+        marca_[desde] = epoca_;
+        while(!pila_.empty()){
+            int x = pila_.back(); pila_.pop_back();
+            if(x==hasta) return true;
+            for(Nodo* hn: nodos_[x]->hijos){
+                int h = columna_[hn->id];
+                if(x==ign_u && h==ign_v) continue;
+                if(marca_[h]!=epoca_){ marca_[h] = epoca_; pila_.push_back(h); }
+            }
+        }
+        return false;
+    }
+
+private:
+    const std::vector<Nodo*>& nodos_;
+    const std::vector<int>& columna_;
+    std::vector<unsigned> marca_;
+    std::vector<int> pila_;
+    unsigned epoca_ = 0;
+};
+
+struct Movimiento{
+    enum Tipo{ Anadir, Quitar, Invertir } tipo;
+    int u, v;               // arco u -> v afectado
+    ClaveFamilia fam_v;     // nueva familia de v
+    ClaveFamilia fam_u;     // nueva familia de u (solo Invertir)
+};
+
+} // namespace
+
+double aprender_estructura(const DatosDiscretos& datos, RedBayesiana& red,
+                           const OpcionesAprendizaje& op){
+    const int n = (int)datos.variables.size();
+    // todas las familias se puntúan sobre las mismas filas (las que no
+    // tienen celdas vacías): si cada una usara las suyas, los puntajes
+    // que compara la búsqueda vendrían de muestras de tamaño distinto
+    const std::vector<size_t> filas = datos.filas_completas();
+    if(filas.empty())
+        throw std::runtime_error("Ninguna fila de los datos tiene todas las columnas observadas");
+
+    // un nodo por columna, con el dominio observado en los datos
+    std::vector<Nodo*> nodos(n);
+    for(int i=0;i<n;++i){
+        nodos[i] = red.obtener_o_crear(datos.variables[i]);
+        nodos[i]->valores = datos.dominios[i];
+        nodos[i]->padres.clear();
+        nodos[i]->hijos.clear();
+    }
+    // el análisis del grafo sin arcos numera los nodos (Nodo::id); la
+    // búsqueda no vuelve a pedirlo, así que los ids no cambian hasta el final
+    red.invalidar_grafo();
+    red.grafo();
+    std::vector<int> columna(red.nodos.size(), -1);
+    for(int i=0;i<n;++i) columna[nodos[i]->id] = i;
+
+    // padres ordenados por índice: forma canónica de la clave de caché
+    auto familia = [&](int v){
+        ClaveFamilia k{v, {}};
+        for(Nodo* p: nodos[v]->padres) k.padres.push_back(columna[p->id]);
+        std::sort(k.padres.begin(), k.padres.end());
+        return k;
+    };
+    auto sin = [](ClaveFamilia k, int p){
+        k.padres.erase(std::find(k.padres.begin(), k.padres.end(), p));
+        return k;
+    };
+    auto con = [](ClaveFamilia k, int p){
+        k.padres.insert(std::lower_bound(k.padres.begin(), k.padres.end(), p), p);
+        return k;
+    };
+
+    // caché de puntajes locales: un movimiento solo cambia una o dos
+    // familias, así que el resto de puntajes se reutiliza entre iteraciones
+    std::unordered_map<ClaveFamilia,double,HashFamilia> cache;
+    unsigned hilos = op.hilos ? op.hilos : std::max(1u, std::thread::hardware_concurrency());
+
+    // calcula en paralelo los puntajes de las familias que aún no están en caché
+    auto completar_cache = [&](const std::vector<ClaveFamilia>& pedidas){
+        std::vector<ClaveFamilia> faltan;
+        std::unordered_set<ClaveFamilia,HashFamilia> vistas;
+        for(const auto& k: pedidas)
+            if(!cache.count(k) && vistas.insert(k).second)
+                faltan.push_back(k);
+        std::vector<double> res(faltan.size());
+        unsigned nh = (unsigned)std::min<size_t>(hilos, faltan.size());
+        auto trabajo = [&](size_t t){
+            for(size_t i=t;i<faltan.size();i+=nh)
+                res[i] = puntaje_local(datos, filas, op, faltan[i]);
+        };
+        if(nh<=1){
+            // con un solo hilo (o una sola familia) no compensa lanzar hilos
+            if(!faltan.empty()) trabajo(0);
+        }else{
+            std::vector<std::thread> ts;
+            for(unsigned t=0;t<nh;++t) ts.emplace_back(trabajo, t);
+            for(auto& th: ts) th.join();
+        }
+        for(size_t i=0;i<faltan.size();++i) cache[faltan[i]] = res[i];
+    };
+
+    std::vector<ClaveFamilia> actuales(n);
+    for(int v=0;v<n;++v) actuales[v] = familia(v);
+    Alcance alcanza(nodos, columna);
+    completar_cache(actuales);
+
+    for(size_t iter=0; iter<op.max_iter; ++iter){
+        // generamos todos los movimientos legales (sin ciclos, respetando max_padres)
+        std::vector<Movimiento> movs;
+        for(int u=0;u<n;++u) for(int v=0;v<n;++v){
+            if(u==v) continue;
+            const auto& pv = actuales[v].padres;
+            bool existe = std::binary_search(pv.begin(), pv.end(), u);
+            if(existe){
+                movs.push_back({Movimiento::Quitar, u, v, sin(actuales[v],u), {}});
+                if(actuales[u].padres.size()<op.max_padres && !alcanza(u, v, u, v))
+                    movs.push_back({Movimiento::Invertir, u, v, sin(actuales[v],u), con(actuales[u],v)});
+            }else{
+                const auto& pu = actuales[u].padres;
+                // si v -> u existe, esa pareja se trata como inversión de v -> u
+                if(std::binary_search(pu.begin(), pu.end(), v)) continue;
+                if(pv.size()<op.max_padres && !alcanza(v, u))
+                    movs.push_back({Movimiento::Anadir, u, v, con(actuales[v],u), {}});
+            }
+        }
+
+        std::vector<ClaveFamilia> pedidas;
+        for(const auto& m: movs){
+            pedidas.push_back(m.fam_v);
+            if(m.tipo==Movimiento::Invertir) pedidas.push_back(m.fam_u);
+        }
+        completar_cache(pedidas);
+
+        // el mejor movimiento es el de mayor mejora del puntaje total
+        const Movimiento* mejor = nullptr;
+        double mejor_delta = 1e-9;
+        for(const auto& m: movs){
+            double delta = cache[m.fam_v] - cache[actuales[m.v]];
+            if(m.tipo==Movimiento::Invertir) delta += cache[m.fam_u] - cache[actuales[m.u]];
+            if(delta>mejor_delta){ mejor_delta=delta; mejor=&m; }
+        }
+        if(!mejor) break; // óptimo local
+
+        Nodo* u = nodos[mejor->u]; Nodo* v = nodos[mejor->v];
+        switch(mejor->tipo){
+            case Movimiento::Anadir:   red.agregar_arco(u,v); break;
+            case Movimiento::Quitar:   red.quitar_arco(u,v); break;
+            case Movimiento::Invertir: red.quitar_arco(u,v); red.agregar_arco(v,u); break;
+        }
+        actuales[mejor->v] = mejor->fam_v;
+        if(mejor->tipo==Movimiento::Invertir) actuales[mejor->u] = mejor->fam_u;
+    }
+
+    double total = 0;
+    for(int v=0;v<n;++v) total += cache[actuales[v]];
+    return total;
+}
+
+void escribir_estructura(const RedBayesiana& red, std::ostream& os){
+    // ordenamos por nombre para que la salida sea reproducible
+    std::vector<Nodo*> nodos;
+    for(const auto& kv: red.nodos) nodos.push_back(kv.second.get());
+    std::sort(nodos.begin(), nodos.end(), [](Nodo* a, Nodo* b){ return a->nombre<b->nombre; });
+
+    os << "# A -> B (A es padre de B)\n";
+    for(Nodo* v: nodos)
+        for(Nodo* p: v->padres)
+            os << p->nombre << " -> " << v->nombre << "\n";
+    // el formato solo describe arcos: dejamos constancia de los nodos aislados
+    for(Nodo* v: nodos)
+        if(v->padres.empty() && v->hijos.empty())
+            os << "# aislado: " << v->nombre << "\n";
+}
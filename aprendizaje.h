@@ -0,0 +1,48 @@
+#ifndef APRENDIZAJE_H
+#define APRENDIZAJE_H
+#include <string>
+#include <vector>
+#include <ostream>
+
+struct RedBayesiana;
+
+// Conjunto de datos discreto leído de un CSV: la cabecera da los nombres
+// de las variables (sin repetir) y cada fila los valores observados. Las
+// celdas vacías se consideran no observadas (-1). Los valores se
+// codifican como índices al dominio de cada columna, en orden de aparición.
+struct DatosDiscretos{
+    std::vector<std::string> variables;
+    std::vector<std::vector<std::string>> dominios; // dominio de cada columna
+    std::vector<int> celdas;                        // fila-mayor: filas x variables
+    size_t filas = 0;
+
+    int celda(size_t fila, size_t var) const { return celdas[fila*variables.size()+var]; }
+    // filas sin ninguna celda vacía
+    std::vector<size_t> filas_completas() const;
+
+    static DatosDiscretos cargar_csv(const std::string& ruta);
+};
+
+enum class Puntaje{ BIC, BDeu };
+
+struct OpcionesAprendizaje{
+    Puntaje puntaje = Puntaje::BIC;
+    double ess = 1.0;        // tamaño de muestra equivalente para BDeu
+    size_t max_padres = 3;   // cota de padres por nodo
+    size_t max_iter = 10000; // cota de movimientos aplicados
+    unsigned hilos = 0;      // 0 = std::thread::hardware_concurrency()
+};
+
+// Búsqueda local (hill climbing) sobre DAGs con movimientos de añadir,
+// quitar e invertir arcos. Los arcos se guardan directamente en
+// Nodo::padres / Nodo::hijos de `red`, que se crea con un nodo por
+// columna de `datos`. Todas las familias se puntúan sobre las filas
+// completas (casos completos); lanza si no hay ninguna. Devuelve el
+// puntaje total de la estructura final.
+double aprender_estructura(const DatosDiscretos& datos, RedBayesiana& red,
+                           const OpcionesAprendizaje& op = OpcionesAprendizaje());
+
+// Escribe los arcos de `red` en el formato de estructura.txt ("A -> B").
+void escribir_estructura(const RedBayesiana& red, std::ostream& os);
+
+#endif // APRENDIZAJE_H
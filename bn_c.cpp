@@ -0,0 +1,283 @@
+#include "bn_c.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "circuito.h"
+#include "compacto.h"
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace{
+
+// red cargada y su circuito; lo comparten el modelo y sus sesiones
+struct EstadoModelo{
+    std::shared_ptr<const RedBayesiana> red;
+    std::vector<size_t> base;           // desplazamiento de cada variable en bn_marginales
+    size_t num_estados = 0;
+    std::once_flag compilado;           // si compilar() lanza, el siguiente uso lo reintenta
+    std::unique_ptr<CircuitoAritmetico> ac;
+
+    const CircuitoAritmetico& circuito(){
+        std::call_once(compilado, [this]{
+            ac = std::make_unique<CircuitoAritmetico>(CircuitoAritmetico::compilar(*red));
+        });
+        return *ac;
+    }
+};
+
+// error de argumentos de la API (se distingue de los del motor)
+struct ErrorArgumento : std::runtime_error{
+    using std::runtime_error::runtime_error;
+};
+struct ErrorBuffer : std::runtime_error{
+    using std::runtime_error::runtime_error;
+};
+
+thread_local std::string ultimo_error;
+
+// ejecuta f y traduce las excepciones a códigos; `codigo` es el que
+// corresponde a un runtime_error del motor en esta operación
+template<class F> int proteger(int codigo, F f){
+    try{
+        ultimo_error.clear();
+        return f();
+    }catch(const ErrorArgumento& ex){
+        ultimo_error = ex.what(); return BN_ERROR_ARGUMENTO;
+    }catch(const ErrorBuffer& ex){
+        ultimo_error = ex.what(); return BN_ERROR_BUFFER;
+    }catch(const std::bad_alloc&){
+        ultimo_error = "Memoria insuficiente"; return BN_ERROR_MEMORIA;
+    }catch(const std::exception& ex){
+        ultimo_error = ex.what(); return codigo;
+    }catch(...){
+        ultimo_error = "Error desconocido"; return BN_ERROR_INTERNO;
+    }
+}
+
+// istream sobre memoria del llamador, sin copiarla
+struct BufferMemoria : std::streambuf{
+    BufferMemoria(const char* datos, size_t bytes){
+        char* p = const_cast<char*>(datos);
+        setg(p, p, p+bytes);
+    }
+};
+
+} // namespace
+
+struct bn_modelo{
+    std::shared_ptr<EstadoModelo> estado;
+};
+
+struct bn_sesion{
+    std::shared_ptr<EstadoModelo> estado;
+    CircuitoAritmetico::Espacio espacio;
+    std::vector<int> ev;                // -1 salvo durante una consulta
+};
+
+namespace{
+
+int publicar(std::shared_ptr<RedBayesiana> red, bn_modelo** modelo){
+    auto estado = std::make_shared<EstadoModelo>();
+    for(const Nodo* X: red->grafo().orden){
+        estado->base.push_back(estado->num_estados);
+        estado->num_estados += X->valores.size();
+    }
+    estado->red = std::move(red);
+    *modelo = new bn_modelo{std::move(estado)};
+    return BN_OK;
+}
+
+int cargar(bn_modelo** modelo, const std::function<void(RedBayesiana&)>& f){
+    if(!modelo) throw ErrorArgumento("modelo nulo");
+    *modelo = nullptr;
+    auto red = std::make_shared<RedBayesiana>();
+    f(*red);
+    return publicar(std::move(red), modelo);
+}
+
+const Nodo* variable(const bn_modelo* m, int v){
+    if(!m) return nullptr;
+    const auto& orden = m->estado->red->grafo().orden;
+    return v>=0 && (size_t)v<orden.size()? orden[v] : nullptr;
+}
+
+// Valida la evidencia y la deja en s->ev mientras vive el objeto; al
+// destruirse, s->ev vuelve a estar todo en -1.
+struct EvidenciaFijada{
+    bn_sesion* s;
+    const int* vars;
+    size_t n = 0;
+    EvidenciaFijada(bn_sesion* s, const int* ev_variables, const int* ev_valores, size_t n);
+    ~EvidenciaFijada(){ for(size_t i=0;i<n;++i) s->ev[vars[i]] = -1; }
+};
+
+EvidenciaFijada::EvidenciaFijada(bn_sesion* s_, const int* ev_variables, const int* ev_valores, size_t num)
+    : s(s_), vars(ev_variables){
+    if(num && (!ev_variables || !ev_valores)) throw ErrorArgumento("evidencia nula");
+    const auto& orden = s->estado->red->grafo().orden;
+    for(size_t i=0;i<num;++i){
+        const int v = ev_variables[i], k = ev_valores[i];
+        if(v<0 || (size_t)v>=orden.size())
+            throw ErrorArgumento("variable fuera de rango: "+std::to_string(v));
+        if(k<0 || (size_t)k>=orden[v]->valores.size())
+            throw ErrorArgumento("valor fuera de rango: "+orden[v]->nombre+"="+std::to_string(k));
+    }
+    for(size_t i=0;i<num;++i) s->ev[ev_variables[i]] = ev_valores[i];
+    n = num;
+}
+
+} // namespace
+
+extern "C" {
+
+int bn_version_abi(void){ return BN_VERSION_ABI; }
+
+const char* bn_ultimo_error(void){ return ultimo_error.c_str(); }
+
+int bn_cargar_texto(const char* ruta_estructura, const char* ruta_cpts, bn_modelo** modelo){
+    return proteger(BN_ERROR_CARGA, [&]{
+        if(!ruta_estructura || !ruta_cpts) throw ErrorArgumento("ruta nula");
+        return cargar(modelo, [&](RedBayesiana& r){
+            r.cargar_estructura(std::string(ruta_estructura));
+            r.cargar_cpts(std::string(ruta_cpts));
+        });
+    });
+}
+
+int bn_cargar_texto_memoria(const char* estructura, const char* cpts, bn_modelo** modelo){
+    return proteger(BN_ERROR_CARGA, [&]{
+        if(!estructura || !cpts) throw ErrorArgumento("texto nulo");
+        return cargar(modelo, [&](RedBayesiana& r){
+            std::istringstream e(estructura), c(cpts);
+            r.cargar_estructura(e);
+            r.cargar_cpts(c);
+        });
+    });
+}
+
+int bn_cargar_binario(const char* ruta, bn_modelo** modelo){
+    return proteger(BN_ERROR_CARGA, [&]{
+        if(!ruta) throw ErrorArgumento("ruta nula");
+        return cargar(modelo, [&](RedBayesiana& r){ cargar_binario(r, std::string(ruta)); });
+    });
+}
+
+int bn_cargar_binario_memoria(const void* datos, size_t bytes, bn_modelo** modelo){
+    return proteger(BN_ERROR_CARGA, [&]{
+        if(!datos && bytes) throw ErrorArgumento("datos nulos");
+        return cargar(modelo, [&](RedBayesiana& r){
+            BufferMemoria buf(static_cast<const char*>(datos), bytes);
+            std::istream in(&buf);
+            cargar_binario(r, in);
+        });
+    });
+}
+
+void bn_liberar(bn_modelo* modelo){ delete modelo; }
+
+int bn_compilar(bn_modelo* modelo){
+    return proteger(BN_ERROR_INTERNO, [&]{
+        if(!modelo) throw ErrorArgumento("modelo nulo");
+        modelo->estado->circuito();
+        return BN_OK;
+    });
+}
+
+int bn_num_variables(const bn_modelo* modelo){
+    return modelo? (int)modelo->estado->red->grafo().orden.size() : -1;
+}
+
+int bn_variable(const bn_modelo* modelo, const char* nombre){
+    if(!modelo || !nombre) return -1;
+    const Nodo* X = modelo->estado->red->obtener(nombre);
+    return X? X->id : -1;
+}
+
+int bn_num_valores(const bn_modelo* modelo, int v){
+    const Nodo* X = variable(modelo, v);
+    return X? (int)X->valores.size() : -1;
+}
+
+int bn_valor(const bn_modelo* modelo, int v, const char* valor){
+    const Nodo* X = variable(modelo, v);
+    if(!X || !valor) return -1;
+    for(size_t k=0;k<X->valores.size();++k) if(X->valores[k]==valor) return (int)k;
+    return -1;
+}
+
+const char* bn_nombre_variable(const bn_modelo* modelo, int v){
+    const Nodo* X = variable(modelo, v);
+    return X? X->nombre.c_str() : nullptr;
+}
+
+const char* bn_nombre_valor(const bn_modelo* modelo, int v, int k){
+    const Nodo* X = variable(modelo, v);
+    if(!X || k<0 || (size_t)k>=X->valores.size()) return nullptr;
+    return X->valores[k].c_str();
+}
+
+size_t bn_num_estados(const bn_modelo* modelo){
+    return modelo? modelo->estado->num_estados : 0;
+}
+
+size_t bn_desplazamiento(const bn_modelo* modelo, int v){
+    if(!variable(modelo, v)) return 0;
+    return modelo->estado->base[v];
+}
+
+int bn_sesion_crear(bn_modelo* modelo, bn_sesion** sesion){
+    return proteger(BN_ERROR_INTERNO, [&]{
+        if(!modelo || !sesion) throw ErrorArgumento("modelo o sesión nulos");
+        auto s = std::make_unique<bn_sesion>();
+        s->estado = modelo->estado;
+        s->ev.assign(modelo->estado->red->grafo().orden.size(), -1);
+        *sesion = s.release();
+        return BN_OK;
+    });
+}
+
+void bn_sesion_liberar(bn_sesion* sesion){ delete sesion; }
+
+int bn_consultar(bn_sesion* s, int v,
+                 const int* ev_variables, const int* ev_valores, size_t n,
+                 double* salida, size_t capacidad, double* prob_evidencia){
+    return proteger(BN_ERROR_INTERNO, [&]{
+        if(!s || !salida) throw ErrorArgumento("sesión o salida nulas");
+        if(v<0 || (size_t)v>=s->ev.size()) throw ErrorArgumento("variable fuera de rango: "+std::to_string(v));
+        const size_t card = s->estado->red->grafo().orden[v]->valores.size();
+        if(capacidad<card)
+            throw ErrorBuffer("la salida necesita "+std::to_string(card)+" entradas");
+        const CircuitoAritmetico& ac = s->estado->circuito();
+        EvidenciaFijada ev(s, ev_variables, ev_valores, n);
+        s->ev[v] = -1;
+        const double z = ac.marginales(s->ev, salida, s->espacio, v);
+        if(prob_evidencia) *prob_evidencia = z;
+        if(z==0){ ultimo_error = "Evidencia con probabilidad 0"; return (int)BN_ERROR_EVIDENCIA; }
+        return (int)BN_OK;
+    });
+}
+
+int bn_marginales(bn_sesion* s,
+                  const int* ev_variables, const int* ev_valores, size_t n,
+                  double* salida, size_t capacidad, double* prob_evidencia){
+    return proteger(BN_ERROR_INTERNO, [&]{
+        if(!s || !salida) throw ErrorArgumento("sesión o salida nulas");
+        if(capacidad<s->estado->num_estados)
+            throw ErrorBuffer("la salida necesita "+std::to_string(s->estado->num_estados)+" entradas");
+        const CircuitoAritmetico& ac = s->estado->circuito();
+        EvidenciaFijada ev(s, ev_variables, ev_valores, n);
+        const double z = ac.marginales(s->ev, salida, s->espacio);
+        if(prob_evidencia) *prob_evidencia = z;
+        if(z==0){ ultimo_error = "Evidencia con probabilidad 0"; return (int)BN_ERROR_EVIDENCIA; }
+        return (int)BN_OK;
+    });
+}
+
+} // extern "C"
@@ -0,0 +1,111 @@
+/* API en C de la biblioteca (libbn), para enlazar el motor desde otros
+ * lenguajes sin pasar por texto.
+ *
+ *  - Los nombres de variables y valores se resuelven a enteros una sola
+ *    vez (bn_variable, bn_valor); las consultas reciben la evidencia
+ *    como dos arreglos de enteros.
+ *  - Los resultados se escriben en buffers del llamador. Cada hilo usa su
+ *    propia bn_sesion, que guarda los buffers de evaluación: después de
+ *    la primera consulta, las siguientes no reservan memoria.
+ *  - Las consultas se responden con el circuito aritmético de la red,
+ *    compilado una vez por modelo (al primer uso o con bn_compilar).
+ *  - Ninguna función lanza excepciones: devuelven BN_OK o un código de
+ *    error negativo, y bn_ultimo_error() da el mensaje.
+ *
+ * Un bn_modelo es inmutable y se puede compartir entre hilos. Una
+ * bn_sesion es de un solo hilo a la vez y mantiene vivo su modelo, así que
+ * bn_liberar() se puede llamar aunque queden sesiones abiertas.
+ *
+ * Solo se añaden funciones al final de la API; BN_VERSION_ABI cambia si
+ * alguna firma existente cambia. */
+#ifndef BN_C_H
+#define BN_C_H
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(BN_CONSTRUYENDO)
+#    define BN_API __declspec(dllexport)
+#  elif defined(BN_COMPARTIDA)
+#    define BN_API __declspec(dllimport)
+#  else
+#    define BN_API
+#  endif
+#elif defined(__GNUC__)
+#  define BN_API __attribute__((visibility("default")))
+#else
+#  define BN_API
+#endif
+
+#define BN_VERSION_ABI 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bn_modelo bn_modelo;
+typedef struct bn_sesion bn_sesion;
+
+enum{
+    BN_OK = 0,
+    BN_ERROR_ARGUMENTO = -1,   /* puntero nulo, id o valor fuera de rango */
+    BN_ERROR_CARGA = -2,       /* archivo ilegible o mal formado */
+    BN_ERROR_BUFFER = -3,      /* el buffer de salida es demasiado chico */
+    BN_ERROR_EVIDENCIA = -4,   /* la evidencia tiene probabilidad 0 */
+    BN_ERROR_MEMORIA = -5,
+    BN_ERROR_INTERNO = -6
+};
+
+BN_API int bn_version_abi(void);
+/* mensaje del último error de este hilo ("" si no hubo); vale hasta la
+ * siguiente llamada a la API desde el mismo hilo */
+BN_API const char* bn_ultimo_error(void);
+
+/* ---- carga ---- */
+/* formato de texto (estructura y CPTs), desde archivos o desde memoria */
+BN_API int bn_cargar_texto(const char* ruta_estructura, const char* ruta_cpts, bn_modelo** modelo);
+BN_API int bn_cargar_texto_memoria(const char* estructura, const char* cpts, bn_modelo** modelo);
+/* formato binario de GUARDAR_BIN: */
+BN_API int bn_cargar_binario(const char* ruta, bn_modelo** modelo);
+BN_API int bn_cargar_binario_memoria(const void* datos, size_t bytes, bn_modelo** modelo);
+BN_API void bn_liberar(bn_modelo* modelo);
+/* compila el circuito ahora en vez de en la primera consulta */
+BN_API int bn_compilar(bn_modelo* modelo);
+
+/* ---- nombres e ids ----
+ * Las variables se numeran 0..n-1 en orden topológico y sus valores
+ * 0..card-1 en el orden del archivo. Los nombres devueltos viven lo
+ * mismo que el modelo. */
+BN_API int bn_num_variables(const bn_modelo* modelo);
+BN_API int bn_variable(const bn_modelo* modelo, const char* nombre);           /* -1 si no existe */
+BN_API int bn_num_valores(const bn_modelo* modelo, int variable);              /* -1 si no existe */
+BN_API int bn_valor(const bn_modelo* modelo, int variable, const char* valor); /* -1 si no existe */
+BN_API const char* bn_nombre_variable(const bn_modelo* modelo, int variable);
+BN_API const char* bn_nombre_valor(const bn_modelo* modelo, int variable, int valor);
+/* Σ card de todas las variables (tamaño de la salida de bn_marginales) y
+ * posición de la primera entrada de `variable` en esa salida */
+BN_API size_t bn_num_estados(const bn_modelo* modelo);
+BN_API size_t bn_desplazamiento(const bn_modelo* modelo, int variable);
+
+/* ---- consultas ---- */
+BN_API int bn_sesion_crear(bn_modelo* modelo, bn_sesion** sesion);
+BN_API void bn_sesion_liberar(bn_sesion* sesion);
+
+/* P(variable | e) en salida[0 .. card). La evidencia son `num_evidencia`
+ * pares (ev_variables[i], ev_valores[i]); la evidencia sobre la propia
+ * variable consultada se ignora. Si `prob_evidencia` no es nulo recibe
+ * P(e) (sin esa evidencia ignorada). */
+BN_API int bn_consultar(bn_sesion* sesion, int variable,
+                        const int* ev_variables, const int* ev_valores, size_t num_evidencia,
+                        double* salida, size_t capacidad, double* prob_evidencia);
+
+/* Todos los marginales P(v | e) de una vez, en salida[bn_desplazamiento(v) + k].
+ * Las variables observadas quedan como 1 en su valor y 0 en el resto. */
+BN_API int bn_marginales(bn_sesion* sesion,
+                         const int* ev_variables, const int* ev_valores, size_t num_evidencia,
+                         double* salida, size_t capacidad, double* prob_evidencia);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BN_C_H */
@@ -0,0 +1,433 @@
+#include "circuito.h"
+#include "red_bayesiana.h"
+#include "eliminacion.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Construye el circuito con "hash-consing": cada nodo suma/producto se
+// identifica por su tipo y su lista ordenada de hijos, así que pedir dos
+// veces la misma operación devuelve el mismo nodo.
+class ConstructorCircuito{
+public:
+    using Tipo = CircuitoAritmetico::Tipo;
+
+    ConstructorCircuito(CircuitoAritmetico& ac, const CircuitoAritmetico::Opciones& op)
+        : ac_(ac), op_(op) {}
+
+    uint32_t constante(double v){
+        if(op_.compartir_valores){
+            auto it = por_valor_.find(v);
+            if(it!=por_valor_.end()) return it->second;
+        }
+        CircuitoAritmetico::NodoAC n;
+        n.tipo = Tipo::Constante;
+        n.valor = v;
+        uint32_t id = nuevo(n, {});
+        if(op_.compartir_valores) por_valor_[v] = id;
+        return id;
+    }
+
+    uint32_t indicador(int v, int k){
+        CircuitoAritmetico::NodoAC n;
+        n.tipo = Tipo::Indicador;
+        n.var = v; n.k = k;
+        return nuevo(n, {});
+    }
+
+    uint32_t operar(Tipo t, std::vector<uint32_t> hs){
+        if(op_.podar_ceros){
+            // determinismo: un producto con un 0 es 0 y un 0 no aporta a una suma;
+            // los parámetros 1 tampoco aportan a un producto
+            std::vector<uint32_t> quedan;
+            for(uint32_t h: hs){
+                const auto& n = tmp_[h];
+                bool cte = n.tipo==Tipo::Constante;
+                if(cte && n.valor==0.0){
+                    if(t==Tipo::Producto) return cero();
+                    continue;
+                }
+                if(t==Tipo::Producto && cte && n.valor==1.0) continue;
+                quedan.push_back(h);
+            }
+            hs.swap(quedan);
+        }
+        if(hs.empty()) return t==Tipo::Producto? constante(1.0) : cero();
+        if(hs.size()==1) return hs[0];
+
+        // forma canónica (operaciones conmutativas) y búsqueda en la tabla única
+        std::sort(hs.begin(), hs.end());
+        std::vector<uint32_t> clave(hs);
+        clave.push_back((uint32_t)t);
+        auto it = unicos_.find(clave);
+        if(it!=unicos_.end()) return it->second;
+        CircuitoAritmetico::NodoAC n;
+        n.tipo = t;
+        uint32_t id = nuevo(n, std::move(hs));
+        unicos_.emplace(std::move(clave), id);
+        return id;
+    }
+
+    uint32_t cero(){
+        if(cero_==UINT32_MAX){
+            CircuitoAritmetico::NodoAC n;
+            n.tipo = Tipo::Constante;
+            n.valor = 0.0;
+            cero_ = nuevo(n, {});
+        }
+        return cero_;
+    }
+
+    // copia al circuito solo los nodos alcanzables desde la raíz (y todos
+    // los indicadores), conservando el orden de creación, que ya es
+    // topológico, y guardando los hijos de forma contigua
+    void terminar(uint32_t raiz){
+        std::vector<bool> vivo(tmp_.size(), false);
+        std::vector<uint32_t> pila{raiz};
+        for(const auto& fila: ac_.indicadores_) for(uint32_t i: fila) pila.push_back(i);
+        for(const auto& fila: ac_.parametros_) for(uint32_t i: fila) pila.push_back(i);
+        while(!pila.empty()){
+            uint32_t i = pila.back(); pila.pop_back();
+            if(vivo[i]) continue;
+            vivo[i] = true;
+            for(uint32_t h: hijos_tmp_[i]) pila.push_back(h);
+        }
+        std::vector<uint32_t> nuevo_id(tmp_.size(), UINT32_MAX);
+        for(uint32_t i=0;i<tmp_.size();++i){
+            if(!vivo[i]) continue;
+            nuevo_id[i] = (uint32_t)ac_.nodos_.size();
+            auto n = tmp_[i];
+            n.inicio = (uint32_t)ac_.hijos_.size();
+            n.num = (uint32_t)hijos_tmp_[i].size();
+            for(uint32_t h: hijos_tmp_[i]) ac_.hijos_.push_back(nuevo_id[h]);
+            ac_.nodos_.push_back(n);
+        }
+        // la raíz debe ser el último nodo (evaluar() y derivar() lo suponen):
+        // si no lo es, se añade una suma unaria que la envuelve
+        if(nuevo_id[raiz]+1 != ac_.nodos_.size()){
+            CircuitoAritmetico::NodoAC n;
+            n.tipo = Tipo::Suma;
+            n.inicio = (uint32_t)ac_.hijos_.size();
+            n.num = 1;
+            ac_.hijos_.push_back(nuevo_id[raiz]);
+            ac_.nodos_.push_back(n);
+        }
+        for(auto& fila: ac_.indicadores_) for(auto& i: fila) i = nuevo_id[i];
+        for(auto& fila: ac_.parametros_) for(auto& i: fila) i = nuevo_id[i];
+    }
+
+private:
+    struct HashClave{
+        size_t operator()(const std::vector<uint32_t>& v) const{
+            size_t h = v.size();
+            for(uint32_t x: v) h = h*0x9E3779B97F4A7C15ull ^ (x + (h>>7));
+            return h;
+        }
+    };
+
+    uint32_t nuevo(const CircuitoAritmetico::NodoAC& n, std::vector<uint32_t> hs){
+        tmp_.push_back(n);
+        hijos_tmp_.push_back(std::move(hs));
+        return (uint32_t)(tmp_.size()-1);
+    }
+
+    CircuitoAritmetico& ac_;
+    CircuitoAritmetico::Opciones op_;
+    std::vector<CircuitoAritmetico::NodoAC> tmp_;
+    std::vector<std::vector<uint32_t>> hijos_tmp_;
+    std::unordered_map<std::vector<uint32_t>, uint32_t, HashClave> unicos_;
+    std::unordered_map<double, uint32_t> por_valor_;
+    uint32_t cero_ = UINT32_MAX;
+};
+
+namespace {
+
+// factor simbólico: cada entrada es un nodo del circuito
+struct FactorAC{
+    std::vector<int> vars;
+    std::vector<size_t> pasos;
+    std::vector<uint32_t> entradas;
+};
+
+std::vector<size_t> calcular_pasos(const std::vector<int>& vars, const std::vector<size_t>& card){
+    std::vector<size_t> pasos(vars.size(), 1);
+    for(size_t k=vars.size(); k-- > 1; ) pasos[k-1] = pasos[k]*card[vars[k]];
+    return pasos;
+}
+
+} // namespace
+
+CircuitoAritmetico CircuitoAritmetico::compilar(const RedBayesiana& rb, const Opciones& op){
+    CircuitoAritmetico ac;
+    ConstructorCircuito b(ac, op);
+
+    ac.vars_ = rb.grafo().orden;
+    const int n = (int)ac.vars_.size();
+    std::vector<size_t> card(n);
+    for(int v=0; v<n; ++v) card[v] = ac.vars_[v]->valores.size();
+
+    // indicadores λ_{v,k}
+    ac.indicadores_.resize(n);
+    for(int v=0; v<n; ++v)
+        for(size_t k=0;k<card[v];++k) ac.indicadores_[v].push_back(b.indicador(v, (int)k));
+
+    // un factor por CPT con entradas θ_{x|u} · λ_x
+    const bool individuales = !op.podar_ceros && !op.compartir_valores;
+    if(individuales) ac.parametros_.resize(n);
+    std::vector<FactorAC> activos(n);
+    std::vector<std::vector<int>> alcances(n);
+    for(int v=0; v<n; ++v){
+        const Nodo* X = ac.vars_[v];
+        if(!X->cpt || !X->cpt->finalizada())
+            throw std::runtime_error(mensaje_sin_cpt(X));
+        const TablaProbabilidad& T = *X->cpt;
+        T.exigir_densa("El circuito aritmético");
+        FactorAC& f = activos[v];
+        for(Nodo* p: T.padres) f.vars.push_back(p->id);
+        f.vars.push_back(v);
+        f.pasos = calcular_pasos(f.vars, card);
+        for(size_t fila=0; fila<T.num_filas(); ++fila)
+            for(size_t k=0;k<card[v];++k){
+                double p = T.prob(fila, k);
+                if(std::isnan(p)) throw std::runtime_error("CPT incompleta: "+X->nombre);
+                uint32_t theta = b.constante(p);
+                if(individuales) ac.parametros_[v].push_back(theta);
+                f.entradas.push_back(b.operar(Tipo::Producto, {theta, ac.indicadores_[v][k]}));
+            }
+        alcances[v] = f.vars;
+    }
+
+    // eliminación de variables simbólica (se eliminan todas)
+    std::vector<int> orden = orden_min_fill(alcances, card, std::vector<bool>(n, false));
+    std::vector<int> asig(n, 0);
+    for(int x: orden){
+        std::vector<FactorAC> usados, resto;
+        for(auto& f: activos)
+            (std::find(f.vars.begin(), f.vars.end(), x)!=f.vars.end()? usados : resto).push_back(std::move(f));
+
+        FactorAC nuevo;
+        for(auto& f: usados) for(int v: f.vars) if(v!=x) nuevo.vars.push_back(v);
+        std::sort(nuevo.vars.begin(), nuevo.vars.end());
+        nuevo.vars.erase(std::unique(nuevo.vars.begin(), nuevo.vars.end()), nuevo.vars.end());
+        nuevo.pasos = calcular_pasos(nuevo.vars, card);
+        size_t tam = 1;
+        for(int v: nuevo.vars) tam *= card[v];
+        nuevo.entradas.reserve(tam);
+
+        // odómetro sobre el alcance del nuevo factor (última variable más rápida)
+        for(int v: nuevo.vars) asig[v] = 0;
+        std::vector<uint32_t> sumandos, factores;
+        for(size_t e=0; e<tam; ++e){
+            sumandos.clear();
+            for(size_t xv=0; xv<card[x]; ++xv){
+                asig[x] = (int)xv;
+                factores.clear();
+                for(auto& f: usados){
+                    size_t idx = 0;
+                    for(size_t k=0;k<f.vars.size();++k) idx += (size_t)asig[f.vars[k]]*f.pasos[k];
+                    factores.push_back(f.entradas[idx]);
+                }
+                sumandos.push_back(b.operar(Tipo::Producto, factores));
+            }
+            nuevo.entradas.push_back(b.operar(Tipo::Suma, sumandos));
+            for(size_t k=nuevo.vars.size(); k-- > 0; ){
+                if(++asig[nuevo.vars[k]] < (int)card[nuevo.vars[k]]) break;
+                asig[nuevo.vars[k]] = 0;
+            }
+        }
+        resto.push_back(std::move(nuevo));
+        activos.swap(resto);
+    }
+
+    // solo quedan factores constantes: su producto es la raíz
+    std::vector<uint32_t> finales;
+    for(auto& f: activos) finales.push_back(f.entradas[0]);
+    uint32_t raiz = b.operar(Tipo::Producto, finales);
+    b.terminar(raiz);
+    return ac;
+}
+
+size_t CircuitoAritmetico::num_parametros() const{
+    size_t c = 0;
+    for(const auto& n: nodos_) if(n.tipo==Tipo::Constante) ++c;
+    return c;
+}
+
+// pasada hacia arriba: un solo bucle sobre el arreglo plano
+void CircuitoAritmetico::evaluar(const std::vector<int>& ev, std::vector<double>& val) const{
+    val.resize(nodos_.size());
+    const uint32_t* h = hijos_.data();
+    for(size_t i=0;i<nodos_.size();++i){
+        const NodoAC& n = nodos_[i];
+        switch(n.tipo){
+            case Tipo::Constante: val[i] = n.valor; break;
+            case Tipo::Indicador: val[i] = (ev[n.var]<0 || ev[n.var]==n.k)? 1.0 : 0.0; break;
+            case Tipo::Suma: {
+                double s = 0;
+                for(uint32_t j=0;j<n.num;++j) s += val[h[n.inicio+j]];
+                val[i] = s; break;
+            }
+            case Tipo::Producto: {
+                double p = 1;
+                for(uint32_t j=0;j<n.num;++j) p *= val[h[n.inicio+j]];
+                val[i] = p; break;
+            }
+        }
+    }
+}
+
+// pasada hacia abajo: der[i] = ∂f/∂(nodo i). En los productos, la derivada
+// respecto de un hijo es el producto de sus hermanos; se calcula con
+// productos prefijo/sufijo para no dividir (los hijos pueden valer 0).
+void CircuitoAritmetico::derivar(const std::vector<double>& val, std::vector<double>& der,
+                                 std::vector<double>& prefijo) const{
+    der.assign(nodos_.size(), 0.0);
+    if(nodos_.empty()) return;
+    der.back() = 1.0;
+    const uint32_t* h = hijos_.data();
+    for(size_t i=nodos_.size(); i-- > 0; ){
+        const NodoAC& n = nodos_[i];
+        const double d = der[i];
+        if(d==0.0) continue;
+        if(n.tipo==Tipo::Suma){
+            for(uint32_t j=0;j<n.num;++j) der[h[n.inicio+j]] += d;
+        }else if(n.tipo==Tipo::Producto){
+            prefijo.resize(n.num);
+            double p = 1;
+            for(uint32_t j=0;j<n.num;++j){ prefijo[j] = p; p *= val[h[n.inicio+j]]; }
+            double suf = 1;
+            for(uint32_t j=n.num; j-- > 0; ){
+                der[h[n.inicio+j]] += d*prefijo[j]*suf;
+                suf *= val[h[n.inicio+j]];
+            }
+        }
+    }
+}
+
+double CircuitoAritmetico::marginales(const std::vector<int>& ev,
+                                      std::vector<std::vector<double>>& marg) const{
+    std::vector<double> val, der, prefijo;
+    evaluar(ev, val);
+    const double z = val.back();
+    if(z==0)
+        throw std::runtime_error("Evidencia con probabilidad 0");
+    derivar(val, der, prefijo);
+
+    marg.resize(vars_.size());
+    for(size_t v=0; v<vars_.size(); ++v){
+        marg[v].assign(indicadores_[v].size(), 0.0);
+        for(size_t k=0;k<indicadores_[v].size();++k){
+            // variable observada: su marginal es la propia evidencia;
+            // libre: ∂f/∂λ_{v,k} = P(v=k, e)
+            if(ev[v]>=0) marg[v][k] = (ev[v]==(int)k)? 1.0 : 0.0;
+            else marg[v][k] = der[indicadores_[v][k]]/z;
+        }
+    }
+    return z;
+}
+
+double CircuitoAritmetico::marginales(const std::vector<int>& ev, double* salida, Espacio& esp, int solo) const{
+    evaluar(ev, esp.val);
+    const double z = esp.val.back();
+    if(z==0) return 0;
+    derivar(esp.val, esp.der, esp.prefijo);
+    size_t base = 0;
+    for(size_t v=0; v<vars_.size(); ++v){
+        const size_t r = indicadores_[v].size();
+        if(solo<0 || (size_t)solo==v){
+            double* d = salida + (solo<0? base : 0);
+            for(size_t k=0;k<r;++k)
+                d[k] = ev[v]>=0? (ev[v]==(int)k? 1.0 : 0.0) : esp.der[indicadores_[v][k]]/z;
+        }
+        base += r;
+    }
+    return z;
+}
+
+std::vector<DerivadaParametro> CircuitoAritmetico::sensibilidad(int q, int valor, const std::vector<int>& ev,
+                                                                double* posterior) const{
+    if(parametros_.empty())
+        throw std::runtime_error("El circuito no se compiló para sensibilidad (parámetros compartidos o podados)");
+    std::vector<double> val, der, val_q, der_q, prefijo;
+    evaluar(ev, val);
+    const double z = val.back();
+    if(z==0)
+        throw std::runtime_error("Evidencia con probabilidad 0");
+    derivar(val, der, prefijo);
+    std::vector<int> ev_q(ev);
+    ev_q[q] = valor;
+    evaluar(ev_q, val_q);
+    derivar(val_q, der_q, prefijo);
+    const double p = val_q.back()/z;
+    if(posterior) *posterior = p;
+
+    std::vector<DerivadaParametro> res;
+    for(size_t v=0; v<vars_.size(); ++v){
+        const size_t r = indicadores_[v].size();
+        const size_t base = res.size();
+        for(size_t e=0; e<parametros_[v].size(); ++e){
+            const uint32_t i = parametros_[v][e];
+            DerivadaParametro d;
+            d.nodo = vars_[v];
+            d.fila = e/r; d.k = e%r;
+            d.valor = nodos_[i].valor;
+            d.derivada = (der_q[i] - p*der[i])/z;
+            res.push_back(d);
+        }
+        // variación proporcional en cada fila: dθ_j/dθ_k = -θ_j/(1-θ_k);
+        // si θ_k = 1 el resto es 0 y la masa se reparte por igual
+        for(size_t f=base; f<res.size(); f+=r){
+            double suma = 0, suma_g = 0;
+            for(size_t j=0;j<r;++j){ suma += res[f+j].valor*res[f+j].derivada; suma_g += res[f+j].derivada; }
+            for(size_t k=0;k<r;++k){
+                DerivadaParametro& d = res[f+k];
+                const double resto = 1.0 - d.valor;
+                if(r==1) d.covariada = 0;
+                else if(resto>1e-12) d.covariada = d.derivada - (suma - d.valor*d.derivada)/resto;
+                else d.covariada = d.derivada - (suma_g - d.derivada)/(double)(r-1);
+            }
+        }
+    }
+    std::stable_sort(res.begin(), res.end(), [](const DerivadaParametro& a, const DerivadaParametro& b){
+        return std::fabs(a.covariada) > std::fabs(b.covariada);
+    });
+    return res;
+}
+
+std::vector<int> CircuitoAritmetico::indices_evidencia(
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    std::vector<int> ev(vars_.size(), -1);
+    for(const auto& kv: evidencia){
+        int v = -1;
+        for(size_t i=0;i<vars_.size();++i) if(vars_[i]->nombre==kv.first) v = (int)i;
+        if(v<0)
+            throw std::runtime_error("Variable desconocida: "+kv.first);
+        const auto& dom = vars_[v]->valores;
+        auto it = std::find(dom.begin(), dom.end(), kv.second);
+        if(it==dom.end())
+            throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        ev[v] = (int)(it-dom.begin());
+    }
+    return ev;
+}
+
+std::vector<std::pair<std::string,double>> CircuitoAritmetico::consultar(
+    const std::string& variable,
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    int q = -1;
+    for(size_t i=0;i<vars_.size();++i) if(vars_[i]->nombre==variable) q = (int)i;
+    if(q<0)
+        throw std::runtime_error("Variable desconocida: "+variable);
+
+    // igual que en la enumeración, la evidencia sobre la consulta se ignora
+    std::vector<int> ev = indices_evidencia(evidencia);
+    ev[q] = -1;
+    std::vector<std::vector<double>> marg;
+    marginales(ev, marg);
+
+    std::vector<std::pair<std::string,double>> dist;
+    for(size_t k=0;k<marg[q].size();++k) dist.push_back({vars_[q]->valores[k], marg[q][k]});
+    return dist;
+}
@@ -0,0 +1,112 @@
+#ifndef CIRCUITO_H
+#define CIRCUITO_H
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct RedBayesiana; struct Nodo;
+
+// Derivada de P(q | e) respecto de una entrada θ = P(nodo=k | fila de
+// padres); CircuitoAritmetico::sensibilidad() devuelve una por entrada.
+struct DerivadaParametro{
+    const Nodo* nodo = nullptr;
+    size_t fila = 0, k = 0;
+    double valor = 0;       // θ
+    double derivada = 0;    // ∂P(q|e)/∂θ con el resto de la CPT fijo
+    // ∂P(q|e)/∂θ cuando las demás entradas de la fila se reescalan en
+    // proporción para que sigan sumando 1 - θ (variación proporcional)
+    double covariada = 0;
+};
+
+// Circuito aritmético (AC) compilado a partir de la red. El polinomio de
+// la red f(λ, θ) = Σ_x Π θ_{x|u} Π λ_x se compila una sola vez mediante
+// eliminación de variables simbólica con "hash-consing":
+//  - los parámetros con el mismo valor comparten un nodo y los productos
+//    con un parámetro 0 desaparecen (determinismo),
+//  - los nodos suma/producto con los mismos hijos se reutilizan, de modo
+//    que las filas repetidas de una CPT (independencia de contexto)
+//    generan subcircuitos compartidos.
+// El resultado es un arreglo plano de nodos en orden topológico (los hijos
+// antes que los padres). Una pasada hacia arriba da P(e) y una pasada
+// hacia abajo da ∂f/∂λ_{v,k} = P(v=k, e) para todas las variables a la vez.
+class CircuitoAritmetico{
+public:
+    struct Opciones{
+        bool podar_ceros = true;        // eliminar productos con parámetros 0
+        bool compartir_valores = true;  // un solo nodo por valor de parámetro repetido
+    };
+    // sin poda ni valores compartidos cada entrada de CPT es su propio
+    // nodo constante, como necesita sensibilidad()
+    static Opciones opciones_sensibilidad(){ Opciones op; op.podar_ceros = false; op.compartir_valores = false; return op; }
+
+    static CircuitoAritmetico compilar(const RedBayesiana& rb, const Opciones& op);
+    static CircuitoAritmetico compilar(const RedBayesiana& rb){ return compilar(rb, Opciones()); }
+
+    // Evalúa el circuito con la evidencia `ev` (índice de valor por
+    // variable, -1 = no observada) y rellena marg[v][k] = P(v=k | e).
+    // Devuelve P(e). Cada llamada usa sus propios buffers (seguro entre hilos).
+    double marginales(const std::vector<int>& ev, std::vector<std::vector<double>>& marg) const;
+
+    // Buffers de una evaluación. Si se reutiliza el mismo Espacio, las
+    // consultas no reservan memoria después de la primera.
+    struct Espacio{ std::vector<double> val, der, prefijo; };
+
+    // Como marginales(), pero escribe en memoria del llamador: P(v=k | e)
+    // en salida[base(v)+k], con base(v) = Σ_{u<v} card(u). Con `solo` >= 0
+    // escribe únicamente esa variable, en salida[0 .. card). Devuelve P(e);
+    // si es 0 no escribe nada (no lanza).
+    double marginales(const std::vector<int>& ev, double* salida, Espacio& esp, int solo = -1) const;
+
+    // Interfaz con nombres, como InferenceEngine::consultar_enumeracion.
+    std::vector<std::pair<std::string,double>> consultar(
+        const std::string& variable,
+        const std::unordered_map<std::string,std::string>& evidencia) const;
+
+    // Análisis de sensibilidad: P(q=valor | e) (en `posterior`) y su
+    // derivada respecto de cada entrada de CPT, ordenadas de mayor a menor
+    // |covariada|. Con f = polinomio de la red,
+    //   ∂P(q|e)/∂θ = (∂f(q,e)/∂θ - P(q|e)·∂f(e)/∂θ) / f(e),
+    // así que bastan dos pasadas hacia arriba y dos hacia abajo, sin
+    // importar cuántos parámetros tenga la red. Requiere un circuito
+    // compilado con opciones_sensibilidad().
+    std::vector<DerivadaParametro> sensibilidad(int q, int valor, const std::vector<int>& ev,
+                                                double* posterior = nullptr) const;
+
+    // evidencia por nombres -> índices por variable del circuito
+    std::vector<int> indices_evidencia(const std::unordered_map<std::string,std::string>& evidencia) const;
+
+    const std::vector<Nodo*>& variables() const { return vars_; }
+    size_t num_nodos() const { return nodos_.size(); }
+    size_t num_aristas() const { return hijos_.size(); }
+    size_t num_parametros() const;
+
+private:
+    enum class Tipo : uint8_t { Constante, Indicador, Suma, Producto };
+    struct NodoAC{
+        double valor = 0;       // Constante: valor del parámetro
+        uint32_t inicio = 0;    // Suma/Producto: primer hijo en hijos_
+        uint32_t num = 0;       // Suma/Producto: número de hijos
+        int32_t var = -1;       // Indicador: variable y valor
+        int32_t k = -1;
+        Tipo tipo = Tipo::Constante;
+    };
+
+    std::vector<Nodo*> vars_;                    // variables en orden topológico (índice = Nodo::id)
+    std::vector<NodoAC> nodos_;                  // orden topológico, raíz al final
+    std::vector<uint32_t> hijos_;                // listas de hijos contiguas
+    std::vector<std::vector<uint32_t>> indicadores_; // nodo de λ_{v,k}
+    // nodo de θ_{v, fila, k} en parametros_[v][fila*card+k]; solo con
+    // opciones_sensibilidad() (si no, vacío)
+    std::vector<std::vector<uint32_t>> parametros_;
+
+    // pasada hacia arriba (val) y hacia abajo (der = ∂f/∂nodo)
+    void evaluar(const std::vector<int>& ev, std::vector<double>& val) const;
+    void derivar(const std::vector<double>& val, std::vector<double>& der,
+                 std::vector<double>& prefijo) const;
+
+    friend class ConstructorCircuito;
+};
+
+#endif // CIRCUITO_H
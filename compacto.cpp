@@ -0,0 +1,255 @@
+#include "compacto.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+const char MAGIA[4] = {'R','B','N','B'};
+const uint32_t VERSION = 1;
+const uint32_t MARCA_ORDEN = 0x01020304;
+
+template<class T> void escribir(std::ostream& out, const T& x){
+    out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+template<class T> void escribir_vector(std::ostream& out, const std::vector<T>& v){
+    escribir<uint64_t>(out, v.size());
+    out.write(reinterpret_cast<const char*>(v.data()), (std::streamsize)(v.size()*sizeof(T)));
+}
+void escribir_texto(std::ostream& out, const std::string& s){
+    escribir<uint32_t>(out, (uint32_t)s.size());
+    out.write(s.data(), (std::streamsize)s.size());
+}
+
+template<class T> T leer(std::istream& in){
+    T x;
+    if(!in.read(reinterpret_cast<char*>(&x), sizeof(T)))
+        throw std::runtime_error("Archivo binario truncado");
+    return x;
+}
+template<class T> std::vector<T> leer_vector(std::istream& in){
+    uint64_t n = leer<uint64_t>(in);
+    std::vector<T> v;
+    // se lee por bloques para no reservar un tamaño corrupto de golpe
+    const uint64_t bloque = (1u<<20)/sizeof(T);
+    while(v.size()<n){
+        size_t k = (size_t)std::min<uint64_t>(bloque, n-v.size());
+        size_t i = v.size();
+        v.resize(i+k);
+        if(!in.read(reinterpret_cast<char*>(v.data()+i), (std::streamsize)(k*sizeof(T))))
+            throw std::runtime_error("Archivo binario truncado");
+    }
+    return v;
+}
+std::string leer_texto(std::istream& in){
+    uint32_t n = leer<uint32_t>(in);
+    std::string s;
+    while(s.size()<n){
+        char buf[4096];
+        size_t k = std::min<size_t>(sizeof buf, n-s.size());
+        if(!in.read(buf, (std::streamsize)k)) throw std::runtime_error("Archivo binario truncado");
+        s.append(buf, k);
+    }
+    return s;
+}
+
+// Cada índice leído (filas, reglas, contextos) y el tamaño de cada arreglo
+// deben caber en la forma de la tabla: prob() los usa sin comprobar.
+void validar_forma(const TablaProbabilidad& T){
+    using Tipo = TablaProbabilidad::Tipo;
+    auto corrupto = [&](bool mal){
+        if(mal) throw std::runtime_error("Archivo binario corrupto: CPT de "+T.variable->nombre);
+    };
+    for(size_t c: T.cards) corrupto(c==0);
+    corrupto(T.num_datos() % T.columnas != 0);
+    const size_t filas_datos = T.num_datos()/T.columnas;
+    corrupto(!T.defecto.empty() && T.defecto.size()!=T.columnas);
+    for(const auto& fe: T.filas_explicitas) corrupto(fe.first>=T.filas || fe.second>=filas_datos);
+    for(const auto& g: T.reglas){
+        corrupto(g.fila>=filas_datos);
+        for(const auto& c: g.contexto) corrupto(c.first>=T.cards.size() || c.second>=T.cards[c.first]);
+    }
+    if(T.tipo==Tipo::NoisyOr || T.tipo==Tipo::NoisyMax){
+        corrupto(T.fuga.size()!=T.columnas || T.acumuladas.size()!=T.cards.size());
+        for(size_t k=0;k<T.cards.size();++k) corrupto(T.acumuladas[k].size()!=T.cards[k]*T.columnas);
+    }else{
+        corrupto(!T.fuga.empty() || !T.acumuladas.empty());
+    }
+}
+
+} // namespace
+
+void compactar_cpts(RedBayesiana& rb, TablaProbabilidad::Precision p){
+    for(auto& kv: rb.nodos)
+        if(kv.second->cpt && kv.second->cpt->finalizada()) kv.second->cpt->compactar(p);
+}
+
+size_t bytes_cpts(const RedBayesiana& rb){
+    // los arreglos compartidos entre tablas se cuentan una vez
+    std::unordered_set<const void*> vistos;
+    size_t n = 0;
+    for(const auto& kv: rb.nodos)
+        if(kv.second->cpt) n += kv.second->cpt->bytes_parametros(&vistos);
+    return n;
+}
+
+TablaProbabilidad::Precision precision_desde_texto(const std::string& s){
+    if(s=="DOBLE") return TablaProbabilidad::Precision::Doble;
+    if(s=="FLOAT32") return TablaProbabilidad::Precision::Simple;
+    if(s=="LOG16") return TablaProbabilidad::Precision::Log16;
+    throw std::runtime_error("Precisión desconocida (DOBLE|FLOAT32|LOG16): "+s);
+}
+
+const char* nombre_precision(TablaProbabilidad::Precision p){
+    switch(p){
+    case TablaProbabilidad::Precision::Simple: return "float32";
+    case TablaProbabilidad::Precision::Log16:  return "log16";
+    default:                                   return "double";
+    }
+}
+
+void guardar_binario(const RedBayesiana& rb, std::ostream& out){
+    const auto& orden = rb.grafo().orden;
+    for(const Nodo* X: orden)
+        if(X->gauss) throw std::runtime_error("El formato binario no admite nodos continuos: "+X->nombre);
+    out.write(MAGIA, 4);
+    escribir(out, VERSION);
+    escribir(out, MARCA_ORDEN);
+    escribir<uint32_t>(out, (uint32_t)orden.size());
+
+    for(const Nodo* X: orden){
+        escribir_texto(out, X->nombre);
+        escribir<uint32_t>(out, (uint32_t)X->valores.size());
+        for(const auto& v: X->valores) escribir_texto(out, v);
+    }
+    for(const Nodo* X: orden){
+        escribir<uint32_t>(out, (uint32_t)X->padres.size());
+        for(const Nodo* p: X->padres) escribir<uint32_t>(out, (uint32_t)p->id);
+    }
+    for(const Nodo* X: orden){
+        const TablaProbabilidad* T = X->cpt.get();
+        bool con_cpt = T && T->finalizada();
+        escribir<uint8_t>(out, con_cpt);
+        if(!con_cpt) continue;
+        escribir<uint8_t>(out, (uint8_t)T->tipo);
+        escribir<uint8_t>(out, (uint8_t)T->precision);
+        escribir<uint32_t>(out, (uint32_t)T->padres.size());
+        for(const Nodo* p: T->padres) escribir<uint32_t>(out, (uint32_t)p->id);
+        escribir_vector(out, T->datos.vector());
+        escribir_vector(out, T->datos_simple.vector());
+        escribir_vector(out, T->datos_log16.vector());
+        escribir(out, T->paso_log);
+        escribir_vector(out, T->defecto);
+        escribir_vector(out, T->fuga);
+        escribir<uint64_t>(out, T->filas_explicitas.size());
+        for(const auto& fe: T->filas_explicitas){
+            escribir<uint64_t>(out, fe.first);
+            escribir<uint64_t>(out, fe.second);
+        }
+        escribir<uint64_t>(out, T->reglas.size());
+        for(const auto& g: T->reglas){
+            escribir<uint32_t>(out, (uint32_t)g.contexto.size());
+            for(const auto& c: g.contexto){
+                escribir<uint32_t>(out, (uint32_t)c.first);
+                escribir<uint32_t>(out, (uint32_t)c.second);
+            }
+            escribir<uint64_t>(out, g.fila);
+        }
+        escribir<uint32_t>(out, (uint32_t)T->acumuladas.size());
+        for(const auto& a: T->acumuladas) escribir_vector(out, a);
+    }
+    if(!out) throw std::runtime_error("Error al escribir el archivo binario");
+}
+
+void guardar_binario(const RedBayesiana& rb, const std::string& ruta){
+    std::ofstream out(ruta, std::ios::binary);
+    if(!out) throw std::runtime_error("No se puede escribir: "+ruta);
+    guardar_binario(rb, out);
+}
+
+void cargar_binario(RedBayesiana& rb, std::istream& in){
+    if(!rb.nodos.empty()) throw std::runtime_error("cargar_binario necesita una red vacía");
+    char magia[4];
+    if(!in.read(magia, 4) || std::memcmp(magia, MAGIA, 4)!=0)
+        throw std::runtime_error("No es un archivo binario de red (RBNB)");
+    if(leer<uint32_t>(in)!=VERSION) throw std::runtime_error("Versión de archivo binario no soportada");
+    if(leer<uint32_t>(in)!=MARCA_ORDEN)
+        throw std::runtime_error("Archivo binario escrito con otro orden de bytes");
+    const uint32_t n = leer<uint32_t>(in);
+
+    std::vector<Nodo*> nodos;
+    for(uint32_t i=0;i<n;++i){
+        Nodo* X = rb.obtener_o_crear(leer_texto(in));
+        uint32_t r = leer<uint32_t>(in);
+        for(uint32_t j=0;j<r;++j) X->valores.push_back(leer_texto(in));
+        nodos.push_back(X);
+    }
+    if(rb.nodos.size()!=n) throw std::runtime_error("Nombres de nodo repetidos en el archivo binario");
+    auto nodo = [&](uint32_t id){
+        if(id>=n) throw std::runtime_error("Índice de nodo fuera de rango en el archivo binario");
+        return nodos[id];
+    };
+    for(Nodo* X: nodos){
+        uint32_t np = leer<uint32_t>(in);
+        for(uint32_t k=0;k<np;++k) rb.agregar_arco(nodo(leer<uint32_t>(in)), X);
+    }
+    for(Nodo* X: nodos){
+        if(!leer<uint8_t>(in)) continue;
+        auto T = std::make_unique<TablaProbabilidad>();
+        uint8_t tipo = leer<uint8_t>(in), precision = leer<uint8_t>(in);
+        if(tipo>(uint8_t)TablaProbabilidad::Tipo::NoisyMax || precision>(uint8_t)TablaProbabilidad::Precision::Log16)
+            throw std::runtime_error("CPT con tipo o precisión desconocidos: "+X->nombre);
+        std::vector<Nodo*> padres;
+        uint32_t np = leer<uint32_t>(in);
+        for(uint32_t k=0;k<np;++k) padres.push_back(nodo(leer<uint32_t>(in)));
+        T->establecer(X, padres);
+        T->tipo = (TablaProbabilidad::Tipo)tipo;
+        T->precision = (TablaProbabilidad::Precision)precision;
+        T->columnas = X->valores.size();
+        T->filas = 1;
+        for(const Nodo* p: padres){ T->cards.push_back(p->valores.size()); T->filas *= p->valores.size(); }
+        T->datos = leer_vector<double>(in);
+        T->datos_simple = leer_vector<float>(in);
+        T->datos_log16 = leer_vector<uint16_t>(in);
+        T->paso_log = leer<double>(in);
+        T->defecto = leer_vector<double>(in);
+        T->fuga = leer_vector<double>(in);
+        uint64_t nf = leer<uint64_t>(in);
+        for(uint64_t k=0;k<nf;++k){
+            uint64_t f = leer<uint64_t>(in);
+            T->filas_explicitas[(size_t)f] = (size_t)leer<uint64_t>(in);
+        }
+        uint64_t nr = leer<uint64_t>(in);
+        for(uint64_t k=0;k<nr;++k){
+            TablaProbabilidad::Regla g;
+            uint32_t nc = leer<uint32_t>(in);
+            for(uint32_t c=0;c<nc;++c){
+                uint32_t p = leer<uint32_t>(in);
+                g.contexto.push_back({p, leer<uint32_t>(in)});
+            }
+            g.fila = (size_t)leer<uint64_t>(in);
+            T->reglas.push_back(std::move(g));
+        }
+        uint32_t na = leer<uint32_t>(in);
+        for(uint32_t k=0;k<na;++k) T->acumuladas.push_back(leer_vector<double>(in));
+
+        if(T->columnas==0) throw std::runtime_error("Variable sin VALUES: "+X->nombre);
+        if(T->tipo==TablaProbabilidad::Tipo::Tabla && T->num_datos()!=T->filas*T->columnas)
+            throw std::runtime_error("Tamaño de CPT incorrecto en el archivo binario: "+X->nombre);
+        validar_forma(*T);
+        T->preparar_reglas();
+        X->cpt = std::move(T);
+    }
+    rb.grafo();
+}
+
+void cargar_binario(RedBayesiana& rb, const std::string& ruta){
+    std::ifstream in(ruta, std::ios::binary);
+    if(!in) throw std::runtime_error("No se puede abrir: "+ruta);
+    cargar_binario(rb, in);
+}
@@ -0,0 +1,40 @@
+#ifndef COMPACTO_H
+#define COMPACTO_H
+#include "tabla_probabilidad.h"
+#include <istream>
+#include <ostream>
+#include <string>
+
+struct RedBayesiana;
+
+// Almacenamiento compacto de redes grandes: precisión reducida de las CPTs
+// y un formato binario que se carga sin volver a parsear el texto.
+
+// Recodifica los datos de todas las CPTs (ver TablaProbabilidad::Precision).
+// Los parámetros de NOISY-OR/MAX y las filas por defecto son lineales en
+// el número de padres y se quedan en double.
+void compactar_cpts(RedBayesiana& rb, TablaProbabilidad::Precision p);
+// bytes que ocupan los parámetros de todas las CPTs (los arreglos que
+// comparten varias tablas se cuentan una vez)
+size_t bytes_cpts(const RedBayesiana& rb);
+TablaProbabilidad::Precision precision_desde_texto(const std::string& s); // DOBLE|FLOAT32|LOG16
+const char* nombre_precision(TablaProbabilidad::Precision p);
+
+// Formato binario (versión 1, orden de bytes de la máquina):
+//   "RBNB", u32 versión, u32 marca de orden de bytes, u32 número de nodos
+//   por nodo (orden topológico): nombre, valores, ids de los padres
+//   por nodo: u8 con/sin CPT y, si la tiene, tipo, precisión, padres de
+//   la CPT y sus datos tal como están en memoria (double, float o códigos
+//   de 16 bits con su paso), más defecto, filas explícitas, reglas y
+//   acumuladas.
+// Las cadenas van como u32 longitud + bytes. La precisión de cada tabla se
+// conserva: una red compactada antes de guardar se carga compactada.
+void guardar_binario(const RedBayesiana& rb, std::ostream& out);
+void guardar_binario(const RedBayesiana& rb, const std::string& ruta);
+// `rb` debe estar vacía. Lanza si el archivo no es de este formato, está
+// truncado o tiene un índice o tamaño que no cabe en la forma de su CPT
+// (los bytes pueden venir del llamador, ver bn_cargar_binario_memoria).
+void cargar_binario(RedBayesiana& rb, std::istream& in);
+void cargar_binario(RedBayesiana& rb, const std::string& ruta);
+
+#endif // COMPACTO_H
@@ -0,0 +1,79 @@
+#ifndef COMPARTIDO_H
+#define COMPARTIDO_H
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Arreglo inmutable internado por contenido: dos arreglos con los mismos
+// bytes comparten una sola copia en memoria. Las CPTs de subredes
+// repetidas (PLATE, sensores idénticos) guardan así sus números una vez,
+// y todas las tablas que los usan leen de las mismas líneas de caché.
+//
+// La tabla de internado es global y solo guarda referencias débiles: un
+// arreglo se libera cuando lo suelta la última tabla que lo usa. Internar
+// es seguro entre hilos; leer no necesita sincronización (es inmutable).
+template<class T>
+class ArregloCompartido{
+public:
+    ArregloCompartido() = default;
+    ArregloCompartido(std::vector<T>&& v){
+        if(v.empty()) return;
+        p_ = internar(std::move(v));
+        d_ = p_->data();
+        n_ = p_->size();
+    }
+    ArregloCompartido(const std::vector<T>& v): ArregloCompartido(std::vector<T>(v)) {}
+
+    const T& operator[](size_t i) const { return d_[i]; }
+    size_t size() const { return n_; }
+    bool empty() const { return n_==0; }
+    const T* data() const { return d_; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data()+size(); }
+    const std::vector<T>& vector() const { static const std::vector<T> vacio; return p_? *p_ : vacio; }
+    void clear(){ p_.reset(); d_ = nullptr; n_ = 0; }
+    // cuántas tablas usan esta misma copia
+    long usos() const { return p_.use_count(); }
+
+private:
+    std::shared_ptr<const std::vector<T>> p_;
+    const T* d_ = nullptr;        // copia de p_->data(): la lectura no pasa por el vector
+    size_t n_ = 0;
+
+    static std::shared_ptr<const std::vector<T>> internar(std::vector<T>&& v){
+        // FNV-1a sobre los bytes: NAN y -0.0 se distinguen como en memcmp
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(v.data());
+        uint64_t h = 1469598103934665603ull;
+        for(size_t i=0, n=v.size()*sizeof(T); i<n; ++i){ h ^= b[i]; h *= 1099511628211ull; }
+
+        static std::mutex m;
+        static std::unordered_map<uint64_t, std::vector<std::weak_ptr<const std::vector<T>>>> tabla;
+        static size_t altas = 0;
+        std::lock_guard<std::mutex> lk(m);
+        auto& cubeta = tabla[h];
+        for(size_t i=0; i<cubeta.size(); ){
+            auto p = cubeta[i].lock();
+            if(!p){ cubeta[i] = cubeta.back(); cubeta.pop_back(); continue; }
+            if(p->size()==v.size() && std::memcmp(p->data(), v.data(), v.size()*sizeof(T))==0) return p;
+            ++i;
+        }
+        auto p = std::make_shared<const std::vector<T>>(std::move(v));
+        cubeta.push_back(p);
+        // de vez en cuando se barren las cubetas de arreglos ya liberados
+        if(++altas % 4096 == 0){
+            for(auto it = tabla.begin(); it!=tabla.end(); ){
+                auto& c = it->second;
+                for(size_t i=0; i<c.size(); ){
+                    if(c[i].expired()){ c[i] = c.back(); c.pop_back(); } else ++i;
+                }
+                it = c.empty()? tabla.erase(it) : std::next(it);
+            }
+        }
+        return p;
+    }
+};
+
+#endif // COMPARTIDO_H
@@ -0,0 +1,685 @@
+#include "cutset.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include "factor.h"
+#include "eliminacion.h"
+#include "grafo.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// ---- Protocolo ----
+// Cada mensaje es una cabecera de 12 bytes y su carga, todo en little
+// endian sin importar la máquina:
+//   "BNCS" | u16 versión | u16 tipo | u32 bytes de carga
+// SUMAR (pedido):  u64 huella del modelo | i32 consulta
+//                  | u32 n, n × (u32 variable, u32 valor)   evidencia
+//                  | u32 m, m × u32 variable                cutset
+//                  | u64 desde | u64 hasta                  instanciaciones [desde, hasta)
+// PARCIAL:         u64 desde | u32 k | k × f64              Σ P(q=k, c, e) del bloque
+// ERROR:           texto del error
+// Las variables son posiciones topológicas (Nodo::id) y la huella resume
+// nombres, dominios, padres y parámetros: un trabajador con otro modelo
+// responde ERROR en vez de sumar otra red.
+namespace{
+
+const char MAGIA[4] = {'B','N','C','S'};
+const uint16_t VERSION_PROTOCOLO = 1;
+enum : uint16_t{ SUMAR = 1, PARCIAL = 2, ERROR_CUTSET = 3 };
+const size_t CABECERA = 12;
+const uint32_t MAX_CARGA = 1u<<30;
+
+class Escritor{
+public:
+    void u16(uint16_t x){ for(int i=0;i<2;++i) b_.push_back((char)(x>>(8*i))); }
+    void u32(uint32_t x){ for(int i=0;i<4;++i) b_.push_back((char)(x>>(8*i))); }
+    void u64(uint64_t x){ for(int i=0;i<8;++i) b_.push_back((char)(x>>(8*i))); }
+    void f64(double x){ uint64_t u; std::memcpy(&u, &x, 8); u64(u); }
+    void texto(const std::string& s){ b_ += s; }
+    // mensaje completo con su cabecera
+    std::string mensaje(uint16_t tipo) const{
+        Escritor c;
+        c.b_.assign(MAGIA, 4);
+        c.u16(VERSION_PROTOCOLO);
+        c.u16(tipo);
+        c.u32((uint32_t)b_.size());
+        return c.b_ + b_;
+    }
+private:
+    std::string b_;
+};
+
+class Lector{
+public:
+    explicit Lector(const std::string& b): b_(b) {}
+    uint16_t u16(){ return (uint16_t)leer(2); }
+    uint32_t u32(){ return (uint32_t)leer(4); }
+    uint64_t u64(){ return leer(8); }
+    double f64(){ uint64_t u = leer(8); double x; std::memcpy(&x, &u, 8); return x; }
+    std::string resto(){ std::string s = b_.substr(p_); p_ = b_.size(); return s; }
+    void fin() const { if(p_!=b_.size()) throw std::runtime_error("Mensaje de cutset con bytes de más"); }
+private:
+    const std::string& b_;
+    size_t p_ = 0;
+    uint64_t leer(int n){
+        if(b_.size()-p_ < (size_t)n) throw std::runtime_error("Mensaje de cutset truncado");
+        uint64_t x = 0;
+        for(int i=0;i<n;++i) x |= (uint64_t)(unsigned char)b_[p_+i] << (8*i);
+        p_ += n;
+        return x;
+    }
+};
+
+// cabecera -> (tipo, bytes de carga)
+std::pair<uint16_t,uint32_t> leer_cabecera(const char* c){
+    if(std::memcmp(c, MAGIA, 4)!=0) throw std::runtime_error("Mensaje de cutset sin cabecera BNCS");
+    std::string s(c+4, CABECERA-4);
+    Lector l(s);
+    if(l.u16()!=VERSION_PROTOCOLO) throw std::runtime_error("Versión del protocolo de cutset no soportada");
+    uint16_t tipo = l.u16();
+    uint32_t bytes = l.u32();
+    if(bytes>MAX_CARGA) throw std::runtime_error("Mensaje de cutset demasiado grande");
+    return {tipo, bytes};
+}
+
+struct Pedido{
+    uint64_t huella = 0;
+    int32_t consulta = -1;
+    std::vector<std::pair<uint32_t,uint32_t>> evidencia;
+    std::vector<uint32_t> cutset;
+    uint64_t desde = 0, hasta = 0;
+
+    // mismo problema (sin mirar el rango): el trabajador reutiliza su plan
+    bool mismo_patron(const Pedido& o) const{
+        return huella==o.huella && consulta==o.consulta && evidencia==o.evidencia && cutset==o.cutset;
+    }
+    std::string codificar() const{
+        Escritor e;
+        e.u64(huella);
+        e.u32((uint32_t)consulta);
+        e.u32((uint32_t)evidencia.size());
+        for(const auto& p: evidencia){ e.u32(p.first); e.u32(p.second); }
+        e.u32((uint32_t)cutset.size());
+        for(uint32_t c: cutset) e.u32(c);
+        e.u64(desde);
+        e.u64(hasta);
+        return e.mensaje(SUMAR);
+    }
+    static Pedido decodificar(const std::string& carga){
+        Lector l(carga);
+        Pedido p;
+        p.huella = l.u64();
+        p.consulta = (int32_t)l.u32();
+        uint32_t n = l.u32();
+        if(n > carga.size()/8) throw std::runtime_error("Mensaje de cutset truncado");
+        for(uint32_t i=0;i<n;++i){ uint32_t v = l.u32(); p.evidencia.push_back({v, l.u32()}); }
+        uint32_t m = l.u32();
+        if(m > carga.size()/4) throw std::runtime_error("Mensaje de cutset truncado");
+        for(uint32_t i=0;i<m;++i) p.cutset.push_back(l.u32());
+        p.desde = l.u64();
+        p.hasta = l.u64();
+        l.fin();
+        return p;
+    }
+};
+
+uint64_t mezclar(uint64_t h, uint64_t x){
+    for(int i=0;i<8;++i){ h ^= (x>>(8*i)) & 0xFF; h *= 1099511628211ull; }
+    return h;
+}
+
+// huella del modelo: estructura, dominios y parámetros almacenados
+uint64_t huella_modelo(const AnalisisGrafo& g){
+    uint64_t h = 1469598103934665603ull;
+    auto texto = [&](const std::string& s){ for(unsigned char c: s) h = mezclar(h, c); h = mezclar(h, 0xFF); };
+    auto numero = [&](double x){ uint64_t u; std::memcpy(&u, &x, 8); h = mezclar(h, u); };
+    for(const Nodo* X: g.orden){
+        texto(X->nombre);
+        for(const auto& v: X->valores) texto(v);
+        const TablaProbabilidad* T = X->cpt.get();
+        if(!T || !T->finalizada()){ h = mezclar(h, 0); continue; }
+        h = mezclar(h, (uint64_t)T->tipo);
+        for(const Nodo* p: T->padres) h = mezclar(h, (uint64_t)p->id);
+        for(size_t i=0;i<T->num_datos();++i) numero(T->dato(i));
+        for(double x: T->defecto) numero(x);
+        for(double x: T->fuga) numero(x);
+        for(const auto& a: T->acumuladas) for(double x: a) numero(x);
+    }
+    return h;
+}
+
+// Σ_{c en [desde, hasta)} P(q, c, e) para una consulta, evidencia y
+// cutset fijos. Compila el plan del poliárbol una vez; cada instanciación
+// solo vuelve a reducir las CPTs que mencionan variables del cutset.
+class SumaCondicionada{
+public:
+    SumaCondicionada(const AnalisisGrafo& g, const Pedido& p, double max_entradas): g_(g), pedido_(p){
+        const size_t n = g.orden.size();
+        q_ = p.consulta;
+        if(q_<0 || (size_t)q_>=n) throw std::runtime_error("Consulta fuera de rango en el pedido de cutset");
+        ev_.assign(n, -1);
+        card_.assign(n, 0);
+        for(size_t v=0; v<n; ++v) card_[v] = g.orden[v]->valores.size();
+        auto comprobar = [&](uint32_t v, uint32_t k){
+            if(v>=n || k>=card_[v]) throw std::runtime_error("Variable o valor fuera de rango en el pedido de cutset");
+        };
+        for(const auto& e: p.evidencia){ comprobar(e.first, e.second); ev_[e.first] = (int)e.second; }
+        ev_[q_] = -1;
+        en_cutset_.assign(n, false);
+        for(uint32_t c: p.cutset){
+            comprobar(c, 0);
+            if((int)c==q_ || ev_[c]>=0) throw std::runtime_error("El cutset no puede incluir la consulta ni la evidencia");
+            en_cutset_[c] = true;
+            cutset_.push_back((int)c);
+        }
+
+        // poda: solo el cierre ancestral de consulta y evidencia
+        ConjuntoNodos fijados(n);
+        fijados.insertar((size_t)q_);
+        for(size_t v=0; v<n; ++v) if(ev_[v]>=0) fijados.insertar(v);
+        std::vector<bool> relevante(n, false);
+        g.cierre_ancestral(fijados).para_cada([&](size_t i){ relevante[i] = true; });
+        for(int c: cutset_)
+            if(!relevante[c]) throw std::runtime_error("El cutset incluye un nodo podado: "+g.orden[c]->nombre);
+
+        // factores: las variables del cutset actúan como evidencia. Cada
+        // familia se factoriza con auxiliar (un noisy-OR/MAX grande queda
+        // descompuesto); la forma no depende de los valores del cutset.
+        std::vector<std::vector<int>> alcances;
+        for(size_t v=0; v<n; ++v){
+            if(!relevante[v]) continue;
+            const Nodo* X = g.orden[v];
+            if(!X->cpt || !X->cpt->finalizada()) throw std::runtime_error(mensaje_sin_cpt(X));
+            Familia fam;
+            fam.nodo = (int)v;
+            fam.primero = alcances.size();
+            for(const Nodo* pa: X->cpt->padres){
+                if(pa->id<0 || pa->id>=(int)v)
+                    throw std::runtime_error("CPT de "+X->nombre+" usa un padre fuera de la estructura: "+pa->nombre);
+                fam.padres.push_back(pa->id);
+                if(en_cutset_[pa->id]) fam.variable = true;
+            }
+            if(en_cutset_[v]) fam.variable = true;
+            int aux = -1;
+            for(auto& f: factorizar(fam)){
+                std::vector<int> vars;
+                for(size_t k: f.padres_libres) vars.push_back(fam.padres[k]);
+                if(f.con_variable) vars.push_back((int)v);
+                if(f.con_auxiliar){
+                    if(aux<0){ aux = (int)card_.size(); card_.push_back(card_[v]); }
+                    vars.push_back(aux);
+                }
+                alcances.push_back(vars);
+                fam.piezas.push_back(std::move(f.valores));
+            }
+            familias_.push_back(std::move(fam));
+        }
+        std::vector<bool> conservar(card_.size(), false);
+        conservar[q_] = true;
+        std::vector<int> orden = orden_min_fill(alcances, card_, conservar);
+        coste_ = coste_eliminacion(alcances, card_, orden);
+        if(coste_.max_factor > max_entradas){
+            std::ostringstream os;
+            os << "El poliárbol condicionado necesita un factor de " << coste_.max_factor
+               << " entradas (máximo " << max_entradas << "): el cutset no corta todos los bucles";
+            throw std::runtime_error(os.str());
+        }
+        std::vector<AlcanceFactor> af;
+        for(const auto& a: alcances) af.push_back(AlcanceFactor::crear(a, card_));
+        plan_ = PlanEliminacion::compilar(af, card_, {q_}, orden);
+
+        // las familias que no tocan el cutset quedan con sus valores de aquí
+        datos_.resize(alcances.size());
+        for(Familia& fam: familias_) apuntar(fam);
+    }
+
+    const Pedido& pedido() const { return pedido_; }
+    double max_factor() const { return coste_.max_factor; }
+
+    // suma P(q=k, c, e) sobre las instanciaciones [desde, hasta) en `acum`
+    void sumar(uint64_t desde, uint64_t hasta, std::vector<double>& acum){
+        acum.assign(card_[q_], 0.0);
+        if(desde>=hasta) return;
+        // instanciación `desde` en base mixta (la última variable es la más rápida)
+        uint64_t r = desde;
+        for(size_t i=cutset_.size(); i-- > 0; ){
+            ev_[cutset_[i]] = (int)(r % card_[cutset_[i]]);
+            r /= card_[cutset_[i]];
+        }
+        std::vector<double> salida;
+        for(uint64_t c=desde; c<hasta; ++c){
+            for(Familia& fam: familias_){
+                if(!fam.variable) continue;
+                auto piezas = factorizar(fam);
+                for(size_t j=0;j<piezas.size();++j) fam.piezas[j] = std::move(piezas[j].valores);
+                apuntar(fam);
+            }
+            plan_.ejecutar(datos_, salida);
+            for(size_t k=0;k<salida.size();++k) acum[k] += salida[k];
+            // siguiente instanciación
+            for(size_t i=cutset_.size(); i-- > 0; ){
+                int& x = ev_[cutset_[i]];
+                if(++x < (int)card_[cutset_[i]]) break;
+                x = 0;
+            }
+        }
+    }
+
+private:
+    struct Familia{
+        int nodo = -1;
+        std::vector<int> padres;
+        bool variable = false;        // menciona el cutset: cambia con cada instanciación
+        size_t primero = 0;           // su primer factor en el plan
+        std::vector<std::vector<double>> piezas;
+    };
+    const AnalisisGrafo& g_;
+    Pedido pedido_;
+    int q_ = -1;
+    std::vector<int> ev_;             // evidencia más la instanciación actual del cutset
+    std::vector<size_t> card_;        // nodos y luego las auxiliares de los noisy descompuestos
+    std::vector<int> cutset_;
+    std::vector<bool> en_cutset_;
+    std::vector<Familia> familias_;
+    PlanEliminacion plan_;
+    CosteEliminacion coste_;
+    std::vector<const double*> datos_;
+
+    // la CPT de la familia con la evidencia y la instanciación actual
+    // (antes de la primera, el cutset vale 0: solo importa la forma)
+    std::vector<TablaProbabilidad::FactorLocal> factorizar(const Familia& fam) const{
+        std::vector<int> ev_padres;
+        for(int p: fam.padres) ev_padres.push_back(std::max(ev_[p], en_cutset_[p]? 0 : -1));
+        return g_.orden[fam.nodo]->cpt->factorizar(ev_padres, std::max(ev_[fam.nodo], en_cutset_[fam.nodo]? 0 : -1), true);
+    }
+    void apuntar(const Familia& fam){
+        for(size_t j=0;j<fam.piezas.size();++j) datos_[fam.primero+j] = fam.piezas[j].data();
+    }
+};
+
+// Responde un mensaje SUMAR con PARCIAL (o ERROR). `suma` guarda el plan
+// del último patrón para que los bloques siguientes lo reutilicen.
+std::string responder(const AnalisisGrafo& g, uint64_t huella, uint16_t tipo, const std::string& carga,
+                      std::unique_ptr<SumaCondicionada>& suma, double max_entradas){
+    try{
+        if(tipo!=SUMAR) throw std::runtime_error("Tipo de mensaje de cutset inesperado");
+        Pedido p = Pedido::decodificar(carga);
+        if(p.huella!=huella) throw std::runtime_error("El trabajador tiene otro modelo (huella distinta)");
+        if(!suma || !suma->pedido().mismo_patron(p)){
+            suma.reset();
+            suma = std::make_unique<SumaCondicionada>(g, p, max_entradas);
+        }
+        std::vector<double> acum;
+        suma->sumar(p.desde, p.hasta, acum);
+        Escritor e;
+        e.u64(p.desde);
+        e.u32((uint32_t)acum.size());
+        for(double x: acum) e.f64(x);
+        return e.mensaje(PARCIAL);
+    }catch(const std::exception& ex){
+        Escritor e;
+        e.texto(ex.what());
+        return e.mensaje(ERROR_CUTSET);
+    }
+}
+
+struct Parcial{ uint64_t desde = 0; std::vector<double> suma; };
+
+// PARCIAL -> suma del bloque; ERROR -> excepción con el mensaje del trabajador
+Parcial leer_respuesta(uint16_t tipo, const std::string& carga){
+    Lector l(carga);
+    if(tipo==ERROR_CUTSET) throw std::runtime_error(l.resto());
+    if(tipo!=PARCIAL) throw std::runtime_error("Tipo de mensaje de cutset inesperado");
+    Parcial p;
+    p.desde = l.u64();
+    uint32_t k = l.u32();
+    if(k > carga.size()/8) throw std::runtime_error("Mensaje de cutset truncado");
+    for(uint32_t i=0;i<k;++i) p.suma.push_back(l.f64());
+    l.fin();
+    return p;
+}
+
+#ifndef _WIN32
+void enviar_todo(int fd, const std::string& s){
+    size_t hecho = 0;
+    while(hecho<s.size()){
+        ssize_t k = ::send(fd, s.data()+hecho, s.size()-hecho, MSG_NOSIGNAL);
+        if(k<0 && errno==EINTR) continue;
+        if(k<=0) throw std::runtime_error(std::string("Error al enviar al trabajador: ")+std::strerror(errno));
+        hecho += (size_t)k;
+    }
+}
+
+// false si el otro extremo cerró antes del primer byte
+bool recibir_todo(int fd, char* buf, size_t n){
+    size_t hecho = 0;
+    while(hecho<n){
+        ssize_t k = ::recv(fd, buf+hecho, n-hecho, 0);
+        if(k<0 && errno==EINTR) continue;
+        if(k==0 && hecho==0) return false;
+        if(k<=0) throw std::runtime_error("Conexión de cutset cortada a mitad de un mensaje");
+        hecho += (size_t)k;
+    }
+    return true;
+}
+
+bool recibir_mensaje(int fd, uint16_t& tipo, std::string& carga){
+    char cab[CABECERA];
+    if(!recibir_todo(fd, cab, CABECERA)) return false;
+    auto tc = leer_cabecera(cab);
+    tipo = tc.first;
+    carga.resize(tc.second);
+    if(tc.second && !recibir_todo(fd, &carga[0], tc.second))
+        throw std::runtime_error("Conexión de cutset cortada a mitad de un mensaje");
+    return true;
+}
+#endif
+
+} // namespace
+
+std::vector<int> cutset_de_bucles(const AnalisisGrafo& g, const std::vector<bool>& relevante,
+                                  const std::vector<bool>& fijo, int excluir){
+    const size_t n = g.orden.size();
+    // esqueleto de la red condicionada: p - v para cada arco p -> v entre
+    // nodos relevantes cuyo padre no esté fijado
+    struct Arista{ uint32_t padre, hijo; bool viva; };
+    std::vector<Arista> aristas;
+    std::vector<std::vector<uint32_t>> incidentes(n);
+    for(size_t v=0; v<n; ++v){
+        if(!relevante[v]) continue;
+        for(uint32_t k=g.inicio_padres[v]; k<g.inicio_padres[v+1]; ++k){
+            uint32_t p = g.lista_padres[k];
+            if(!relevante[p] || fijo[p]) continue;
+            incidentes[p].push_back((uint32_t)aristas.size());
+            incidentes[v].push_back((uint32_t)aristas.size());
+            aristas.push_back({p, (uint32_t)v, true});
+        }
+    }
+    std::vector<size_t> grado(n, 0);
+    std::vector<bool> vivo(n, false);
+    for(size_t v=0; v<n; ++v){ vivo[v] = relevante[v]; grado[v] = incidentes[v].size(); }
+    auto quitar_arista = [&](uint32_t a){
+        if(!aristas[a].viva) return;
+        aristas[a].viva = false;
+        --grado[aristas[a].padre];
+        --grado[aristas[a].hijo];
+    };
+
+    std::vector<int> cutset;
+    std::vector<uint32_t> pila;
+    for(;;){
+        // se podan las hojas (grado <= 1): no están en ningún bucle
+        for(size_t v=0; v<n; ++v) if(vivo[v] && grado[v]<=1) pila.push_back((uint32_t)v);
+        while(!pila.empty()){
+            uint32_t v = pila.back(); pila.pop_back();
+            if(!vivo[v]) continue;
+            vivo[v] = false;
+            for(uint32_t a: incidentes[v]){
+                if(!aristas[a].viva) continue;
+                uint32_t o = aristas[a].padre==v? aristas[a].hijo : aristas[a].padre;
+                quitar_arista(a);
+                if(vivo[o] && grado[o]<=1) pila.push_back(o);
+            }
+        }
+        // lo que queda es el núcleo con bucles: se fija el nodo con más
+        // hijos dentro de él (a igualdad, el de menos valores)
+        int mejor = -1;
+        size_t mejor_salida = 0;
+        for(size_t v=0; v<n; ++v){
+            if(!vivo[v] || (int)v==excluir || fijo[v]) continue;
+            size_t salida = 0;
+            for(uint32_t a: incidentes[v]) if(aristas[a].viva && aristas[a].padre==v) ++salida;
+            if(!salida) continue;
+            if(mejor<0 || salida>mejor_salida ||
+               (salida==mejor_salida && g.orden[v]->valores.size() < g.orden[mejor]->valores.size())){
+                mejor = (int)v;
+                mejor_salida = salida;
+            }
+        }
+        if(mejor<0) break;   // sin núcleo (todo bucle tiene un nodo con un arco de salida en él)
+        cutset.push_back(mejor);
+        for(uint32_t a: incidentes[mejor]) if(aristas[a].padre==(uint32_t)mejor) quitar_arista(a);
+    }
+    std::sort(cutset.begin(), cutset.end());
+    return cutset;
+}
+
+void atender_cutset(const RedBayesiana& rb, int fd){
+#ifdef _WIN32
+    (void)rb; (void)fd;
+    throw std::runtime_error("atender_cutset no está disponible en Windows");
+#else
+    const AnalisisGrafo& g = rb.grafo();
+    const uint64_t huella = huella_modelo(g);
+    std::unique_ptr<SumaCondicionada> suma;
+    uint16_t tipo = 0;
+    std::string carga;
+    while(recibir_mensaje(fd, tipo, carga))
+        enviar_todo(fd, responder(g, huella, tipo, carga, suma, OpcionesCutset().max_entradas));
+#endif
+}
+
+InferenciaCutset::InferenciaCutset(const RedBayesiana& rb, const OpcionesCutset& op): rb_(rb), op_(op){
+    if(op.trabajadores>MAX_TRABAJADORES_CUTSET)
+        throw std::runtime_error("Demasiados trabajadores: "+std::to_string(op.trabajadores)+
+                                 " (máximo "+std::to_string(MAX_TRABAJADORES_CUTSET)+")");
+    huella_ = huella_modelo(rb.grafo());
+}
+
+InferenciaCutset::~InferenciaCutset(){ cerrar(); }
+
+void InferenciaCutset::cerrar(){
+#ifndef _WIN32
+    // al cerrar el socket el trabajador lee EOF y termina
+    for(Trabajador& t: trabajadores_) if(t.fd>=0) ::close(t.fd);
+    for(Trabajador& t: trabajadores_){
+        if(t.pid<=0) continue;
+        int estado = 0;
+        while(::waitpid((pid_t)t.pid, &estado, 0)<0 && errno==EINTR) {}
+    }
+#endif
+    trabajadores_.clear();
+}
+
+void InferenciaCutset::arrancar(unsigned n){
+#ifdef _WIN32
+    (void)n;
+#else
+    const AnalisisGrafo& g = rb_.grafo();   // se calcula antes de fork
+    const uint64_t huella = huella_;
+    const double max_entradas = op_.max_entradas;
+    // lo pendiente en los buffers no debe imprimirse dos veces
+    std::cout.flush();
+    std::cerr.flush();
+    for(unsigned i=0; i<n; ++i){
+        int par[2];
+        if(::socketpair(AF_UNIX, SOCK_STREAM, 0, par)<0){
+            cerrar();
+            throw std::runtime_error(std::string("No se pudo crear el socket del trabajador: ")+std::strerror(errno));
+        }
+        pid_t pid = ::fork();
+        if(pid<0){
+            ::close(par[0]); ::close(par[1]);
+            cerrar();
+            throw std::runtime_error(std::string("No se pudo crear el trabajador: ")+std::strerror(errno));
+        }
+        if(pid==0){
+            // trabajador: solo su extremo del socket; nunca vuelve
+            ::close(par[0]);
+            for(const Trabajador& t: trabajadores_) ::close(t.fd);
+            int codigo = 0;
+            try{
+                std::unique_ptr<SumaCondicionada> suma;
+                uint16_t tipo = 0;
+                std::string carga;
+                while(recibir_mensaje(par[1], tipo, carga))
+                    enviar_todo(par[1], responder(g, huella, tipo, carga, suma, max_entradas));
+            }catch(...){ codigo = 1; }
+            ::_exit(codigo);
+        }
+        ::close(par[1]);
+        trabajadores_.push_back({par[0], (long)pid});
+    }
+#endif
+}
+
+ResultadoCutset InferenciaCutset::consultar(const std::string& variable,
+                                            const std::unordered_map<std::string,std::string>& evidencia){
+    const AnalisisGrafo& g = rb_.grafo();
+    const size_t n = g.orden.size();
+    const Nodo* Q = rb_.obtener(variable);
+    if(!Q) throw std::runtime_error("Variable desconocida: "+variable);
+    const int q = Q->id;
+
+    Pedido base;
+    base.huella = huella_;
+    base.consulta = q;
+    std::vector<bool> fijo(n, false);
+    ConjuntoNodos fijados(n);
+    fijados.insertar((size_t)q);
+    for(const auto& kv: evidencia){
+        const Nodo* X = rb_.obtener(kv.first);
+        if(!X) throw std::runtime_error("Variable desconocida: "+kv.first);
+        if(X->id==q) continue;
+        auto it = std::find(X->valores.begin(), X->valores.end(), kv.second);
+        if(it==X->valores.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        base.evidencia.push_back({(uint32_t)X->id, (uint32_t)(it-X->valores.begin())});
+        fijo[X->id] = true;
+        fijados.insertar((size_t)X->id);
+    }
+    std::sort(base.evidencia.begin(), base.evidencia.end());
+
+    std::vector<bool> relevante(n, false);
+    g.cierre_ancestral(fijados).para_cada([&](size_t i){ relevante[i] = true; });
+    std::vector<int> cutset = cutset_de_bucles(g, relevante, fijo, q);
+
+    ResultadoCutset res;
+    res.instanciaciones = 1;
+    for(int c: cutset){
+        const uint64_t k = g.orden[c]->valores.size();
+        if(k==0 || res.instanciaciones > (UINT64_MAX>>1)/k)
+            throw std::runtime_error("El cutset tiene demasiadas instanciaciones");
+        res.instanciaciones *= k;
+        base.cutset.push_back((uint32_t)c);
+        res.cutset.push_back(g.orden[c]);
+    }
+
+    // el plan se comprueba aquí antes de repartir (errores de la red o
+    // factores demasiado grandes no llegan a los trabajadores)
+    std::unique_ptr<SumaCondicionada> local = std::make_unique<SumaCondicionada>(g, base, op_.max_entradas);
+    res.max_factor = local->max_factor();
+
+#ifdef _WIN32
+    const unsigned trabajadores = 0;
+#else
+    unsigned trabajadores = op_.trabajadores? op_.trabajadores :
+        std::min(MAX_TRABAJADORES_CUTSET, std::max(1u, std::thread::hardware_concurrency()));
+    // no se crean más procesos que bloques
+    trabajadores = (unsigned)std::min<uint64_t>(trabajadores, res.instanciaciones);
+#endif
+    const uint64_t bloques = std::max<uint64_t>(1, std::min<uint64_t>(res.instanciaciones,
+                                 (uint64_t)std::max(1u, trabajadores)*std::max<size_t>(1, op_.bloques_por_trabajador)));
+    res.bloques = (size_t)bloques;
+    auto rango = [&](uint64_t b){
+        // [desde, hasta) del bloque b, sin desbordar con muchas instanciaciones
+        const uint64_t t = res.instanciaciones, q0 = t/bloques, r0 = t%bloques;
+        const uint64_t desde = b*q0 + std::min(b, r0);
+        return std::make_pair(desde, desde + q0 + (b<r0? 1 : 0));
+    };
+    std::vector<Parcial> parciales(bloques);
+    auto pedido = [&](uint64_t b){
+        Pedido p = base;
+        std::tie(p.desde, p.hasta) = rango(b);
+        return p.codificar();
+    };
+
+    if(trabajadores<=1 || bloques==1){
+        // en este proceso, con los mismos mensajes que irían por el socket
+        std::unique_ptr<SumaCondicionada> suma = std::move(local);
+        for(uint64_t b=0; b<bloques; ++b){
+            std::string m = pedido(b);
+            auto tc = leer_cabecera(m.data());
+            std::string r = responder(g, huella_, tc.first, m.substr(CABECERA), suma, op_.max_entradas);
+            tc = leer_cabecera(r.data());
+            parciales[b] = leer_respuesta(tc.first, r.substr(CABECERA));
+        }
+        res.trabajadores = 0;
+    }else{
+#ifndef _WIN32
+        if(trabajadores_.size()!=trabajadores){
+            cerrar();
+            arrancar(trabajadores);
+        }
+        // cada trabajador recibe un bloque y, al responder, el siguiente
+        std::vector<int64_t> en_curso(trabajadores, -1);
+        uint64_t siguiente = 0, pendientes = 0;
+        std::string error;
+        auto asignar = [&](unsigned t){
+            if(siguiente>=bloques || !error.empty()) return;
+            enviar_todo(trabajadores_[t].fd, pedido(siguiente));
+            en_curso[t] = (int64_t)siguiente++;
+            ++pendientes;
+        };
+        try{
+            for(unsigned t=0; t<trabajadores; ++t) asignar(t);
+            std::vector<pollfd> pfd(trabajadores);
+            while(pendientes){
+                for(unsigned t=0; t<trabajadores; ++t) pfd[t] = {trabajadores_[t].fd, POLLIN, 0};
+                if(::poll(pfd.data(), pfd.size(), -1)<0){
+                    if(errno==EINTR) continue;
+                    throw std::runtime_error(std::string("Error en poll: ")+std::strerror(errno));
+                }
+                for(unsigned t=0; t<trabajadores; ++t){
+                    if(!(pfd[t].revents & (POLLIN|POLLHUP|POLLERR)) || en_curso[t]<0) continue;
+                    uint16_t tipo = 0;
+                    std::string carga;
+                    if(!recibir_mensaje(trabajadores_[t].fd, tipo, carga))
+                        throw std::runtime_error("El trabajador "+std::to_string(t)+" terminó inesperadamente");
+                    const uint64_t b = (uint64_t)en_curso[t];
+                    en_curso[t] = -1;
+                    --pendientes;
+                    // un error se guarda y se siguen recogiendo las respuestas en
+                    // curso, para que no queden mensajes viejos en los sockets
+                    try{ parciales[b] = leer_respuesta(tipo, carga); }
+                    catch(const std::exception& ex){ if(error.empty()) error = ex.what(); }
+                    asignar(t);
+                }
+            }
+        }catch(...){
+            // con el protocolo a medias los trabajadores no se reutilizan
+            cerrar();
+            throw;
+        }
+        if(!error.empty()) throw std::runtime_error(error);
+        res.trabajadores = trabajadores;
+#endif
+    }
+
+    // suma en orden de bloque: el resultado no depende del reparto
+    std::vector<double> total(Q->valores.size(), 0.0);
+    for(const Parcial& p: parciales){
+        if(p.suma.size()!=total.size()) throw std::runtime_error("Respuesta de cutset con tamaño incorrecto");
+        for(size_t k=0;k<total.size();++k) total[k] += p.suma[k];
+    }
+    double z = 0;
+    for(double x: total) z += x;
+    if(!(z>0)) throw std::runtime_error("Evidencia con probabilidad 0");
+    res.prob_evidencia = z;
+    for(size_t k=0;k<total.size();++k) res.distribucion.push_back({Q->valores[k], total[k]/z});
+    return res;
+}
@@ -0,0 +1,90 @@
+#ifndef CUTSET_H
+#define CUTSET_H
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct RedBayesiana; struct Nodo; struct AnalisisGrafo;
+
+// Inferencia exacta por condicionamiento sobre un cutset de bucles,
+// repartida entre procesos trabajadores.
+//
+// Tras podar los nodos fuera del cierre ancestral de consulta y evidencia,
+// se elige un cutset C voraz: se quitan las hojas del esqueleto y, mientras
+// quede un bucle, se instancia el nodo libre con más arcos de salida dentro
+// de él (un nodo fijado corta sus arcos hacia los hijos; la evidencia ya
+// los corta). Con C fijado la red que queda es un poliárbol, así que
+//   P(q, e) = Σ_c P(q, c, e)
+// se resuelve con una eliminación de variables sin relleno por cada
+// instanciación c: el plan se compila una vez y solo se recalculan los
+// factores de C y de sus hijos. Memoria lineal; tiempo Π card(C) veces el
+// de un poliárbol.
+//
+// Las instanciaciones (numeradas en base mixta, la última variable de C
+// la más rápida) se parten en bloques que se reparten entre trabajadores:
+// procesos hijos (fork) que heredan el modelo ya cargado y hablan con el
+// proceso principal por un socket Unix con un protocolo binario propio
+// (ver cutset.cpp). Cada bloque devuelve su suma parcial y el principal
+// las suma en orden de bloque, así que el resultado no depende del
+// reparto. Sin fork (_WIN32) o con un solo trabajador, los bloques se
+// atienden en el mismo proceso con los mismos mensajes.
+// tope de procesos trabajadores: cada uno es un fork del proceso entero
+constexpr unsigned MAX_TRABAJADORES_CUTSET = 64;
+
+struct OpcionesCutset{
+    unsigned trabajadores = 0;            // 0 = uno por núcleo; como mucho MAX_TRABAJADORES_CUTSET
+    size_t bloques_por_trabajador = 8;    // bloques más chicos reparten mejor la carga
+    double max_entradas = double(1<<26);  // mayor factor permitido por instanciación
+};
+
+struct ResultadoCutset{
+    std::vector<std::pair<std::string,double>> distribucion;
+    double prob_evidencia = 0;            // P(e)
+    std::vector<const Nodo*> cutset;
+    uint64_t instanciaciones = 0;
+    size_t bloques = 0;
+    unsigned trabajadores = 0;            // procesos usados (0 = en este proceso)
+    double max_factor = 0;                // entradas del mayor factor por instanciación
+};
+
+// Cutset de bucles de la red condicionada: `relevante` marca los nodos
+// tras la poda, `fijo` los observados (sus arcos de salida ya están
+// cortados) y `excluir` un nodo que no puede entrar (la consulta).
+std::vector<int> cutset_de_bucles(const AnalisisGrafo& g, const std::vector<bool>& relevante,
+                                  const std::vector<bool>& fijo, int excluir);
+
+// Atiende pedidos del protocolo por `fd` hasta que el otro extremo lo
+// cierra. Es lo que ejecuta cada trabajador; un servidor remoto con el
+// mismo modelo puede atender igual un socket TCP.
+void atender_cutset(const RedBayesiana& rb, int fd);
+
+class InferenciaCutset{
+public:
+    // lanza si op.trabajadores pasa de MAX_TRABAJADORES_CUTSET
+    explicit InferenciaCutset(const RedBayesiana& rb, const OpcionesCutset& op = OpcionesCutset());
+    // cierra los sockets y espera a los trabajadores
+    ~InferenciaCutset();
+    InferenciaCutset(const InferenciaCutset&) = delete;
+    InferenciaCutset& operator=(const InferenciaCutset&) = delete;
+
+    // la evidencia sobre la propia consulta se ignora, como en CONSULTAR
+    ResultadoCutset consultar(const std::string& variable,
+                              const std::unordered_map<std::string,std::string>& evidencia);
+
+    const OpcionesCutset& opciones() const { return op_; }
+
+private:
+    struct Trabajador{ int fd = -1; long pid = -1; };
+    const RedBayesiana& rb_;
+    OpcionesCutset op_;
+    uint64_t huella_ = 0;                 // identifica el modelo en los mensajes
+    std::vector<Trabajador> trabajadores_; // se crean en la primera consulta
+
+    void arrancar(unsigned n);
+    void cerrar();
+};
+
+#endif // CUTSET_H
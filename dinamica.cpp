@@ -0,0 +1,243 @@
+#include "dinamica.h"
+#include "factor.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include "util.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const std::string SUFIJO_ANTERIOR = "(t-1)";
+const std::string SUFIJO_INICIAL = "(0)";
+
+bool termina_en(const std::string& s, const std::string& suf){
+    return s.size()>=suf.size() && s.compare(s.size()-suf.size(), suf.size(), suf)==0;
+}
+
+std::string quitar_todos(std::string s, const std::string& sub){
+    for(size_t p; (p = s.find(sub))!=std::string::npos; ) s.erase(p, sub.size());
+    return s;
+}
+
+} // namespace
+
+// factores de una de las dos redes (t=0 o transición) y sus planes
+struct FiltroDinamico::Modelo{
+    std::vector<size_t> card;                 // por Nodo::id
+    std::vector<AlcanceFactor> factores;      // CPTs, evidencia y (en transición) creencia
+    std::vector<std::vector<double>> datos;
+    std::vector<uint32_t> lambda;             // factor de evidencia de cada variable de la rebanada
+    uint32_t creencia = UINT32_MAX;           // factor de la creencia de t-1
+    PlanEliminacion plan_creencia;
+    std::vector<PlanEliminacion> plan_consulta;
+
+    Modelo(const RedBayesiana& rb, const RedDinamica& dbn, bool con_creencia,
+           const std::vector<std::string>& consulta){
+        const AnalisisGrafo& g = rb.grafo();
+        for(const Nodo* X: g.orden) card.push_back(X->valores.size());
+
+        // un factor por CPT, con el mismo orden que sus filas (padres y variable)
+        for(const Nodo* X: g.orden){
+            if(termina_en(X->nombre, SUFIJO_ANTERIOR)) continue;
+            if(!X->cpt || !X->cpt->finalizada())
+                throw std::runtime_error(mensaje_sin_cpt(X));
+            const TablaProbabilidad& T = *X->cpt;
+            T.exigir_densa("El filtro dinámico");
+            std::vector<int> vars;
+            for(const Nodo* p: T.padres) vars.push_back(p->id);
+            vars.push_back(X->id);
+            factores.push_back(AlcanceFactor::crear(vars, card));
+            std::vector<double> d;
+            d.reserve(factores.back().tam);
+            for(size_t fila=0; fila<T.num_filas(); ++fila)
+                for(size_t k=0; k<card[X->id]; ++k){
+                    double p = T.prob(fila, k);
+                    if(std::isnan(p)) throw std::runtime_error("CPT incompleta: "+X->nombre);
+                    d.push_back(p);
+                }
+            datos.push_back(std::move(d));
+        }
+        auto id = [&](const std::string& nombre){
+            const Nodo* X = rb.obtener(nombre);
+            if(!X) throw std::runtime_error("Variable desconocida: "+nombre);
+            return X->id;
+        };
+        for(const auto& v: dbn.variables){
+            lambda.push_back((uint32_t)factores.size());
+            factores.push_back(AlcanceFactor::crear({id(v)}, card));
+            datos.push_back(std::vector<double>(card[id(v)], 1.0));
+        }
+        if(con_creencia){
+            std::vector<int> vars;
+            for(const auto& v: dbn.interfaz) vars.push_back(id(RedDinamica::anterior(v)));
+            creencia = (uint32_t)factores.size();
+            factores.push_back(AlcanceFactor::crear(vars, card));
+            datos.emplace_back(); // la creencia se lee directamente del filtro
+        }
+
+        std::vector<int> interfaz;
+        for(const auto& v: dbn.interfaz) interfaz.push_back(id(v));
+        plan_creencia = PlanEliminacion::compilar(factores, card, interfaz);
+        for(const auto& q: consulta) plan_consulta.push_back(PlanEliminacion::compilar(factores, card, {id(q)}));
+    }
+};
+
+void RedDinamica::cargar(const std::string& ruta_estructura, const std::string& ruta_cpts){
+    std::ifstream fe(ruta_estructura);
+    if(!fe) throw std::runtime_error("No se puede abrir estructura: "+ruta_estructura);
+    std::ifstream fc(ruta_cpts);
+    if(!fc) throw std::runtime_error("No se puede abrir CPTs: "+ruta_cpts);
+
+    // estructura: los arcos desde t-1 solo existen en la transición
+    std::stringstream est_inicial, est_transicion;
+    std::vector<std::string> anteriores;
+    std::string linea;
+    while(std::getline(fe, linea)){
+        std::string t = recortar(linea);
+        if(t.empty() || t[0]=='#') continue;
+        est_transicion << t << "\n";
+        auto flecha = t.find("->");
+        std::string padre = recortar(t.substr(0, flecha));
+        if(termina_en(padre, SUFIJO_ANTERIOR)) anteriores.push_back(padre);
+        else est_inicial << t << "\n";
+    }
+
+    // CPTs: se separan por bloques NODE ... END. Los bloques "X(0)" van a
+    // la rebanada 0 (sin el sufijo); el resto a la transición y, si la
+    // variable no tiene bloque X(0), también a la rebanada 0
+    struct Bloque{ std::string nombre, texto; bool inicial = false, temporal = false; };
+    std::vector<Bloque> bloques;
+    std::unordered_map<std::string, std::vector<std::string>> valores;
+    Bloque* actual = nullptr;
+    while(std::getline(fc, linea)){
+        std::string t = recortar(linea);
+        if(t.empty() || t[0]=='#') continue;
+        if(t.rfind("NODE ",0)==0){
+            bloques.emplace_back();
+            actual = &bloques.back();
+            actual->nombre = recortar(t.substr(5));
+            if(termina_en(actual->nombre, SUFIJO_INICIAL)){
+                actual->inicial = true;
+                actual->nombre.resize(actual->nombre.size()-SUFIJO_INICIAL.size());
+            }
+            actual->texto = "NODE "+actual->nombre+"\n";
+            continue;
+        }
+        if(!actual) throw std::runtime_error("Línea fuera de un bloque NODE en CPTs: "+t);
+        if(t.rfind("VALUES:",0)==0) valores[actual->nombre] = dividir(recortar(t.substr(7)), ' ');
+        if(t.rfind("PARENTS:",0)==0){
+            for(auto& p: dividir(recortar(t.substr(8)), ' '))
+                if(termina_en(p, SUFIJO_ANTERIOR)){
+                    if(actual->inicial)
+                        throw std::runtime_error("La rebanada 0 no puede depender de t-1: NODE "+actual->nombre+"(0)");
+                    actual->temporal = true;
+                    anteriores.push_back(p);
+                }
+        }
+        actual->texto += (actual->inicial? quitar_todos(t, SUFIJO_INICIAL) : t) + "\n";
+        if(t=="END") actual = nullptr;
+    }
+    std::stringstream cpt_inicial, cpt_transicion;
+    for(const auto& b: bloques){
+        if(b.inicial){ cpt_inicial << b.texto; continue; }
+        cpt_transicion << b.texto;
+        bool tiene_inicial = std::any_of(bloques.begin(), bloques.end(),
+                                         [&](const Bloque& o){ return o.inicial && o.nombre==b.nombre; });
+        if(tiene_inicial) continue;
+        if(b.temporal) throw std::runtime_error("Falta NODE "+b.nombre+"(0) (su CPT depende de t-1)");
+        cpt_inicial << b.texto;
+    }
+
+    transicion.cargar_estructura(est_transicion);
+    // los nodos "X(t-1)" no tienen CPT: toman el dominio de X antes de
+    // cargar las tablas que los usan como padres
+    for(const auto& a: anteriores){
+        std::string x = a.substr(0, a.size()-SUFIJO_ANTERIOR.size());
+        auto it = valores.find(x);
+        if(it==valores.end()) throw std::runtime_error("Arco desde "+a+" pero "+x+" no tiene CPT");
+        transicion.obtener_o_crear(a)->valores = it->second;
+    }
+    transicion.cargar_cpts(cpt_transicion);
+    inicial.cargar_estructura(est_inicial);
+    inicial.cargar_cpts(cpt_inicial);
+
+    variables.clear();
+    interfaz.clear();
+    for(const Nodo* X: transicion.grafo().orden){
+        if(!termina_en(X->nombre, SUFIJO_ANTERIOR)){ variables.push_back(X->nombre); continue; }
+        if(!X->padres.empty() || X->cpt)
+            throw std::runtime_error(X->nombre+" no puede tener padres ni CPT");
+    }
+    for(const auto& v: variables){
+        if(transicion.obtener(anterior(v))) interfaz.push_back(v);
+        const Nodo* X0 = inicial.obtener(v);
+        if(!X0) throw std::runtime_error("La rebanada 0 no define "+v);
+        if(X0->valores!=transicion.obtener(v)->valores)
+            throw std::runtime_error("VALUES distintos en "+v+" y "+v+"(0)");
+    }
+    if(inicial.nodos.size()!=variables.size())
+        throw std::runtime_error("La rebanada 0 tiene variables que no están en la transición");
+}
+
+FiltroDinamico::FiltroDinamico(const RedDinamica& dbn, const std::vector<std::string>& consulta)
+    : dbn_(dbn), consulta_(consulta){
+    if(consulta_.empty()) consulta_ = dbn.variables;
+    inicial_ = std::make_unique<Modelo>(dbn.inicial, dbn, false, consulta_);
+    transicion_ = std::make_unique<Modelo>(dbn.transicion, dbn, true, consulta_);
+    marg_.resize(consulta_.size());
+}
+
+FiltroDinamico::~FiltroDinamico() = default;
+
+double FiltroDinamico::avanzar(const std::vector<int>& ev){
+    Modelo& m = t_==0? *inicial_ : *transicion_;
+    if(ev.size()!=dbn_.variables.size())
+        throw std::runtime_error("La evidencia debe tener un valor por variable de la rebanada");
+
+    // evidencia como factores indicadores: mismas formas en todos los pasos
+    for(size_t v=0; v<ev.size(); ++v){
+        std::vector<double>& l = m.datos[m.lambda[v]];
+        if(ev[v]>=(int)l.size())
+            throw std::runtime_error("Índice de valor fuera de rango para "+dbn_.variables[v]);
+        for(size_t k=0;k<l.size();++k) l[k] = (ev[v]<0 || ev[v]==(int)k)? 1.0 : 0.0;
+    }
+    std::vector<const double*> datos;
+    for(const auto& d: m.datos) datos.push_back(d.data());
+    if(m.creencia!=UINT32_MAX) datos[m.creencia] = creencia_.data();
+
+    // P(I_t, e_t | e_1..t-1): su suma es P(e_t | e_1..t-1)
+    std::vector<double> nueva;
+    m.plan_creencia.ejecutar(datos, nueva);
+    double z = 0;
+    for(double x: nueva) z += x;
+    if(!(z>0))
+        throw std::runtime_error("Evidencia con probabilidad 0 en el paso "+std::to_string(t_));
+    for(double& x: nueva) x /= z;
+
+    for(size_t q=0; q<consulta_.size(); ++q){
+        m.plan_consulta[q].ejecutar(datos, marg_[q]);
+        for(double& x: marg_[q]) x /= z;
+    }
+    creencia_.swap(nueva);
+    ++t_;
+    logv_ += std::log(z);
+    return std::log(z);
+}
+
+std::vector<int> FiltroDinamico::indices_evidencia(
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    std::vector<int> ev(dbn_.variables.size(), -1);
+    for(const auto& kv: evidencia){
+        auto it = std::find(dbn_.variables.begin(), dbn_.variables.end(), kv.first);
+        if(it==dbn_.variables.end()) throw std::runtime_error("Variable desconocida: "+kv.first);
+        const auto& dom = dbn_.transicion.obtener(kv.first)->valores;
+        auto jt = std::find(dom.begin(), dom.end(), kv.second);
+        if(jt==dom.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        ev[it-dbn_.variables.begin()] = (int)(jt-dom.begin());
+    }
+    return ev;
+}
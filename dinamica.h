@@ -0,0 +1,70 @@
+#ifndef DINAMICA_H
+#define DINAMICA_H
+#include "red_bayesiana.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Red bayesiana dinámica de dos rebanadas (2TBN). Se escribe con la misma
+// sintaxis que una red estática más dos extensiones:
+//  - estructura: "X(t-1) -> Y" es un arco entre rebanadas (de X en t-1 a
+//    Y en t); el resto de arcos son dentro de la rebanada;
+//  - CPTs: "NODE X" es la CPT de transición P(X_t | padres), que puede
+//    tener padres "Y(t-1)"; "NODE X(0)" es la de la primera rebanada. Una
+//    variable sin padres en t-1 puede omitir su bloque X(0) y se usa el
+//    de transición también en t=0.
+// Se guardan como dos redes estáticas: `inicial` (rebanada 0) y
+// `transicion` (nodos "X(t-1)" sin CPT más la rebanada t).
+struct RedDinamica{
+    RedBayesiana inicial;
+    RedBayesiana transicion;
+    std::vector<std::string> variables; // variables de una rebanada (orden topológico)
+    std::vector<std::string> interfaz;  // las que tienen hijos en la rebanada siguiente
+
+    void cargar(const std::string& ruta_estructura, const std::string& ruta_cpts);
+    static std::string anterior(const std::string& x){ return x+"(t-1)"; }
+};
+
+// Filtrado hacia adelante en línea: consume una rebanada de evidencia por
+// llamada y solo conserva la creencia conjunta P(I_t | e_1..t) sobre las
+// variables de la interfaz. Cada paso elimina la rebanada t del producto
+// creencia(t-1) · CPTs de transición · evidencia(t), así que memoria y
+// latencia por paso son constantes, sin importar la longitud del flujo.
+//
+// Los órdenes de eliminación (min-fill) y las formas de todos los factores
+// se fijan en el constructor: un plan para la nueva creencia y uno por
+// variable de consulta, tanto para t=0 como para la transición. En cada
+// paso solo cambian los factores de evidencia y la creencia.
+class FiltroDinamico{
+public:
+    FiltroDinamico(const RedDinamica& dbn, const std::vector<std::string>& consulta);
+    ~FiltroDinamico();
+
+    // Incorpora la siguiente rebanada. `ev` tiene un índice de valor por
+    // variable de dbn.variables (-1 = no observada). Devuelve
+    // log P(e_t | e_1..t-1); lanza si la evidencia tiene probabilidad 0.
+    double avanzar(const std::vector<int>& ev);
+
+    // P(q_t | e_1..t) para cada variable de consulta tras el último paso
+    const std::vector<std::vector<double>>& marginales() const { return marg_; }
+    const std::vector<std::string>& consulta() const { return consulta_; }
+    size_t pasos() const { return t_; }
+    double log_verosimilitud() const { return logv_; }
+
+    // índice de valor por variable de la rebanada (nombres -> índices)
+    std::vector<int> indices_evidencia(const std::unordered_map<std::string,std::string>& evidencia) const;
+
+private:
+    struct Modelo;
+    const RedDinamica& dbn_;
+    std::vector<std::string> consulta_;
+    std::unique_ptr<Modelo> inicial_;
+    std::unique_ptr<Modelo> transicion_;
+    std::vector<double> creencia_;                // P(I_t | e_1..t), interfaz en orden de dbn.interfaz
+    std::vector<std::vector<double>> marg_;
+    size_t t_ = 0;
+    double logv_ = 0;
+};
+
+#endif // DINAMICA_H
@@ -0,0 +1,106 @@
+#include "dseparacion.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include <algorithm>
+#include <stdexcept>
+
+DSeparacion::DSeparacion(const RedBayesiana& rb)
+    : rb_(rb), g_(rb.grafo()),
+      desde_hijo_(g_.num_nodos(), 0), desde_padre_(g_.num_nodos(), 0){
+    pila_.reserve(2*g_.num_nodos());
+}
+
+ConjuntoNodos DSeparacion::conjunto(const std::vector<std::string>& nombres) const{
+    ConjuntoNodos s = g_.vacio();
+    for(const auto& n: nombres){
+        const Nodo* X = rb_.obtener(n);
+        if(!X) throw std::runtime_error("Variable desconocida: "+n);
+        s.insertar((size_t)X->id);
+    }
+    return s;
+}
+
+// Bayes-ball: la "pelota" viaja por los arcos en estados (nodo, sentido).
+//  - llega desde un hijo y el nodo no está en Z: sigue a padres e hijos;
+//  - llega desde un padre: sigue a los hijos si el nodo no está en Z, y
+//    rebota hacia los padres si el nodo es Z o ancestro de Z (estructura
+//    en v activada).
+// Los nodos de X arrancan como si llegaran desde un hijo.
+bool DSeparacion::recorrer(const ConjuntoNodos& x, const ConjuntoNodos& z,
+                           ConjuntoNodos& alcanzados, const ConjuntoNodos* objetivo){
+    if(++epoca_==0){
+        std::fill(desde_hijo_.begin(), desde_hijo_.end(), 0);
+        std::fill(desde_padre_.begin(), desde_padre_.end(), 0);
+        epoca_ = 1;
+    }
+    const ConjuntoNodos activa_v = g_.cierre_ancestral(z);
+    pila_.clear();
+    x.para_cada([&](size_t i){ pila_.push_back((uint64_t)i << 1); });
+
+    while(!pila_.empty()){
+        const uint64_t e = pila_.back(); pila_.pop_back();
+        const uint32_t v = (uint32_t)(e >> 1);
+        const bool desde_padre = e & 1u;
+        uint32_t& marca = desde_padre? desde_padre_[v] : desde_hijo_[v];
+        if(marca==epoca_) continue;
+        marca = epoca_;
+
+        const bool observado = z.contiene(v);
+        if(!observado){
+            if(objetivo && objetivo->contiene(v)) return true;
+            alcanzados.insertar(v);
+        }
+        const bool a_padres = desde_padre? activa_v.contiene(v) : !observado;
+        const bool a_hijos = !observado;
+        if(a_padres)
+            for(uint32_t k=g_.inicio_padres[v]; k<g_.inicio_padres[v+1]; ++k)
+                if(desde_hijo_[g_.lista_padres[k]]!=epoca_) pila_.push_back((uint64_t)g_.lista_padres[k] << 1);
+        if(a_hijos)
+            for(uint32_t k=g_.inicio_hijos[v]; k<g_.inicio_hijos[v+1]; ++k)
+                if(desde_padre_[g_.lista_hijos[k]]!=epoca_) pila_.push_back(((uint64_t)g_.lista_hijos[k] << 1) | 1u);
+    }
+    return false;
+}
+
+ConjuntoNodos DSeparacion::alcanzables(const ConjuntoNodos& x, const ConjuntoNodos& z){
+    ConjuntoNodos r = g_.vacio();
+    recorrer(x, z, r, nullptr);
+    r -= x;
+    return r;
+}
+
+bool DSeparacion::independiente(const ConjuntoNodos& x, const ConjuntoNodos& y, const ConjuntoNodos& z){
+    // los nodos de Y que están en Z o en X no cuentan: se quitan del objetivo
+    ConjuntoNodos objetivo = y;
+    objetivo -= z;
+    objetivo -= x;
+    if(objetivo.vacio()) return true;
+    ConjuntoNodos r = g_.vacio();
+    return !recorrer(x, z, r, &objetivo);
+}
+
+ConjuntoNodos DSeparacion::separados(const ConjuntoNodos& x, const ConjuntoNodos& z){
+    ConjuntoNodos r = g_.vacio();
+    for(size_t i=0;i<g_.num_nodos();++i) r.insertar(i);
+    r -= alcanzables(x, z);
+    r -= x;
+    r -= z;
+    return r;
+}
+
+std::vector<bool> DSeparacion::independientes(const std::vector<ConsultaIndependencia>& consultas){
+    std::vector<bool> res(consultas.size());
+    ConjuntoNodos alc = g_.vacio();
+    const ConsultaIndependencia* previa = nullptr;
+    for(size_t q=0; q<consultas.size(); ++q){
+        const ConsultaIndependencia& c = consultas[q];
+        if(!previa || previa->x!=c.x || previa->z!=c.z){
+            alc = alcanzables(c.x, c.z);
+            previa = &c;
+        }
+        ConjuntoNodos objetivo = c.y;
+        objetivo -= c.x;
+        res[q] = !alc.intersecta(objetivo);
+    }
+    return res;
+}
@@ -0,0 +1,55 @@
+#ifndef DSEPARACION_H
+#define DSEPARACION_H
+#include "grafo.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RedBayesiana;
+
+// una consulta "X ⊥ Y | Z" con conjuntos indexados por Nodo::id
+struct ConsultaIndependencia{
+    ConjuntoNodos x, y, z;
+};
+
+// d-separación por Bayes-ball (Shachter, 1998) sobre el grafo en CSR de
+// RedBayesiana::grafo(). Cada consulta cuesta O(|Z|·n/64) para el cierre
+// ancestral de Z más un recorrido lineal en los arcos alcanzados.
+//
+// Las marcas de visita usan un contador de época, así que no se limpian
+// entre consultas y el objeto no reserva memoria después de la primera.
+// Por lo mismo no es seguro compartirlo entre hilos: se usa uno por hilo
+// (construirlo es barato). Es válido mientras no cambie la estructura.
+class DSeparacion{
+public:
+    explicit DSeparacion(const RedBayesiana& rb);
+
+    // nodos con un camino activo desde X dado Z (sin X ni Z)
+    ConjuntoNodos alcanzables(const ConjuntoNodos& x, const ConjuntoNodos& z);
+    // X ⊥ Y | Z; el recorrido termina en cuanto alcanza un nodo de Y
+    bool independiente(const ConjuntoNodos& x, const ConjuntoNodos& y, const ConjuntoNodos& z);
+    // todos los nodos d-separados de X dado Z (sin X ni Z)
+    ConjuntoNodos separados(const ConjuntoNodos& x, const ConjuntoNodos& z);
+
+    // Resuelve un lote de consultas. Las consecutivas con los mismos X y Z
+    // comparten un único recorrido, así que conviene agruparlas.
+    std::vector<bool> independientes(const std::vector<ConsultaIndependencia>& consultas);
+
+    // traduce nombres de variables a un conjunto; lanza si alguno no existe
+    ConjuntoNodos conjunto(const std::vector<std::string>& nombres) const;
+    const AnalisisGrafo& grafo() const { return g_; }
+
+private:
+    const RedBayesiana& rb_;
+    const AnalisisGrafo& g_;
+    uint32_t epoca_ = 0;
+    std::vector<uint32_t> desde_hijo_, desde_padre_; // época de la última visita en cada sentido
+    std::vector<uint64_t> pila_;                     // (nodo << 1) | llega_desde_padre
+
+    // recorre desde X; si `objetivo` no es nulo, se detiene al alcanzar
+    // uno de sus nodos y devuelve true
+    bool recorrer(const ConjuntoNodos& x, const ConjuntoNodos& z,
+                  ConjuntoNodos& alcanzados, const ConjuntoNodos* objetivo);
+};
+
+#endif // DSEPARACION_H
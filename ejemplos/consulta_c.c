@@ -0,0 +1,59 @@
+/* Uso de libbn desde C. Se compila contra la biblioteca (ver el Readme):
+ *
+ *   gcc -O2 ejemplos/consulta_c.c -I. -L. -lbn -o consulta_c
+ *
+ * Uso: ./consulta_c <estructura> <cpts> <Var> [Var=valor ...] [--bench N]
+ * (con --binario <modelo.rbn> en lugar de <estructura> <cpts>) */
+#include "bn_c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_EVIDENCIA 64
+
+int main(int argc, char** argv){
+    if(argc<4){
+        fprintf(stderr, "Uso: ./consulta_c <estructura> <cpts> <Var> [Var=valor ...] [--bench N]\n");
+        return 1;
+    }
+    bn_modelo* m = NULL;
+    int rc = strcmp(argv[1], "--binario")==0? bn_cargar_binario(argv[2], &m)
+                                             : bn_cargar_texto(argv[1], argv[2], &m);
+    if(rc!=BN_OK){ fprintf(stderr, "Error al cargar: %s\n", bn_ultimo_error()); return 2; }
+
+    /* los nombres se resuelven una vez */
+    int q = bn_variable(m, argv[3]);
+    if(q<0){ fprintf(stderr, "Variable desconocida: %s\n", argv[3]); return 1; }
+    int vars[MAX_EVIDENCIA], vals[MAX_EVIDENCIA];
+    size_t n = 0;
+    long repeticiones = 1;
+    for(int i=4;i<argc;++i){
+        if(strcmp(argv[i], "--bench")==0 && i+1<argc){ repeticiones = atol(argv[++i]); continue; }
+        char* igual = strchr(argv[i], '=');
+        if(!igual || n==MAX_EVIDENCIA){ fprintf(stderr, "Evidencia no válida: %s\n", argv[i]); return 1; }
+        *igual = '\0';
+        vars[n] = bn_variable(m, argv[i]);
+        vals[n] = vars[n]<0? -1 : bn_valor(m, vars[n], igual+1);
+        if(vals[n]<0){ fprintf(stderr, "Evidencia desconocida: %s=%s\n", argv[i], igual+1); return 1; }
+        ++n;
+    }
+
+    bn_sesion* s = NULL;
+    if(bn_sesion_crear(m, &s)!=BN_OK){ fprintf(stderr, "Error: %s\n", bn_ultimo_error()); return 2; }
+    double post[256], pe = 0;
+    clock_t t0 = clock();
+    for(long r=0; r<repeticiones; ++r){
+        rc = bn_consultar(s, q, vars, vals, n, post, 256, &pe);
+        if(rc!=BN_OK){ fprintf(stderr, "Error en la consulta: %s\n", bn_ultimo_error()); return 2; }
+    }
+    double seg = (double)(clock()-t0)/CLOCKS_PER_SEC;
+
+    printf("P(%s | e), P(e) = %g\n", bn_nombre_variable(m, q), pe);
+    for(int k=0; k<bn_num_valores(m, q); ++k) printf("%s: %.6f\n", bn_nombre_valor(m, q, k), post[k]);
+    if(repeticiones>1) printf("%ld consultas: %.3f us por consulta\n", repeticiones, seg*1e6/(double)repeticiones);
+
+    bn_sesion_liberar(s);
+    bn_liberar(m);
+    return 0;
+}
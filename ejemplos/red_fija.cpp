@@ -0,0 +1,64 @@
+// Binario dedicado para una red de estructura fija. La cabecera se genera
+// con el comando GENERAR: y se compila junto con este archivo:
+//
+//   ./bn estructura.txt cpts.txt 'GENERAR: ejemplos/red_fija.h'
+//   g++ -std=c++17 -O3 -march=native ejemplos/red_fija.cpp -o red_fija
+//
+// Uso: ./red_fija <Var> [Var=valor ...] [--bench N]
+#include "red_fija.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace red_fija;
+
+// índice de una variable o valor por nombre (-1 si no existe)
+static int buscar_variable(const std::string& s){
+    for(int v=0; v<NUM_VARIABLES; ++v) if(s==NOMBRES[v]) return v;
+    return -1;
+}
+static int buscar_valor(int v, const std::string& s){
+    for(int k=0; k<CARDINALIDAD[v]; ++k) if(s==VALORES[v][k]) return k;
+    return -1;
+}
+
+int main(int argc, char** argv){
+    if(argc<2){
+        std::cerr << "Uso: ./red_fija <Var> [Var=valor ...] [--bench N]\n";
+        return 1;
+    }
+    int q = buscar_variable(argv[1]);
+    if(q<0){ std::cerr << "Variable desconocida: "<<argv[1]<<"\n"; return 1; }
+
+    // evidencia como índices: -1 = no observada
+    int ev[NUM_VARIABLES];
+    for(int v=0; v<NUM_VARIABLES; ++v) ev[v] = -1;
+    long repeticiones = 0;
+    for(int i=2; i<argc; ++i){
+        if(std::strcmp(argv[i], "--bench")==0 && i+1<argc){ repeticiones = std::stol(argv[++i]); continue; }
+        std::string a = argv[i];
+        auto eq = a.find('=');
+        int v = eq==std::string::npos? -1 : buscar_variable(a.substr(0,eq));
+        int k = v<0? -1 : buscar_valor(v, a.substr(eq+1));
+        if(k<0){ std::cerr << "Evidencia inválida: "<<a<<"\n"; return 1; }
+        ev[v] = k;
+    }
+
+    double salida[MAX_CARDINALIDAD];
+    if(consultar(q, ev, salida)==0){ std::cerr << "Evidencia con probabilidad 0\n"; return 2; }
+    std::cout << std::fixed << std::setprecision(6);
+    for(int k=0; k<CARDINALIDAD[q]; ++k) std::cout << VALORES[q][k] << ": " << salida[k] << "\n";
+
+    // medición opcional del tiempo por consulta
+    if(repeticiones>0){
+        volatile double sumidero = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for(long r=0; r<repeticiones; ++r){ consultar(q, ev, salida); sumidero = sumidero + salida[0]; }
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1-t0).count()/repeticiones;
+        std::cout << "ns/consulta: " << std::setprecision(1) << ns << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Cabecera generada con `bn ... 'GENERAR: ...'`. No editar a mano:
+// regenerarla cuando cambie la red.
+#ifndef RED_FIJA_H
+#define RED_FIJA_H
+#include <utility>
+#include <type_traits>
+
+namespace red_fija{
+
+constexpr int NUM_VARIABLES = 4;
+constexpr int MAX_CARDINALIDAD = 3;
+constexpr int V_Lluvia = 0;
+constexpr int V_Mantenimiento = 1;
+constexpr int V_Tren = 2;
+constexpr int V_Cita = 3;
+constexpr const char* NOMBRES[NUM_VARIABLES] = {"Lluvia", "Mantenimiento", "Tren", "Cita"};
+constexpr int CARDINALIDAD[NUM_VARIABLES] = {3, 2, 2, 2};
+constexpr const char* VALORES_0[] = {"ninguna", "ligera", "fuerte"};
+constexpr const char* VALORES_1[] = {"si", "no"};
+constexpr const char* VALORES_2[] = {"a_tiempo", "retrasado"};
+constexpr const char* VALORES_3[] = {"asiste", "falta"};
+constexpr const char* const* VALORES[NUM_VARIABLES] = {VALORES_0, VALORES_1, VALORES_2, VALORES_3};
+
+// CPTs: fila = combinación de padres (el primero es el más significativo),
+// columna = valor de la variable
+constexpr double CPT_0[3] = {0.69999999999999996, 0.20000000000000001, 0.10000000000000001}; // P(Lluvia)
+constexpr double CPT_1[6] = {0.40000000000000002, 0.59999999999999998, 0.20000000000000001, 0.80000000000000004, 0.10000000000000001, 0.90000000000000002}; // P(Mantenimiento | Lluvia)
+constexpr double CPT_2[12] = {0.80000000000000004, 0.20000000000000001, 0.90000000000000002, 0.10000000000000001, 0.59999999999999998, 0.40000000000000002, 0.69999999999999996, 0.29999999999999999, 0.40000000000000002, 0.59999999999999998, 0.5, 0.5}; // P(Tren | Lluvia,Mantenimiento)
+constexpr double CPT_3[4] = {0.90000000000000002, 0.10000000000000001, 0.59999999999999998, 0.40000000000000002}; // P(Cita | Tren)
+
+// indicadores de evidencia: 1 para los valores compatibles con ev[v]
+// (ev[v] = índice del valor observado, o -1 si no se observa)
+struct Indicadores{
+    double v0[3];
+    double v1[2];
+    double v2[2];
+    double v3[2];
+};
+
+inline void preparar_indicadores(const int* ev, Indicadores& l) noexcept{
+    for(int k=0;k<3;++k) l.v0[k] = (ev[0]<0 || ev[0]==k)? 1.0 : 0.0;
+    for(int k=0;k<2;++k) l.v1[k] = (ev[1]<0 || ev[1]==k)? 1.0 : 0.0;
+    for(int k=0;k<2;++k) l.v2[k] = (ev[2]<0 || ev[2]==k)? 1.0 : 0.0;
+    for(int k=0;k<2;++k) l.v3[k] = (ev[3]<0 || ev[3]==k)? 1.0 : 0.0;
+}
+
+namespace detalle{
+template<class F, int... I>
+inline void repetir_(F&& f, std::integer_sequence<int, I...>){ (f(std::integral_constant<int, I>{}), ...); }
+// llama a f con índices constantes 0..N-1: el bucle queda desenrollado
+template<int N, class F>
+inline void repetir(F&& f){ repetir_(f, std::make_integer_sequence<int, N>{}); }
+} // namespace detalle
+
+// posterior<Q>: escribe P(Q | ev) en salida[0..CARDINALIDAD[Q]) y devuelve P(ev)
+template<int Q> double posterior(const int* ev, double* salida) noexcept;
+
+// P(Lluvia | ev); orden de eliminación: Cita Mantenimiento Tren
+template<> inline double posterior<0>(const int* ev, double* salida) noexcept{
+    Indicadores l;
+    preparar_indicadores(ev, l);
+    double f0[2]; // suma sobre Cita
+    detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i3){ s += l.v3[i3]*CPT_3[i2*2+i3]; }); f0[i2] = s; }); 
+    double f1[6]; // suma sobre Mantenimiento
+    detalle::repetir<3>([&](auto i0){ detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i1){ s += l.v1[i1]*CPT_1[i0*2+i1]*CPT_2[i0*4+i1*2+i2]; }); f1[i0*2+i2] = s; }); }); 
+    double f2[3]; // suma sobre Tren
+    detalle::repetir<3>([&](auto i0){ double s = 0; detalle::repetir<2>([&](auto i2){ s += l.v2[i2]*f0[i2]*f1[i0*2+i2]; }); f2[i0] = s; }); 
+    double z = 0;
+    for(int i0=0;i0<3;++i0){ double p = l.v0[i0]*CPT_0[i0]*f2[i0]; salida[i0] = p; z += p; }
+    if(z>0) for(int k=0;k<3;++k) salida[k] /= z;
+    return z;
+}
+
+// P(Mantenimiento | ev); orden de eliminación: Cita Lluvia Tren
+template<> inline double posterior<1>(const int* ev, double* salida) noexcept{
+    Indicadores l;
+    preparar_indicadores(ev, l);
+    double f0[2]; // suma sobre Cita
+    detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i3){ s += l.v3[i3]*CPT_3[i2*2+i3]; }); f0[i2] = s; }); 
+    double f1[4]; // suma sobre Lluvia
+    detalle::repetir<2>([&](auto i1){ detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<3>([&](auto i0){ s += l.v0[i0]*CPT_0[i0]*CPT_1[i0*2+i1]*CPT_2[i0*4+i1*2+i2]; }); f1[i1*2+i2] = s; }); }); 
+    double f2[2]; // suma sobre Tren
+    detalle::repetir<2>([&](auto i1){ double s = 0; detalle::repetir<2>([&](auto i2){ s += l.v2[i2]*f0[i2]*f1[i1*2+i2]; }); f2[i1] = s; }); 
+    double z = 0;
+    for(int i1=0;i1<2;++i1){ double p = l.v1[i1]*f2[i1]; salida[i1] = p; z += p; }
+    if(z>0) for(int k=0;k<2;++k) salida[k] /= z;
+    return z;
+}
+
+// P(Tren | ev); orden de eliminación: Cita Lluvia Mantenimiento
+template<> inline double posterior<2>(const int* ev, double* salida) noexcept{
+    Indicadores l;
+    preparar_indicadores(ev, l);
+    double f0[2]; // suma sobre Cita
+    detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i3){ s += l.v3[i3]*CPT_3[i2*2+i3]; }); f0[i2] = s; }); 
+    double f1[4]; // suma sobre Lluvia
+    detalle::repetir<2>([&](auto i1){ detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<3>([&](auto i0){ s += l.v0[i0]*CPT_0[i0]*CPT_1[i0*2+i1]*CPT_2[i0*4+i1*2+i2]; }); f1[i1*2+i2] = s; }); }); 
+    double f2[2]; // suma sobre Mantenimiento
+    detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i1){ s += l.v1[i1]*f1[i1*2+i2]; }); f2[i2] = s; }); 
+    double z = 0;
+    for(int i2=0;i2<2;++i2){ double p = l.v2[i2]*f0[i2]*f2[i2]; salida[i2] = p; z += p; }
+    if(z>0) for(int k=0;k<2;++k) salida[k] /= z;
+    return z;
+}
+
+// P(Cita | ev); orden de eliminación: Lluvia Mantenimiento Tren
+template<> inline double posterior<3>(const int* ev, double* salida) noexcept{
+    Indicadores l;
+    preparar_indicadores(ev, l);
+    double f0[4]; // suma sobre Lluvia
+    detalle::repetir<2>([&](auto i1){ detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<3>([&](auto i0){ s += l.v0[i0]*CPT_0[i0]*CPT_1[i0*2+i1]*CPT_2[i0*4+i1*2+i2]; }); f0[i1*2+i2] = s; }); }); 
+    double f1[2]; // suma sobre Mantenimiento
+    detalle::repetir<2>([&](auto i2){ double s = 0; detalle::repetir<2>([&](auto i1){ s += l.v1[i1]*f0[i1*2+i2]; }); f1[i2] = s; }); 
+    double f2[2]; // suma sobre Tren
+    detalle::repetir<2>([&](auto i3){ double s = 0; detalle::repetir<2>([&](auto i2){ s += l.v2[i2]*CPT_3[i2*2+i3]*f1[i2]; }); f2[i3] = s; }); 
+    double z = 0;
+    for(int i3=0;i3<2;++i3){ double p = l.v3[i3]*f2[i3]; salida[i3] = p; z += p; }
+    if(z>0) for(int k=0;k<2;++k) salida[k] /= z;
+    return z;
+}
+
+// consulta por índice de variable; devuelve P(ev) (0 si q no es válida)
+inline double consultar(int q, const int* ev, double* salida) noexcept{
+    switch(q){
+        case 0: return posterior<0>(ev, salida);
+        case 1: return posterior<1>(ev, salida);
+        case 2: return posterior<2>(ev, salida);
+        case 3: return posterior<3>(ev, salida);
+        default: return 0.0;
+    }
+}
+
+} // namespace red_fija
+
+#endif // RED_FIJA_H
@@ -0,0 +1,117 @@
+#include "eliminacion.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+const char* nombre_heuristica(Heuristica h){
+    switch(h){
+    case Heuristica::MinFillPonderado: return "min-fill ponderado";
+    case Heuristica::MinGrado:         return "min-grado";
+    default:                           return "min-fill";
+    }
+}
+
+std::vector<int> orden_eliminacion(const std::vector<std::vector<int>>& alcances,
+                                   const std::vector<size_t>& card,
+                                   const std::vector<bool>& conservar,
+                                   Heuristica h,
+                                   std::mt19937_64* rng,
+                                   size_t candidatas){
+    const int n = (int)card.size();
+
+    // grafo de interacción: dos variables son vecinas si comparten factor
+    std::vector<std::vector<bool>> ady(n, std::vector<bool>(n, false));
+    for(const auto& a: alcances)
+        for(int u: a) for(int v: a)
+            if(u!=v) ady[u][v] = true;
+
+    // puntuación (heurística, tamaño del factor que se crearía)
+    using Puntuacion = std::pair<double,double>;
+    std::vector<bool> eliminada(n, false);
+    std::vector<int> orden;
+    std::vector<std::pair<Puntuacion,int>> opciones;
+    for(;;){
+        int mejor = -1;
+        Puntuacion mejor_p(std::numeric_limits<double>::infinity(), 0);
+        opciones.clear();
+        for(int v=0; v<n; ++v){
+            if(eliminada[v] || conservar[v]) continue;
+            std::vector<int> vec;
+            double tam = (double)card[v];
+            for(int u=0; u<n; ++u)
+                if(!eliminada[u] && ady[v][u]){ vec.push_back(u); tam *= (double)card[u]; }
+            double valor = 0;
+            if(h==Heuristica::MinGrado) valor = (double)vec.size();
+            else{
+                // aristas que habría que añadir para que los vecinos formen un clique
+                for(size_t i=0;i<vec.size();++i)
+                    for(size_t j=i+1;j<vec.size();++j)
+                        if(!ady[vec[i]][vec[j]])
+                            valor += h==Heuristica::MinFill? 1.0 : (double)card[vec[i]]*(double)card[vec[j]];
+            }
+            Puntuacion p(valor, tam);
+            if(rng) opciones.push_back({p, v});
+            else if(p<mejor_p){ mejor = v; mejor_p = p; }
+        }
+        if(rng && !opciones.empty()){
+            size_t k = std::min(std::max<size_t>(1, candidatas), opciones.size());
+            std::partial_sort(opciones.begin(), opciones.begin()+k, opciones.end());
+            mejor = opciones[std::uniform_int_distribution<size_t>(0, k-1)(*rng)].second;
+        }
+        if(mejor<0) break;
+
+        // eliminamos la variable conectando a todos sus vecinos entre sí
+        std::vector<int> vec;
+        for(int u=0; u<n; ++u)
+            if(!eliminada[u] && ady[mejor][u]) vec.push_back(u);
+        for(int a: vec) for(int b: vec)
+            if(a!=b) ady[a][b] = true;
+        eliminada[mejor] = true;
+        orden.push_back(mejor);
+    }
+    return orden;
+}
+
+std::vector<int> orden_min_fill(const std::vector<std::vector<int>>& alcances,
+                                const std::vector<size_t>& card,
+                                const std::vector<bool>& conservar){
+    return orden_eliminacion(alcances, card, conservar, Heuristica::MinFill);
+}
+
+CosteEliminacion coste_eliminacion(const std::vector<std::vector<int>>& alcances,
+                                   const std::vector<size_t>& card,
+                                   const std::vector<int>& orden){
+    CosteEliminacion c;
+    std::vector<std::vector<int>> activos = alcances;
+    auto tam = [&](const std::vector<int>& vs){
+        double t = 1;
+        for(int v: vs) t *= (double)card[v];
+        return t;
+    };
+    for(int x: orden){
+        std::vector<std::vector<int>> resto;
+        std::vector<int> vars;
+        size_t usados = 0;
+        for(auto& a: activos){
+            if(std::find(a.begin(), a.end(), x)==a.end()){ resto.push_back(std::move(a)); continue; }
+            ++usados;
+            for(int v: a) if(v!=x) vars.push_back(v);
+        }
+        if(!usados){ c.tam_paso.push_back(0); activos.swap(resto); continue; }
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+        const double salida = tam(vars);
+        c.flops += salida*(double)card[x]*(double)usados;
+        c.max_factor = std::max(c.max_factor, salida);
+        c.tam_paso.push_back(salida);
+        resto.push_back(std::move(vars));
+        activos.swap(resto);
+    }
+    // producto final de lo que queda (sobre las variables conservadas)
+    std::vector<int> quedan;
+    for(const auto& a: activos) quedan.insert(quedan.end(), a.begin(), a.end());
+    std::sort(quedan.begin(), quedan.end());
+    quedan.erase(std::unique(quedan.begin(), quedan.end()), quedan.end());
+    c.flops += tam(quedan)*(double)activos.size();
+    return c;
+}
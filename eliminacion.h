@@ -0,0 +1,47 @@
+#ifndef ELIMINACION_H
+#define ELIMINACION_H
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Heurísticas voraces de orden de eliminación sobre el grafo de
+// interacción de un conjunto de factores. En cada paso se elimina la
+// variable con menor puntuación:
+//  - MinFill:          aristas de relleno (vecinos que no eran vecinos).
+//  - MinFillPonderado: Σ card(a)·card(b) sobre las aristas de relleno.
+//  - MinGrado:         número de vecinos.
+// Los empates se deshacen por el tamaño del factor que se crearía.
+enum class Heuristica{ MinFill, MinFillPonderado, MinGrado };
+
+const char* nombre_heuristica(Heuristica h);
+
+// Las variables se identifican con enteros 0..n-1: `alcances[f]` son las
+// variables del factor f y `card[v]` la cardinalidad de v. Las variables
+// marcadas en `conservar` no se eliminan (p. ej. la variable de consulta).
+// Con `rng`, cada paso elige al azar entre las `candidatas` variables de
+// menor puntuación (para reinicios aleatorios); sin él, la mejor.
+std::vector<int> orden_eliminacion(const std::vector<std::vector<int>>& alcances,
+                                   const std::vector<size_t>& card,
+                                   const std::vector<bool>& conservar,
+                                   Heuristica h,
+                                   std::mt19937_64* rng = nullptr,
+                                   size_t candidatas = 3);
+
+// orden_eliminacion con MinFill
+std::vector<int> orden_min_fill(const std::vector<std::vector<int>>& alcances,
+                                const std::vector<size_t>& card,
+                                const std::vector<bool>& conservar);
+
+// Coste de eliminar en `orden` (como lo ejecuta PlanEliminacion): en cada
+// paso se multiplican los factores que mencionan la variable y se suma.
+struct CosteEliminacion{
+    double max_factor = 0;         // entradas del mayor factor intermedio
+    double flops = 0;              // productos y sumas de todos los pasos y del producto final
+    std::vector<double> tam_paso;  // entradas del factor creado en cada paso del orden
+};
+CosteEliminacion coste_eliminacion(const std::vector<std::vector<int>>& alcances,
+                                   const std::vector<size_t>& card,
+                                   const std::vector<int>& orden);
+
+#endif // ELIMINACION_H
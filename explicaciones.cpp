@@ -0,0 +1,149 @@
+#include "explicaciones.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+MejoresExplicaciones::MejoresExplicaciones(const RedBayesiana& rb){
+    vars_ = rb.grafo().orden;
+    const size_t n = vars_.size();
+    for(const Nodo* X: vars_) card_.push_back(X->valores.size());
+
+    std::vector<AlcanceFactor> alcances;
+    for(size_t v=0; v<n; ++v){
+        const Nodo* X = vars_[v];
+        if(!X->cpt || !X->cpt->finalizada())
+            throw std::runtime_error(mensaje_sin_cpt(X));
+        const TablaProbabilidad& T = *X->cpt;
+        // max-producto: la descomposición con signo de los noisy no sirve
+        T.exigir_densa("MPE_TOPK");
+        std::vector<int> vs;
+        for(const Nodo* p: T.padres){
+            if(p->id<0 || (size_t)p->id>=v)
+                throw std::runtime_error("CPT de "+X->nombre+" usa un padre fuera de la estructura: "+p->nombre);
+            vs.push_back(p->id);
+        }
+        vs.push_back((int)v);
+        alcances.push_back(AlcanceFactor::crear(vs, card_));
+        std::vector<double> d;
+        d.reserve(alcances.back().tam);
+        for(size_t fila=0; fila<T.num_filas(); ++fila)
+            for(size_t k=0;k<card_[v];++k){
+                double p = T.prob(fila, k);
+                if(std::isnan(p)) throw std::runtime_error("CPT incompleta: "+X->nombre);
+                d.push_back(p);
+            }
+        cpts_.push_back(std::move(d));
+    }
+    size_t off = 0;
+    for(size_t v=0; v<n; ++v){
+        alcances.push_back(AlcanceFactor::crear({(int)v}, card_));
+        inicio_mascara_.push_back(off);
+        off += card_[v];
+    }
+    inicio_mascara_.push_back(off);
+    plan_ = PlanEliminacion::compilar(alcances, card_, {});
+    datos_.resize(2*n);
+    for(size_t v=0; v<n; ++v) datos_[v] = cpts_[v].data();
+}
+
+double MejoresExplicaciones::evaluar(const std::vector<double>& mascara, std::vector<int>& asig){
+    const size_t n = vars_.size();
+    for(size_t v=0; v<n; ++v) datos_[n+v] = &mascara[inicio_mascara_[v]];
+    std::vector<double> max;
+    plan_.ejecutar(datos_, max, true);
+    ++evaluaciones_;
+    asig.assign(n, 0);
+    plan_.decodificar(asig);
+    return max[0];
+}
+
+size_t MejoresExplicaciones::enumerar(const std::vector<int>& ev, size_t k,
+                                      const std::function<bool(const Explicacion&)>& emitir){
+    const size_t n = vars_.size();
+    if(ev.size()!=n) throw std::runtime_error("La evidencia debe tener un valor por variable");
+
+    // subespacio raíz: la evidencia deja un solo valor permitido
+    std::vector<double> raiz(inicio_mascara_.back(), 1.0);
+    for(size_t v=0; v<n; ++v)
+        if(ev[v]>=0)
+            for(size_t j=0;j<card_[v];++j) raiz[inicio_mascara_[v]+j] = (j==(size_t)ev[v])? 1.0 : 0.0;
+
+    // P(e) con la misma eliminación en modo suma, para dar P(x | e)
+    for(size_t v=0; v<n; ++v) datos_[n+v] = &raiz[inicio_mascara_[v]];
+    std::vector<double> suma;
+    plan_.ejecutar(datos_, suma, false);
+    const double pe = suma[0];
+    if(pe<=0) throw std::runtime_error("Evidencia con probabilidad 0");
+
+    struct Subespacio{
+        double cota;
+        bool exacto;              // la cota es el máximo y `mejor` su asignación
+        std::vector<double> mascara;
+        std::vector<int> mejor;
+    };
+    // mayor cota primero; a igual cota, los ya evaluados
+    auto menor = [](const Subespacio& a, const Subespacio& b){
+        return a.cota!=b.cota? a.cota<b.cota : (!a.exacto && b.exacto);
+    };
+    // cola de prioridad como montículo sobre un vector (para poder mover el frente)
+    std::vector<Subespacio> cola;
+    auto meter = [&](Subespacio&& s){ cola.push_back(std::move(s)); std::push_heap(cola.begin(), cola.end(), menor); };
+    {
+        Subespacio s{0, true, raiz, {}};
+        s.cota = evaluar(s.mascara, s.mejor);
+        if(s.cota>0) meter(std::move(s));
+    }
+
+    size_t emitidas = 0;
+    while(emitidas<k && !cola.empty()){
+        std::pop_heap(cola.begin(), cola.end(), menor);
+        Subespacio s = std::move(cola.back());
+        cola.pop_back();
+        if(!s.exacto){
+            s.cota = evaluar(s.mascara, s.mejor);
+            s.exacto = true;
+            if(s.cota>0) meter(std::move(s));
+            continue;
+        }
+        // nada en la cola puede superar a s: se emite ya
+        Explicacion e;
+        e.asig = s.mejor;
+        e.prob_conjunta = s.cota;
+        e.prob = s.cota/pe;
+        e.rango = ++emitidas;
+        if(!emitir(e)) break;
+        if(emitidas==k) break;
+
+        // partición de Nilsson: el hijo i fija las variables anteriores a
+        // su valor en s.mejor y prohíbe ese valor en la variable i
+        std::vector<double>& m = s.mascara;
+        for(size_t v=0; v<n; ++v){
+            double* mv = &m[inicio_mascara_[v]];
+            size_t permitidos = 0;
+            for(size_t j=0;j<card_[v];++j) permitidos += mv[j]!=0.0;
+            if(permitidos<=1) continue;
+            Subespacio hijo{s.cota, false, m, {}};
+            hijo.mascara[inicio_mascara_[v]+(size_t)s.mejor[v]] = 0.0;
+            meter(std::move(hijo));
+            for(size_t j=0;j<card_[v];++j) mv[j] = (j==(size_t)s.mejor[v])? 1.0 : 0.0;
+        }
+    }
+    return emitidas;
+}
+
+std::vector<int> MejoresExplicaciones::indices_evidencia(
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    std::vector<int> ev(vars_.size(), -1);
+    for(const auto& kv: evidencia){
+        auto it = std::find_if(vars_.begin(), vars_.end(), [&](const Nodo* X){ return X->nombre==kv.first; });
+        if(it==vars_.end()) throw std::runtime_error("Variable desconocida: "+kv.first);
+        const auto& dom = (*it)->valores;
+        auto jt = std::find(dom.begin(), dom.end(), kv.second);
+        if(jt==dom.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        ev[it-vars_.begin()] = (int)(jt-dom.begin());
+    }
+    return ev;
+}
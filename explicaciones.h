@@ -0,0 +1,61 @@
+#ifndef EXPLICACIONES_H
+#define EXPLICACIONES_H
+#include "factor.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct RedBayesiana; struct Nodo;
+
+struct Explicacion{
+    std::vector<int> asig;    // valor de cada variable (índice = Nodo::id), evidencia incluida
+    double prob_conjunta = 0; // P(x, e)
+    double prob = 0;          // P(x | e)
+    size_t rango = 0;         // 1 = la MPE
+};
+
+// Las k explicaciones más probables (asignaciones completas de las
+// variables no observadas) en orden decreciente de P(x, e), con la
+// partición de Nilsson sobre eliminación max-producto:
+//  - el espacio de asignaciones se describe con una máscara de valores
+//    permitidos por variable (la evidencia deja uno solo);
+//  - el máximo de un subespacio es una eliminación max-producto con las
+//    máscaras como factores unarios, y la traza de argmax da la asignación;
+//  - al emitir la mejor x de un subespacio, este se parte en subespacios
+//    disjuntos: "x_1..x_{i-1} como en x, x_i distinto", para cada i.
+// Los subespacios nuevos entran en la cola con la cota del padre (es
+// admisible: el máximo de un subconjunto no la supera) y solo se evalúan
+// al llegar al frente; muchos nunca se evalúan.
+//
+// El plan de eliminación se compila una vez en el constructor; cada
+// evaluación solo cambia las máscaras. No se comparte entre hilos.
+class MejoresExplicaciones{
+public:
+    explicit MejoresExplicaciones(const RedBayesiana& rb);
+
+    // Enumera hasta `k` explicaciones dada la evidencia `ev` (índice de
+    // valor por Nodo::id, -1 = libre). Cada una se entrega a `emitir` en
+    // cuanto se confirma, antes de buscar la siguiente; si `emitir`
+    // devuelve false se detiene. Devuelve cuántas se emitieron.
+    size_t enumerar(const std::vector<int>& ev, size_t k,
+                    const std::function<bool(const Explicacion&)>& emitir);
+
+    std::vector<int> indices_evidencia(const std::unordered_map<std::string,std::string>& evidencia) const;
+    const std::vector<Nodo*>& variables() const { return vars_; }
+    size_t evaluaciones() const { return evaluaciones_; }
+
+private:
+    std::vector<Nodo*> vars_;                 // orden topológico (índice = Nodo::id)
+    std::vector<size_t> card_;
+    std::vector<size_t> inicio_mascara_;      // desplazamiento de cada variable en una máscara
+    std::vector<std::vector<double>> cpts_;   // CPT densa de cada variable (factor v)
+    PlanEliminacion plan_;                    // factores: CPTs y luego una máscara por variable
+    std::vector<const double*> datos_;
+    size_t evaluaciones_ = 0;
+
+    // máximo de P(x, e) en el subespacio `mascara` y su asignación
+    double evaluar(const std::vector<double>& mascara, std::vector<int>& asig);
+};
+
+#endif // EXPLICACIONES_H
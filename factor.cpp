@@ -0,0 +1,123 @@
+#include "factor.h"
+#include "eliminacion.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+AlcanceFactor AlcanceFactor::crear(std::vector<int> vars, const std::vector<size_t>& card){
+    AlcanceFactor a;
+    a.vars = std::move(vars);
+    a.pasos.assign(a.vars.size(), 1);
+    for(size_t k=a.vars.size(); k-- > 0; ){
+        a.pasos[k] = a.tam;
+        a.tam *= card[a.vars[k]];
+    }
+    return a;
+}
+
+PlanEliminacion PlanEliminacion::compilar(const std::vector<AlcanceFactor>& factores,
+                                          const std::vector<size_t>& card,
+                                          const std::vector<int>& conservar){
+    std::vector<std::vector<int>> alcances;
+    for(const auto& f: factores) alcances.push_back(f.vars);
+    std::vector<bool> fijo(card.size(), false);
+    for(int v: conservar) fijo[v] = true;
+    return compilar(factores, card, conservar, orden_min_fill(alcances, card, fijo));
+}
+
+PlanEliminacion PlanEliminacion::compilar(const std::vector<AlcanceFactor>& factores,
+                                          const std::vector<size_t>& card,
+                                          const std::vector<int>& conservar,
+                                          const std::vector<int>& orden){
+    PlanEliminacion p;
+    p.num_factores_ = factores.size();
+    p.card_ = card;
+    p.alcances_ = factores;
+
+    std::vector<uint32_t> activos;
+    for(uint32_t f=0; f<factores.size(); ++f) activos.push_back(f);
+    for(int x: orden){
+        std::vector<uint32_t> usados, resto;
+        for(uint32_t f: activos){
+            const auto& vs = p.alcances_[f].vars;
+            (std::find(vs.begin(), vs.end(), x)!=vs.end()? usados : resto).push_back(f);
+        }
+        if(usados.empty()) continue;
+        std::vector<int> vars;
+        for(uint32_t f: usados) for(int v: p.alcances_[f].vars) if(v!=x) vars.push_back(v);
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+        Paso paso{x, usados, (uint32_t)p.alcances_.size()};
+        p.alcances_.push_back(AlcanceFactor::crear(vars, card));
+        resto.push_back(paso.salida);
+        p.pasos_.push_back(std::move(paso));
+        activos.swap(resto);
+    }
+    for(uint32_t f: activos)
+        for(int v: p.alcances_[f].vars)
+            if(std::find(conservar.begin(), conservar.end(), v)==conservar.end())
+                throw std::runtime_error("El orden de eliminación no elimina la variable "+std::to_string(v));
+    p.finales_ = activos;
+    p.salida_ = AlcanceFactor::crear(conservar, card);
+    return p;
+}
+
+// los buffers del Estado se dimensionan en la primera ejecución con él
+void PlanEliminacion::ejecutar(const std::vector<const double*>& datos, std::vector<double>& salida,
+                               Estado& est, bool maximizar) const{
+    if(est.buffers.size()!=alcances_.size()){
+        est.buffers.assign(alcances_.size(), {});
+        for(size_t f=num_factores_; f<alcances_.size(); ++f) est.buffers[f].resize(alcances_[f].tam);
+        est.asig.assign(card_.size(), 0);
+    }
+    std::vector<int>& asig = est.asig;
+    std::vector<const double*>& val = est.val;
+    val.assign(datos.begin(), datos.end());
+    val.resize(alcances_.size());
+    for(size_t f=num_factores_; f<alcances_.size(); ++f) val[f] = est.buffers[f].data();
+    if(maximizar) est.argmax.resize(pasos_.size());
+
+    for(size_t s=0; s<pasos_.size(); ++s){
+        const Paso& paso = pasos_[s];
+        const AlcanceFactor& a = alcances_[paso.salida];
+        double* dst = est.buffers[paso.salida].data();
+        uint32_t* arg = nullptr;
+        if(maximizar){ est.argmax[s].resize(a.tam); arg = est.argmax[s].data(); }
+        for(int v: a.vars) asig[v] = 0;
+        for(size_t e=0; e<a.tam; ++e){
+            double acc = 0;
+            uint32_t mejor = 0;
+            for(size_t xv=0; xv<card_[paso.var]; ++xv){
+                asig[paso.var] = (int)xv;
+                double prod = 1;
+                for(uint32_t f: paso.entradas){
+                    prod *= val[f][alcances_[f].indice(asig)];
+                    if(prod==0) break;
+                }
+                if(!maximizar) acc += prod;
+                else if(prod>acc){ acc = prod; mejor = (uint32_t)xv; }
+            }
+            dst[e] = acc;
+            if(arg) arg[e] = mejor;
+            a.siguiente(card_, asig);
+        }
+    }
+
+    salida.resize(salida_.tam);
+    for(int v: salida_.vars) asig[v] = 0;
+    for(size_t e=0; e<salida_.tam; ++e){
+        double prod = 1;
+        for(uint32_t f: finales_) prod *= val[f][alcances_[f].indice(asig)];
+        salida[e] = prod;
+        salida_.siguiente(card_, asig);
+    }
+}
+
+// se recorre la eliminación al revés: cuando se decide la variable de un
+// paso, las de su factor de salida (eliminadas después) ya tienen valor
+void PlanEliminacion::decodificar(std::vector<int>& asig, const Estado& est) const{
+    for(size_t s=pasos_.size(); s-- > 0; ){
+        const Paso& paso = pasos_[s];
+        asig[paso.var] = (int)est.argmax[s][alcances_[paso.salida].indice(asig)];
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef FACTOR_H
+#define FACTOR_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Alcance de un factor denso sobre variables 0..n-1: la última variable
+// es la más rápida (como en las filas de una CPT, donde el primer padre
+// es el más significativo).
+struct AlcanceFactor{
+    std::vector<int> vars;
+    std::vector<size_t> pasos;
+    size_t tam = 1;
+
+    static AlcanceFactor crear(std::vector<int> vars, const std::vector<size_t>& card);
+    // posición de la asignación `asig` (valor por variable) en el factor
+    size_t indice(const std::vector<int>& asig) const {
+        size_t i = 0;
+        for(size_t k=0;k<vars.size();++k) i += (size_t)asig[vars[k]]*pasos[k];
+        return i;
+    }
+    // avanza el odómetro sobre las variables del alcance; false al dar la vuelta
+    bool siguiente(const std::vector<size_t>& card, std::vector<int>& asig) const {
+        for(size_t k=vars.size(); k-- > 0; ){
+            if(++asig[vars[k]] < (int)card[vars[k]]) return true;
+            asig[vars[k]] = 0;
+        }
+        return false;
+    }
+};
+
+// Eliminación de variables ya resuelta para un conjunto fijo de alcances.
+// El orden (min-fill) y las formas de los factores intermedios se fijan
+// al compilar; ejecutar() solo recibe los datos de los factores, que
+// pueden cambiar entre llamadas (evidencia, creencias, restricciones).
+// Las ranuras [0, num_factores) son los factores de entrada; cada paso
+// multiplica sus `entradas`, suma (o maximiza) `var` y deja el resultado
+// en la ranura `salida`.
+//
+// ejecutar() sin Estado usa los buffers intermedios del propio plan, así
+// que ese plan no se comparte entre hilos. Con un Estado por llamada (o
+// por hilo), el mismo plan compilado sirve a varios hilos a la vez.
+class PlanEliminacion{
+public:
+    // buffers de una ejecución: factores intermedios, argmax por paso
+    // (para decodificar) y la asignación de trabajo. Un Estado se usa
+    // siempre con el mismo plan.
+    struct Estado{
+        std::vector<std::vector<double>> buffers;
+        std::vector<std::vector<uint32_t>> argmax;
+        std::vector<int> asig;
+        std::vector<const double*> val;
+    };
+
+    static PlanEliminacion compilar(const std::vector<AlcanceFactor>& factores,
+                                    const std::vector<size_t>& card,
+                                    const std::vector<int>& conservar);
+    // con un orden de eliminación ya elegido (ver Planificador); las
+    // variables del orden que no aparecen en ningún factor se saltan
+    static PlanEliminacion compilar(const std::vector<AlcanceFactor>& factores,
+                                    const std::vector<size_t>& card,
+                                    const std::vector<int>& conservar,
+                                    const std::vector<int>& orden);
+
+    // Deja en `salida` la tabla sobre las variables de `conservar` (en el
+    // orden pedido): Σ o max, según `maximizar`, del producto de los
+    // factores. `datos[f]` apunta a los valores del factor de entrada f.
+    void ejecutar(const std::vector<const double*>& datos, std::vector<double>& salida,
+                  bool maximizar = false){ ejecutar(datos, salida, estado_, maximizar); }
+    void ejecutar(const std::vector<const double*>& datos, std::vector<double>& salida,
+                  Estado& s, bool maximizar = false) const;
+
+    // Tras ejecutar(..., true): completa `asig` con la asignación que
+    // alcanza el máximo para las variables eliminadas. Las conservadas
+    // deben venir ya asignadas en `asig`.
+    void decodificar(std::vector<int>& asig) const { decodificar(asig, estado_); }
+    void decodificar(std::vector<int>& asig, const Estado& s) const;
+
+    size_t num_pasos() const { return pasos_.size(); }
+
+private:
+    struct Paso{
+        int var;
+        std::vector<uint32_t> entradas;
+        uint32_t salida;
+    };
+    size_t num_factores_ = 0;
+    std::vector<size_t> card_;
+    std::vector<AlcanceFactor> alcances_;
+    std::vector<Paso> pasos_;
+    std::vector<uint32_t> finales_;            // ranuras que quedan, sobre las variables conservadas
+    AlcanceFactor salida_;
+    Estado estado_;                            // el de ejecutar() sin Estado (reutilizado)
+};
+
+#endif // FACTOR_H
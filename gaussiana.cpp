@@ -0,0 +1,241 @@
+#include "gaussiana.h"
+#include "nodo.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void GaussianaCondicional::establecer(Nodo* var, const std::vector<Nodo*>& ps){
+    variable = var;
+    padres = ps;
+}
+
+void GaussianaCondicional::agregar_fila(const std::vector<std::pair<std::string,std::string>>& contexto,
+                                        std::vector<double> lineal, double varianza){
+    carga.push_back({contexto, std::move(lineal), varianza});
+}
+
+void GaussianaCondicional::finalizar(){
+    discretos.clear(); continuos.clear();
+    for(Nodo* p: padres) (p->gauss? continuos : discretos).push_back(p);
+    size_t n = 1;
+    for(Nodo* p: discretos){
+        if(p->valores.empty()) throw std::runtime_error("Padre sin valores en "+variable->nombre+": "+p->nombre);
+        n *= p->valores.size();
+    }
+
+    std::vector<Fila> fs(n);
+    std::vector<bool> definida(n, false);
+    const FilaCarga* defecto = nullptr;
+    auto convertir = [&](const FilaCarga& c){
+        if(c.lineal.size()!=1+continuos.size())
+            throw std::runtime_error("La fila de "+variable->nombre+" necesita la media y "+
+                                     std::to_string(continuos.size())+" coeficientes");
+        if(!(c.varianza>0) || !std::isfinite(c.varianza))
+            throw std::runtime_error("Varianza no positiva en "+variable->nombre);
+        Fila f;
+        f.media = c.lineal[0];
+        f.coef.assign(c.lineal.begin()+1, c.lineal.end());
+        f.varianza = c.varianza;
+        return f;
+    };
+    for(const FilaCarga& c: carga){
+        // sin contexto: vale para todas las combinaciones que no tengan fila propia
+        if(c.contexto.empty()){ defecto = &c; continue; }
+        std::vector<int> val(discretos.size(), -1);
+        for(const auto& kv: c.contexto){
+            auto it = std::find_if(discretos.begin(), discretos.end(), [&](Nodo* p){ return p->nombre==kv.first; });
+            if(it==discretos.end())
+                throw std::runtime_error("En "+variable->nombre+", '"+kv.first+"' no es un padre discreto");
+            const auto& dom = (*it)->valores;
+            auto v = std::find(dom.begin(), dom.end(), kv.second);
+            if(v==dom.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+            val[it-discretos.begin()] = (int)(v-dom.begin());
+        }
+        for(size_t i=0;i<val.size();++i)
+            if(val[i]<0) throw std::runtime_error("Fila de "+variable->nombre+" sin valor para "+discretos[i]->nombre);
+        const size_t f = fila(val);
+        if(definida[f]) throw std::runtime_error("Fila repetida en "+variable->nombre);
+        fs[f] = convertir(c);
+        definida[f] = true;
+    }
+    for(size_t f=0; f<n; ++f){
+        if(definida[f]) continue;
+        if(!defecto) throw std::runtime_error("Faltan filas en la densidad de "+variable->nombre);
+        fs[f] = convertir(*defecto);
+    }
+    filas = std::move(fs);
+    carga.clear();
+}
+
+size_t GaussianaCondicional::fila(const std::vector<int>& valores) const{
+    size_t f = 0;
+    for(size_t i=0;i<discretos.size();++i) f = f*discretos[i]->valores.size() + (size_t)valores[i];
+    return f;
+}
+
+void GaussianaCondicional::imprimir(std::ostream& os) const{
+    os << "p(" << variable->nombre;
+    if(!padres.empty()){
+        os << " | ";
+        for(size_t i=0;i<padres.size();++i){ if(i) os << ","; os << padres[i]->nombre; }
+    }
+    os << ")\nContinua: gaussiana lineal condicional (" << filas.size() << (filas.size()==1? " fila" : " filas") << ")\n";
+    std::vector<int> val(discretos.size(), 0);
+    for(size_t f=0; f<filas.size(); ++f){
+        for(size_t i=0;i<discretos.size();++i){
+            if(i) os << ", ";
+            os << discretos[i]->nombre << "=" << discretos[i]->valores[val[i]];
+        }
+        if(!discretos.empty()) os << " : ";
+        const Fila& fl = filas[f];
+        os << "N(" << fl.media;
+        for(size_t j=0;j<continuos.size();++j)
+            os << (fl.coef[j]<0? " - " : " + ") << std::fabs(fl.coef[j]) << "·" << continuos[j]->nombre;
+        os << ", " << fl.varianza << ")\n";
+        for(size_t i=discretos.size(); i-- > 0; ){
+            if(++val[i] < (int)discretos[i]->valores.size()) break;
+            val[i] = 0;
+        }
+    }
+}
+
+FactorCanonico FactorCanonico::lineal(int y, const std::vector<int>& x, double b0,
+                                      const std::vector<double>& b, double varianza){
+    // -(y - b0 - bᵀx)²/(2σ²) con a = (-b, 1):  K = a·aᵀ/σ², h = a·b0/σ²
+    FactorCanonico f;
+    f.vars = x;
+    f.vars.push_back(y);
+    const size_t n = f.vars.size();
+    std::vector<double> a(n);
+    for(size_t i=0;i<x.size();++i) a[i] = -b[i];
+    a[n-1] = 1;
+    f.K.assign(n*n, 0);
+    f.h.assign(n, 0);
+    for(size_t i=0;i<n;++i){
+        f.h[i] = a[i]*b0/varianza;
+        for(size_t j=0;j<n;++j) f.K[i*n+j] = a[i]*a[j]/varianza;
+    }
+    f.g = -b0*b0/(2*varianza) - 0.5*std::log(2*M_PI*varianza);
+    return f;
+}
+
+void FactorCanonico::multiplicar(const FactorCanonico& o){
+    std::vector<size_t> pos(o.vars.size());
+    size_t n = vars.size();
+    for(size_t i=0;i<o.vars.size();++i){
+        auto it = std::find(vars.begin(), vars.end(), o.vars[i]);
+        if(it==vars.end()){ vars.push_back(o.vars[i]); pos[i] = vars.size()-1; }
+        else pos[i] = (size_t)(it-vars.begin());
+    }
+    const size_t m = vars.size();
+    if(m!=n){
+        std::vector<double> K2(m*m, 0);
+        for(size_t i=0;i<n;++i) for(size_t j=0;j<n;++j) K2[i*m+j] = K[i*n+j];
+        K.swap(K2);
+        h.resize(m, 0);
+    }
+    const size_t k = o.vars.size();
+    for(size_t i=0;i<k;++i){
+        h[pos[i]] += o.h[i];
+        for(size_t j=0;j<k;++j) K[pos[i]*m+pos[j]] += o.K[i*k+j];
+    }
+    g += o.g;
+}
+
+FactorCanonico FactorCanonico::condicionar(const std::vector<int>& fijas, const std::vector<double>& valores) const{
+    const size_t n = vars.size();
+    std::vector<double> y(n, 0);
+    std::vector<bool> fija(n, false);
+    for(size_t k=0;k<fijas.size();++k){
+        auto it = std::find(vars.begin(), vars.end(), fijas[k]);
+        if(it==vars.end()) continue;
+        fija[it-vars.begin()] = true;
+        y[it-vars.begin()] = valores[k];
+    }
+    FactorCanonico r;
+    r.g = g;
+    std::vector<size_t> quedan;
+    for(size_t i=0;i<n;++i){
+        if(!fija[i]){ quedan.push_back(i); continue; }
+        // g += h_Y·y - ½ yᵀK_YY y
+        r.g += h[i]*y[i];
+        for(size_t j=0;j<n;++j) if(fija[j]) r.g -= 0.5*y[i]*K[i*n+j]*y[j];
+    }
+    const size_t m = quedan.size();
+    r.K.assign(m*m, 0);
+    r.h.assign(m, 0);
+    for(size_t a=0;a<m;++a){
+        const size_t i = quedan[a];
+        r.vars.push_back(vars[i]);
+        // h_X - K_XY·y
+        r.h[a] = h[i];
+        for(size_t j=0;j<n;++j) if(fija[j]) r.h[a] -= K[i*n+j]*y[j];
+        for(size_t b=0;b<m;++b) r.K[a*m+b] = K[i*n+quedan[b]];
+    }
+    return r;
+}
+
+FactorCanonico FactorCanonico::marginalizar(const std::vector<int>& quitar) const{
+    const size_t n = vars.size();
+    std::vector<size_t> X, Y;
+    for(size_t i=0;i<n;++i)
+        (std::find(quitar.begin(), quitar.end(), vars[i])!=quitar.end()? Y : X).push_back(i);
+    const size_t p = X.size(), q = Y.size();
+    if(!q) return *this;
+
+    // Cholesky de K_YY = L·Lᵀ
+    std::vector<double> L(q*q, 0);
+    double logdet = 0;
+    for(size_t i=0;i<q;++i){
+        for(size_t j=0;j<=i;++j){
+            double s = K[Y[i]*n+Y[j]];
+            for(size_t k=0;k<j;++k) s -= L[i*q+k]*L[j*q+k];
+            if(i==j){
+                if(!(s>0)) throw std::runtime_error("Densidad gaussiana impropia al integrar variables continuas");
+                L[i*q+i] = std::sqrt(s);
+                logdet += 2*std::log(L[i*q+i]);
+            }else L[i*q+j] = s/L[j*q+j];
+        }
+    }
+    // resuelve K_YY·z = b (columna) con la factorización
+    auto resolver = [&](std::vector<double>& z){
+        for(size_t i=0;i<q;++i){
+            for(size_t k=0;k<i;++k) z[i] -= L[i*q+k]*z[k];
+            z[i] /= L[i*q+i];
+        }
+        for(size_t i=q; i-- > 0; ){
+            for(size_t k=i+1;k<q;++k) z[i] -= L[k*q+i]*z[k];
+            z[i] /= L[i*q+i];
+        }
+    };
+
+    FactorCanonico r;
+    std::vector<double> b(q);
+    for(size_t i=0;i<q;++i) b[i] = h[Y[i]];
+    resolver(b);                                    // K_YY⁻¹ h_Y
+    double hb = 0;
+    for(size_t i=0;i<q;++i) hb += h[Y[i]]*b[i];
+    r.g = g + 0.5*((double)q*std::log(2*M_PI) - logdet + hb);
+
+    // columnas de A = K_YY⁻¹ K_YX
+    std::vector<double> A(q*p);
+    std::vector<double> col(q);
+    for(size_t c=0;c<p;++c){
+        for(size_t i=0;i<q;++i) col[i] = K[Y[i]*n+X[c]];
+        resolver(col);
+        for(size_t i=0;i<q;++i) A[i*p+c] = col[i];
+    }
+    r.K.assign(p*p, 0);
+    r.h.assign(p, 0);
+    for(size_t a=0;a<p;++a){
+        r.vars.push_back(vars[X[a]]);
+        r.h[a] = h[X[a]];
+        for(size_t i=0;i<q;++i) r.h[a] -= K[X[a]*n+Y[i]]*b[i];
+        for(size_t c=0;c<p;++c){
+            double s = K[X[a]*n+X[c]];
+            for(size_t i=0;i<q;++i) s -= K[X[a]*n+Y[i]]*A[i*p+c];
+            r.K[a*p+c] = s;
+        }
+    }
+    return r;
+}
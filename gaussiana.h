@@ -0,0 +1,77 @@
+#ifndef GAUSSIANA_H
+#define GAUSSIANA_H
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Nodo;
+
+// Densidad gaussiana lineal condicional (CLG) de un nodo continuo:
+//   Y | u, x ~ N(media[u] + Σ_j coef[u][j]·x_j, varianza[u])
+// con `u` la combinación de padres discretos (una fila por combinación,
+// el primer padre es el más significativo, como en TablaProbabilidad) y
+// `x` los valores de los padres continuos. Los nodos discretos no pueden
+// tener padres continuos.
+struct GaussianaCondicional{
+    Nodo* variable = nullptr;
+    std::vector<Nodo*> padres;                // como en PARENTS
+
+    // filas tal como se leen del archivo: contexto sobre los padres
+    // discretos, "media coef_1 ... coef_k" y la varianza
+    struct FilaCarga{
+        std::vector<std::pair<std::string,std::string>> contexto;
+        std::vector<double> lineal;
+        double varianza = 0;
+    };
+    std::vector<FilaCarga> carga;
+
+    // tras finalizar(): padres por tipo y una fila por combinación discreta
+    std::vector<Nodo*> discretos, continuos;
+    struct Fila{
+        double media = 0;
+        std::vector<double> coef;             // uno por padre continuo
+        double varianza = 0;
+    };
+    std::vector<Fila> filas;
+
+    void establecer(Nodo* var, const std::vector<Nodo*>& ps);
+    void agregar_fila(const std::vector<std::pair<std::string,std::string>>& contexto,
+                      std::vector<double> lineal, double varianza);
+    // separa los padres por tipo (ya se conocen todos los nodos) y arma las
+    // filas; lanza si falta una combinación o sobran coeficientes
+    void finalizar();
+    bool finalizada() const { return !filas.empty(); }
+
+    // fila de la combinación `valores` (índice de valor por padre discreto)
+    size_t fila(const std::vector<int>& valores) const;
+
+    void imprimir(std::ostream& os) const;
+};
+
+// Factor gaussiano en forma canónica sobre variables continuas:
+//   φ(x) = exp(-½ xᵀKx + hᵀx + g)
+// El producto suma K, h y g; condicionar y marginalizar son cerrados, así
+// que la inferencia en la parte continua es exacta y no discretiza nada.
+struct FactorCanonico{
+    std::vector<int> vars;                    // ids de las variables
+    std::vector<double> K;                    // matriz de precisión (fila mayor)
+    std::vector<double> h;
+    double g = 0;
+
+    // p(y | x) = N(y; b0 + bᵀx, varianza) como factor sobre (x, y)
+    static FactorCanonico lineal(int y, const std::vector<int>& x, double b0,
+                                 const std::vector<double>& b, double varianza);
+
+    // multiplica por `o` en el lugar; las variables nuevas se agregan al final
+    void multiplicar(const FactorCanonico& o);
+    // fija las variables `fijas` en `valores` y las quita del alcance
+    FactorCanonico condicionar(const std::vector<int>& fijas, const std::vector<double>& valores) const;
+    // integra las variables `quitar`; lanza si su bloque de K no es
+    // definido positivo (densidad impropia)
+    FactorCanonico marginalizar(const std::vector<int>& quitar) const;
+
+    size_t dim() const { return vars.size(); }
+};
+
+#endif // GAUSSIANA_H
@@ -0,0 +1,286 @@
+#include "generador.h"
+#include "red_bayesiana.h"
+#include "eliminacion.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// los factores con más entradas que esto se emiten como bucles normales;
+// por debajo se desenrollan por completo con detalle::repetir<N>
+const size_t UMBRAL_DESENROLLADO = 64;
+
+// posterior<Q> guarda sus factores intermedios y los indicadores en la
+// pila de quien la llama; si entre todos pasan de este número de doubles
+// (256 KiB) la red se rechaza, porque podría desbordar la pila de un hilo
+const size_t MAX_DOUBLES_PILA = 32768;
+
+// identificador C++ válido a partir del nombre de una variable
+std::string identificador(const std::string& s){
+    std::string r;
+    for(char c: s) r += (std::isalnum((unsigned char)c)? c : '_');
+    return r;
+}
+
+// nombre de namespace válido: identificadores separados por "::"
+bool espacio_valido(const std::string& s){
+    size_t i = 0;
+    for(;;){
+        if(i>=s.size() || !(std::isalpha((unsigned char)s[i]) || s[i]=='_')) return false;
+        while(i<s.size() && (std::isalnum((unsigned char)s[i]) || s[i]=='_')) ++i;
+        if(i==s.size()) return true;
+        if(s.compare(i, 2, "::")!=0) return false;
+        i += 2;
+    }
+}
+
+// literal de cadena C++ (escapa comillas y barras)
+std::string literal(const std::string& s){
+    std::string r = "\"";
+    for(char c: s){ if(c=='"'||c=='\\') r += '\\'; r += c; }
+    return r + "\"";
+}
+
+// factor simbólico durante la generación: nombre del arreglo en el código
+// emitido, variables en el orden de su disposición y paso de cada una
+struct FactorSimbolico{
+    std::string nombre;
+    std::vector<int> vars;
+    std::vector<size_t> pasos;
+};
+
+std::vector<size_t> calcular_pasos(const std::vector<int>& vars, const std::vector<size_t>& card){
+    std::vector<size_t> pasos(vars.size(), 1);
+    for(size_t k=vars.size(); k-- > 1; ) pasos[k-1] = pasos[k]*card[vars[k]];
+    return pasos;
+}
+
+// expresión de índice del factor en función de las variables de bucle i<v>
+std::string indice(const FactorSimbolico& f){
+    std::string r;
+    for(size_t k=0;k<f.vars.size();++k){
+        if(!r.empty()) r += "+";
+        r += "i" + std::to_string(f.vars[k]);
+        if(f.pasos[k]!=1) r += "*" + std::to_string(f.pasos[k]);
+    }
+    return r.empty()? "0" : r;
+}
+
+// abre un bucle sobre la variable v: desenrollado o normal
+std::string abrir_bucle(int v, size_t card, bool desenrollar){
+    std::string i = "i" + std::to_string(v);
+    if(desenrollar) return "detalle::repetir<" + std::to_string(card) + ">([&](auto " + i + "){ ";
+    return "for(int " + i + "=0;" + i + "<" + std::to_string(card) + ";++" + i + "){ ";
+}
+
+std::string cerrar_bucle(bool desenrollar){ return desenrollar? "}); " : "} "; }
+
+} // namespace
+
+void generar_cabecera(const RedBayesiana& rb, std::ostream& os, const std::string& espacio){
+    if(!espacio_valido(espacio))
+        throw std::runtime_error("Nombre de namespace inválido: "+espacio);
+    // numeramos las variables en orden topológico (Nodo::id)
+    const std::vector<Nodo*>& orden = rb.grafo().orden;
+    const int n = (int)orden.size();
+    std::vector<size_t> card(n);
+    for(int v=0; v<n; ++v) card[v] = orden[v]->valores.size();
+
+    // un factor por CPT: padres en el orden de la tabla y luego la variable
+    std::vector<FactorSimbolico> cpts(n);
+    std::vector<std::vector<int>> alcances(n);
+    for(int v=0; v<n; ++v){
+        const Nodo* X = orden[v];
+        if(!X->cpt || !X->cpt->finalizada())
+            throw std::runtime_error(mensaje_sin_cpt(X));
+        X->cpt->exigir_densa("GENERAR");
+        for(size_t fila=0; fila<X->cpt->num_filas(); ++fila)
+            for(size_t k=0;k<card[v];++k)
+                if(std::isnan(X->cpt->prob(fila, k))) throw std::runtime_error("CPT incompleta: "+X->nombre);
+        cpts[v].nombre = "CPT_" + std::to_string(v);
+        for(Nodo* p: X->cpt->padres) cpts[v].vars.push_back(p->id);
+        cpts[v].vars.push_back(v);
+        cpts[v].pasos = calcular_pasos(cpts[v].vars, card);
+        alcances[v] = cpts[v].vars;
+    }
+
+    // orden de eliminación de cada consulta. Se comprueba antes de
+    // escribir nada cuánta pila necesitaría posterior<Q>: los factores
+    // intermedios viven todos hasta el final de la función
+    std::vector<std::vector<int>> ordenes(n);
+    size_t indicadores = 0;
+    for(size_t c: card) indicadores += c;
+    for(int q=0; q<n; ++q){
+        std::vector<bool> conservar(n, false);
+        conservar[q] = true;
+        ordenes[q] = orden_min_fill(alcances, card, conservar);
+        std::vector<std::vector<int>> activos = alcances;
+        size_t pila = indicadores;
+        for(int x: ordenes[q]){
+            std::vector<std::vector<int>> resto;
+            std::vector<int> alc;
+            for(auto& a: activos){
+                if(std::find(a.begin(), a.end(), x)==a.end()){ resto.push_back(std::move(a)); continue; }
+                for(int v: a) if(v!=x) alc.push_back(v);
+            }
+            std::sort(alc.begin(), alc.end());
+            alc.erase(std::unique(alc.begin(), alc.end()), alc.end());
+            size_t tam = 1;
+            for(int v: alc) tam = std::min(tam*card[v], MAX_DOUBLES_PILA+1);
+            pila = std::min(pila+tam, MAX_DOUBLES_PILA+1);
+            if(pila>MAX_DOUBLES_PILA)
+                throw std::runtime_error("posterior<"+std::to_string(q)+"> ("+orden[q]->nombre+
+                                         ") necesitaría más de "+std::to_string(MAX_DOUBLES_PILA)+
+                                         " doubles de pila en factores intermedios; use CONSULTAR_VE");
+            resto.push_back(std::move(alc));
+            activos.swap(resto);
+        }
+    }
+
+    std::string guarda = identificador(espacio) + "_H";
+    for(char& c: guarda) c = (char)std::toupper((unsigned char)c);
+
+    os.precision(17);
+    os << "// Cabecera generada con `bn ... 'GENERAR: ...'`. No editar a mano:\n"
+       << "// regenerarla cuando cambie la red.\n"
+       << "#ifndef " << guarda << "\n#define " << guarda << "\n"
+       << "#include <utility>\n#include <type_traits>\n\n"
+       << "namespace " << espacio << "{\n\n";
+
+    // --- metadatos de la red ---
+    os << "constexpr int NUM_VARIABLES = " << n << ";\n";
+    size_t max_card = 1;
+    for(size_t c: card) max_card = std::max(max_card, c);
+    os << "constexpr int MAX_CARDINALIDAD = " << max_card << ";\n"; // tamaño para `salida`
+    // nombres distintos pueden dar el mismo identificador ("a-b" y "a_b"):
+    // los nombres que ya son identificadores se conservan y el resto
+    // lleva un sufijo numérico si choca
+    std::unordered_set<std::string> usados;
+    std::vector<std::string> ids(n);
+    for(int v=0; v<n; ++v)
+        if(identificador(orden[v]->nombre)==orden[v]->nombre) usados.insert(ids[v] = orden[v]->nombre);
+    for(int v=0; v<n; ++v){
+        if(!ids[v].empty()) continue;
+        std::string base = identificador(orden[v]->nombre);
+        ids[v] = base;
+        for(int k=2; !usados.insert(ids[v]).second; ++k) ids[v] = base + "_" + std::to_string(k);
+    }
+    for(int v=0; v<n; ++v) os << "constexpr int V_" << ids[v] << " = " << v << ";\n";
+    os << "constexpr const char* NOMBRES[NUM_VARIABLES] = {";
+    for(int v=0; v<n; ++v) os << (v?", ":"") << literal(orden[v]->nombre);
+    os << "};\nconstexpr int CARDINALIDAD[NUM_VARIABLES] = {";
+    for(int v=0; v<n; ++v) os << (v?", ":"") << card[v];
+    os << "};\n";
+    for(int v=0; v<n; ++v){
+        os << "constexpr const char* VALORES_" << v << "[] = {";
+        for(size_t k=0;k<card[v];++k) os << (k?", ":"") << literal(orden[v]->valores[k]);
+        os << "};\n";
+    }
+    os << "constexpr const char* const* VALORES[NUM_VARIABLES] = {";
+    for(int v=0; v<n; ++v) os << (v?", ":"") << "VALORES_" << v;
+    os << "};\n\n";
+
+    // --- CPTs como datos constexpr ---
+    os << "// CPTs: fila = combinación de padres (el primero es el más significativo),\n"
+       << "// columna = valor de la variable\n";
+    for(int v=0; v<n; ++v){
+        const auto& T = *orden[v]->cpt;
+        // las CPTs compactas (noisy-OR, árboles) se expanden a tabla densa
+        os << "constexpr double " << cpts[v].nombre << "[" << T.num_filas()*card[v] << "] = {";
+        for(size_t fila=0; fila<T.num_filas(); ++fila)
+            for(size_t k=0;k<card[v];++k) os << (fila||k?", ":"") << T.prob(fila, k);
+        os << "}; // P(" << orden[v]->nombre;
+        for(size_t k=0;k<T.padres.size();++k) os << (k?",":" | ") << T.padres[k]->nombre;
+        os << ")\n";
+    }
+
+    // --- indicadores de evidencia ---
+    os << "\n// indicadores de evidencia: 1 para los valores compatibles con ev[v]\n"
+       << "// (ev[v] = índice del valor observado, o -1 si no se observa)\n"
+       << "struct Indicadores{\n";
+    for(int v=0; v<n; ++v) os << "    double v" << v << "[" << card[v] << "];\n";
+    os << "};\n\ninline void preparar_indicadores(const int* ev, Indicadores& l) noexcept{\n";
+    for(int v=0; v<n; ++v)
+        os << "    for(int k=0;k<" << card[v] << ";++k) l.v" << v
+           << "[k] = (ev[" << v << "]<0 || ev[" << v << "]==k)? 1.0 : 0.0;\n";
+    os << "}\n\n";
+
+    os << "namespace detalle{\n"
+       << "template<class F, int... I>\n"
+       << "inline void repetir_(F&& f, std::integer_sequence<int, I...>){ (f(std::integral_constant<int, I>{}), ...); }\n"
+       << "// llama a f con índices constantes 0..N-1: el bucle queda desenrollado\n"
+       << "template<int N, class F>\n"
+       << "inline void repetir(F&& f){ repetir_(f, std::make_integer_sequence<int, N>{}); }\n"
+       << "} // namespace detalle\n\n";
+
+    os << "// posterior<Q>: escribe P(Q | ev) en salida[0..CARDINALIDAD[Q]) y devuelve P(ev)\n"
+       << "template<int Q> double posterior(const int* ev, double* salida) noexcept;\n\n";
+
+    // --- una especialización por variable de consulta ---
+    for(int q=0; q<n; ++q){
+        const std::vector<int>& orden_elim = ordenes[q];
+
+        os << "// P(" << orden[q]->nombre << " | ev); orden de eliminación:";
+        for(int v: orden_elim) os << " " << orden[v]->nombre;
+        os << "\ntemplate<> inline double posterior<" << q << ">(const int* ev, double* salida) noexcept{\n"
+           << "    Indicadores l;\n    preparar_indicadores(ev, l);\n";
+
+        std::vector<FactorSimbolico> activos = cpts;
+        int siguiente = 0;
+        for(int x: orden_elim){
+            // factores que mencionan x: se multiplican y x se suma
+            std::vector<FactorSimbolico> usados, resto;
+            for(auto& f: activos)
+                (std::find(f.vars.begin(), f.vars.end(), x)!=f.vars.end()? usados : resto).push_back(f);
+            std::vector<int> alc;
+            for(auto& f: usados) for(int v: f.vars) if(v!=x) alc.push_back(v);
+            std::sort(alc.begin(), alc.end());
+            alc.erase(std::unique(alc.begin(), alc.end()), alc.end());
+
+            FactorSimbolico nuevo;
+            nuevo.nombre = "f" + std::to_string(siguiente++);
+            nuevo.vars = alc;
+            nuevo.pasos = calcular_pasos(alc, card);
+            size_t tam = 1;
+            for(int v: alc) tam *= card[v];
+            const bool desenrollar = tam*card[x] <= UMBRAL_DESENROLLADO;
+
+            os << "    double " << nuevo.nombre << "[" << tam << "]; // suma sobre "
+               << orden[x]->nombre << "\n    ";
+            for(int v: alc) os << abrir_bucle(v, card[v], desenrollar);
+            os << "double s = 0; " << abrir_bucle(x, card[x], desenrollar)
+               << "s += l.v" << x << "[i" << x << "]";
+            for(auto& f: usados) os << "*" << f.nombre << "[" << indice(f) << "]";
+            os << "; " << cerrar_bucle(desenrollar)
+               << nuevo.nombre << "[" << indice(nuevo) << "] = s; ";
+            for(size_t k=0;k<alc.size();++k) os << cerrar_bucle(desenrollar);
+            os << "\n";
+
+            resto.push_back(nuevo);
+            activos.swap(resto);
+        }
+
+        // los factores restantes solo dependen de Q (o son constantes)
+        os << "    double z = 0;\n    for(int i" << q << "=0;i" << q << "<" << card[q] << ";++i" << q
+           << "){ double p = l.v" << q << "[i" << q << "]";
+        for(auto& f: activos) os << "*" << f.nombre << "[" << indice(f) << "]";
+        os << "; salida[i" << q << "] = p; z += p; }\n"
+           << "    if(z>0) for(int k=0;k<" << card[q] << ";++k) salida[k] /= z;\n"
+           << "    return z;\n}\n\n";
+    }
+
+    // --- acceso por índice en tiempo de ejecución ---
+    os << "// consulta por índice de variable; devuelve P(ev) (0 si q no es válida)\n"
+       << "inline double consultar(int q, const int* ev, double* salida) noexcept{\n"
+       << "    switch(q){\n";
+    for(int q=0; q<n; ++q)
+        os << "        case " << q << ": return posterior<" << q << ">(ev, salida);\n";
+    os << "        default: return 0.0;\n    }\n}\n\n"
+       << "} // namespace " << espacio << "\n\n#endif // " << guarda << "\n";
+}
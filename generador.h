@@ -0,0 +1,23 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+#include <string>
+#include <ostream>
+
+struct RedBayesiana;
+
+// Genera una cabecera C++ autocontenida para una red de estructura fija.
+// Las CPTs, cardinalidades y nombres quedan como datos constexpr y, para
+// cada variable Q, se emite una especialización posterior<Q>(ev, salida)
+// con la eliminación de variables ya resuelta: el orden (min-fill) y las
+// formas de los factores se fijan al generar, los factores intermedios
+// viven en la pila y los bucles pequeños se desenrollan con plantillas.
+// La consulta no hace reservas de memoria ni despacho dinámico.
+//
+// Lanza std::runtime_error si una consulta necesitaría más de 32768
+// doubles (256 KiB) de pila, o si `espacio` no es un nombre de namespace
+// C++ (identificadores separados por "::"). `espacio` es el namespace
+// (y la base de la guarda de inclusión).
+void generar_cabecera(const RedBayesiana& rb, std::ostream& os,
+                      const std::string& espacio = "red_fija");
+
+#endif // GENERADOR_H
@@ -0,0 +1,125 @@
+#include "grafo.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+ConjuntoNodos AnalisisGrafo::cierre_ancestral(const ConjuntoNodos& s) const{
+    ConjuntoNodos r = s;
+    s.para_cada([&](size_t i){ r |= ancestros[i]; });
+    return r;
+}
+
+AnalisisGrafo AnalisisGrafo::calcular(const RedBayesiana& rb){
+    AnalisisGrafo g;
+    const size_t n = rb.nodos.size();
+
+    // orden topológico (algoritmo de Kahn): se encolan los nodos sin
+    // padres y, al procesar cada uno, se descuenta un padre a sus hijos.
+    // Nodo::id numera primero los nodos en el orden del mapa (para
+    // contar padres pendientes en un vector) y después es la posición
+    // topológica. Solo se escribe aquí, con el cerrojo de grafo().
+    std::vector<Nodo*> nodos;
+    for(const auto& kv: rb.nodos){
+        kv.second->id = (int)nodos.size();
+        nodos.push_back(kv.second.get());
+    }
+
+    // padres efectivos: los arcos de la estructura más los padres que
+    // declara la CPT (o la densidad) del nodo sin arco en la estructura.
+    // Los motores evalúan las CPTs, así que el orden y los ancestros deben
+    // contarlos; los hijos extra van detrás de los de la estructura para
+    // no alterar el orden cuando ambos coinciden.
+    std::vector<std::vector<Nodo*>> padres_ef(n), hijos_ef(n);
+    for(Nodo* x: nodos){
+        padres_ef[x->id] = x->padres;
+        hijos_ef[x->id] = x->hijos;
+    }
+    for(Nodo* x: nodos){
+        const std::vector<Nodo*>* declarados =
+            x->cpt? &x->cpt->padres : x->gauss? &x->gauss->padres : nullptr;
+        if(!declarados) continue;
+        auto& pe = padres_ef[x->id];
+        for(Nodo* p: *declarados)
+            if(std::find(pe.begin(), pe.end(), p)==pe.end()){
+                pe.push_back(p);
+                hijos_ef[p->id].push_back(x);
+            }
+    }
+
+    std::vector<int> indeg(n);
+    std::queue<Nodo*> q;
+    for(Nodo* x: nodos){
+        indeg[x->id] = (int)padres_ef[x->id].size();
+        if(indeg[x->id]==0) q.push(x);
+    }
+    while(!q.empty()){
+        Nodo* u = q.front(); q.pop();
+        g.orden.push_back(u);
+        for(Nodo* v: hijos_ef[u->id])
+            if(--indeg[v->id]==0) q.push(v);
+    }
+    // si quedan nodos sin procesar, todos tienen algún padre pendiente:
+    // forman (o dependen de) un ciclo dirigido
+    if(g.orden.size()!=n){
+        std::vector<std::string> en_ciclo;
+        for(Nodo* x: nodos) if(indeg[x->id]>0) en_ciclo.push_back(x->nombre);
+        std::sort(en_ciclo.begin(), en_ciclo.end());
+        std::string lista;
+        for(const auto& s: en_ciclo) lista += (lista.empty()? "" : ", ") + s;
+        throw std::runtime_error("La estructura tiene un ciclo dirigido entre: "+lista);
+    }
+
+    std::vector<int> provisional(n);
+    for(size_t i=0;i<n;++i){
+        provisional[i] = g.orden[i]->id;
+        g.orden[i]->id = (int)i;
+    }
+
+    // padres e hijos (efectivos) por id
+    g.inicio_padres.push_back(0);
+    g.inicio_hijos.push_back(0);
+    for(size_t i=0;i<n;++i){
+        for(Nodo* p: padres_ef[provisional[i]]) g.lista_padres.push_back((uint32_t)p->id);
+        for(Nodo* h: hijos_ef[provisional[i]]) g.lista_hijos.push_back((uint32_t)h->id);
+        g.inicio_padres.push_back((uint32_t)g.lista_padres.size());
+        g.inicio_hijos.push_back((uint32_t)g.lista_hijos.size());
+    }
+
+    // ancestros en orden topológico y descendientes en orden inverso:
+    // cada conjunto es la unión de los de sus padres (hijos) más ellos
+    g.ancestros.assign(n, ConjuntoNodos(n));
+    g.descendientes.assign(n, ConjuntoNodos(n));
+    for(size_t i=0;i<n;++i)
+        for(uint32_t k=g.inicio_padres[i]; k<g.inicio_padres[i+1]; ++k){
+            uint32_t p = g.lista_padres[k];
+            g.ancestros[i] |= g.ancestros[p];
+            g.ancestros[i].insertar(p);
+        }
+    for(size_t i=n; i-- > 0; )
+        for(uint32_t k=g.inicio_hijos[i]; k<g.inicio_hijos[i+1]; ++k){
+            uint32_t h = g.lista_hijos[k];
+            g.descendientes[i] |= g.descendientes[h];
+            g.descendientes[i].insertar(h);
+        }
+
+    // manto de Markov = vecinos en el grafo moral (se "casan" los padres
+    // de cada hijo)
+    g.manto.assign(n, ConjuntoNodos(n));
+    for(size_t i=0;i<n;++i){
+        for(uint32_t k=g.inicio_padres[i]; k<g.inicio_padres[i+1]; ++k){
+            uint32_t p = g.lista_padres[k];
+            g.manto[i].insertar(p);
+            g.manto[p].insertar((uint32_t)i);
+            for(uint32_t l=g.inicio_padres[i]; l<g.inicio_padres[i+1]; ++l)
+                if(g.lista_padres[l]!=p) g.manto[p].insertar(g.lista_padres[l]);
+        }
+    }
+    g.inicio_moral.push_back(0);
+    for(size_t i=0;i<n;++i){
+        g.manto[i].para_cada([&](size_t j){ g.lista_moral.push_back((uint32_t)j); });
+        g.inicio_moral.push_back((uint32_t)g.lista_moral.size());
+    }
+    return g;
+}
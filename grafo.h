@@ -0,0 +1,79 @@
+#ifndef GRAFO_H
+#define GRAFO_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct RedBayesiana; struct Nodo;
+
+// Conjunto de nodos como bitset denso indexado por Nodo::id.
+// Pertenencia, unión e intersección cuestan O(1) y O(n/64).
+class ConjuntoNodos{
+public:
+    explicit ConjuntoNodos(size_t n = 0): n_(n), bits_((n+63)/64, 0) {}
+
+    size_t capacidad() const { return n_; }
+    bool contiene(size_t i) const { return (bits_[i>>6] >> (i&63)) & 1u; }
+    void insertar(size_t i){ bits_[i>>6] |= uint64_t(1) << (i&63); }
+    void borrar(size_t i){ bits_[i>>6] &= ~(uint64_t(1) << (i&63)); }
+    void limpiar(){ for(auto& w: bits_) w = 0; }
+
+    ConjuntoNodos& operator|=(const ConjuntoNodos& o){ for(size_t k=0;k<bits_.size();++k) bits_[k] |= o.bits_[k]; return *this; }
+    ConjuntoNodos& operator&=(const ConjuntoNodos& o){ for(size_t k=0;k<bits_.size();++k) bits_[k] &= o.bits_[k]; return *this; }
+    ConjuntoNodos& operator-=(const ConjuntoNodos& o){ for(size_t k=0;k<bits_.size();++k) bits_[k] &= ~o.bits_[k]; return *this; }
+    bool operator==(const ConjuntoNodos& o) const { return n_==o.n_ && bits_==o.bits_; }
+    bool operator!=(const ConjuntoNodos& o) const { return !(*this==o); }
+
+    bool vacio() const { for(auto w: bits_) if(w) return false; return true; }
+    bool intersecta(const ConjuntoNodos& o) const {
+        for(size_t k=0;k<bits_.size();++k) if(bits_[k] & o.bits_[k]) return true;
+        return false;
+    }
+    size_t contar() const {
+        size_t c = 0;
+        for(auto w: bits_) c += (size_t)__builtin_popcountll(w);
+        return c;
+    }
+    // llama a f(i) para cada elemento, en orden creciente
+    template<class F> void para_cada(F f) const {
+        for(size_t k=0;k<bits_.size();++k)
+            for(uint64_t w = bits_[k]; w; w &= w-1)
+                f(k*64 + (size_t)__builtin_ctzll(w));
+    }
+    const std::vector<uint64_t>& palabras() const { return bits_; }
+
+private:
+    size_t n_;
+    std::vector<uint64_t> bits_;
+};
+
+// Metadatos del grafo calculados una sola vez por estructura (ver
+// RedBayesiana::grafo()). Los nodos se numeran en orden topológico:
+// orden[i]->id == i, de modo que "padre antes que hijo" es "id menor".
+// Todo se guarda en arreglos planos indexados por id.
+struct AnalisisGrafo{
+    std::vector<Nodo*> orden;                  // orden topológico
+    // padres e hijos de cada nodo (CSR): padres de i en
+    // lista_padres[inicio_padres[i] .. inicio_padres[i+1]). Incluyen los
+    // padres que declara la CPT (o la densidad) aunque falte el arco en
+    // la estructura: todo lo que sigue se calcula sobre ese grafo.
+    std::vector<uint32_t> inicio_padres, lista_padres;
+    std::vector<uint32_t> inicio_hijos, lista_hijos;
+    std::vector<ConjuntoNodos> ancestros;      // estrictos (sin el propio nodo)
+    std::vector<ConjuntoNodos> descendientes;  // estrictos
+    // manto de Markov: padres, hijos y otros padres de los hijos. Es
+    // también la vecindad del nodo en el grafo moral.
+    std::vector<ConjuntoNodos> manto;
+    // grafo moral como listas de adyacencia (CSR), para recorrerlo
+    std::vector<uint32_t> inicio_moral, lista_moral;
+
+    size_t num_nodos() const { return orden.size(); }
+    ConjuntoNodos vacio() const { return ConjuntoNodos(orden.size()); }
+    // S ∪ ancestros(S)
+    ConjuntoNodos cierre_ancestral(const ConjuntoNodos& s) const;
+
+    // Lanza std::runtime_error si el grafo tiene un ciclo dirigido.
+    static AnalisisGrafo calcular(const RedBayesiana& rb);
+};
+
+#endif // GRAFO_H
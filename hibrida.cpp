@@ -0,0 +1,213 @@
+#include "hibrida.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "factor.h"
+#include "gaussiana.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+bool es_hibrida(const RedBayesiana& rb){
+    for(const auto& kv: rb.nodos) if(kv.second->gauss) return true;
+    return false;
+}
+
+namespace{
+
+// raíz de la componente de v (unión por búsqueda con compresión)
+int raiz(std::vector<int>& padre, int v){
+    while(padre[v]!=v){ padre[v] = padre[padre[v]]; v = padre[v]; }
+    return v;
+}
+
+// mayor número de combinaciones de padres discretos que se enumeran por componente
+constexpr double MAX_COMBINACIONES = 1<<22;
+
+} // namespace
+
+ResultadoHibrido InferenciaHibrida::consultar(const std::string& variable,
+                                              const std::unordered_map<std::string,std::string>& evidencia) const{
+    const AnalisisGrafo& g = rb_.grafo();
+    const size_t n = g.orden.size();
+    const Nodo* Q = rb_.obtener(variable);
+    if(!Q) throw std::runtime_error("Variable desconocida: "+variable);
+    const int q = Q->id;
+
+    // evidencia: índice de valor (discretos) o número (continuos); la
+    // evidencia sobre la propia consulta se ignora, como en CONSULTAR
+    std::vector<int> ev(n, -1);
+    std::vector<bool> obs_cont(n, false);
+    std::vector<double> valor_cont(n, 0);
+    ConjuntoNodos fijados(n);
+    fijados.insertar((size_t)q);
+    for(const auto& kv: evidencia){
+        const Nodo* X = rb_.obtener(kv.first);
+        if(!X) throw std::runtime_error("Variable desconocida: "+kv.first);
+        if(X->id==q) continue;
+        if(X->gauss){
+            size_t usado = 0;
+            double x = 0;
+            try{ x = std::stod(kv.second, &usado); }catch(const std::exception&){ usado = 0; }
+            if(!usado || usado!=kv.second.size() || !std::isfinite(x))
+                throw std::runtime_error("Valor no numérico para el nodo continuo: "+kv.first+"="+kv.second);
+            obs_cont[X->id] = true;
+            valor_cont[X->id] = x;
+        }else{
+            auto it = std::find(X->valores.begin(), X->valores.end(), kv.second);
+            if(it==X->valores.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+            ev[X->id] = (int)(it-X->valores.begin());
+        }
+        fijados.insertar((size_t)X->id);
+    }
+    // los nodos fuera del cierre ancestral integran (o suman) 1
+    std::vector<bool> relevante(n, false);
+    g.cierre_ancestral(fijados).para_cada([&](size_t i){ relevante[i] = true; });
+
+    std::vector<size_t> card(n, 1);
+    for(size_t v=0; v<n; ++v) if(!g.orden[v]->gauss) card[v] = g.orden[v]->valores.size();
+    auto padres_de = [&](const Nodo* X) -> const std::vector<Nodo*>& {
+        const std::vector<Nodo*>& ps = X->gauss? X->gauss->padres : X->cpt->padres;
+        for(const Nodo* p: ps)
+            if(p->id<0 || p->id>=X->id || !relevante[(size_t)p->id])
+                throw std::runtime_error("La densidad de "+X->nombre+" usa un padre fuera de la estructura: "+p->nombre);
+        return ps;
+    };
+
+    // factores discretos: CPT reducida por la evidencia
+    std::vector<AlcanceFactor> alcances;
+    std::vector<std::vector<double>> datos;
+    std::vector<int> padre_uf(n);
+    std::iota(padre_uf.begin(), padre_uf.end(), 0);
+    for(size_t v=0; v<n; ++v){
+        if(!relevante[v]) continue;
+        const Nodo* X = g.orden[v];
+        if(X->gauss){
+            if(!X->gauss->finalizada()) throw std::runtime_error("Nodo continuo sin densidad: "+X->nombre);
+            for(const Nodo* p: padres_de(X))
+                if(p->gauss) padre_uf[raiz(padre_uf, p->id)] = raiz(padre_uf, (int)v);
+            continue;
+        }
+        if(!X->cpt || !X->cpt->finalizada()) throw std::runtime_error(mensaje_sin_cpt(X));
+        std::vector<int> vars, ev_padres;
+        for(const Nodo* p: padres_de(X)){
+            ev_padres.push_back(ev[p->id]);
+            if(ev[p->id]<0) vars.push_back(p->id);
+        }
+        if(ev[v]<0) vars.push_back((int)v);
+        alcances.push_back(AlcanceFactor::crear(vars, card));
+        datos.push_back(X->cpt->reducir(ev_padres, ev[v]));
+    }
+
+    // componentes continuas: verosimilitud por combinación de padres discretos
+    std::vector<std::vector<int>> componentes(n);
+    for(size_t v=0; v<n; ++v)
+        if(relevante[v] && g.orden[v]->gauss) componentes[raiz(padre_uf, (int)v)].push_back((int)v);
+
+    ResultadoHibrido res;
+    res.continua = (Q->gauss!=nullptr);
+    double log_escala = 0;                      // Σ de los máximos restados a cada componente
+    std::vector<int> libres_q;                  // padres discretos libres de la componente de la consulta
+    std::vector<double> media_q, varianza_q;    // por combinación de libres_q
+    std::vector<int> asig(n, 0);
+    for(size_t v=0; v<n; ++v) if(ev[v]>=0) asig[v] = ev[v];
+
+    for(const auto& comp: componentes){
+        if(comp.empty()) continue;
+        const bool con_consulta = std::find(comp.begin(), comp.end(), q)!=comp.end();
+        std::vector<int> discretos, fijas;
+        std::vector<double> valores;
+        for(int v: comp){
+            for(const Nodo* p: g.orden[v]->gauss->discretos) discretos.push_back(p->id);
+            if(obs_cont[v]){ fijas.push_back(v); valores.push_back(valor_cont[v]); }
+        }
+        // sin evidencia ni consulta la componente integra 1 (no puede pasar
+        // tras la poda, pero no cuesta comprobarlo)
+        if(fijas.empty() && !con_consulta) continue;
+        std::sort(discretos.begin(), discretos.end());
+        discretos.erase(std::unique(discretos.begin(), discretos.end()), discretos.end());
+        std::vector<int> libres;
+        double combinaciones = 1;
+        for(int d: discretos) if(ev[d]<0){ libres.push_back(d); combinaciones *= (double)card[d]; }
+        if(combinaciones > MAX_COMBINACIONES)
+            throw std::runtime_error("Demasiadas combinaciones de padres discretos en una componente continua");
+
+        AlcanceFactor a = AlcanceFactor::crear(libres, card);
+        std::vector<double> log_w(a.tam);
+        if(con_consulta){ libres_q = libres; media_q.assign(a.tam, 0); varianza_q.assign(a.tam, 0); }
+        for(int d: libres) asig[d] = 0;
+        std::vector<int> val_discretos;
+        for(size_t e=0; e<a.tam; ++e){
+            FactorCanonico f;
+            for(int v: comp){
+                const GaussianaCondicional& G = *g.orden[v]->gauss;
+                val_discretos.clear();
+                for(const Nodo* p: G.discretos) val_discretos.push_back(asig[p->id]);
+                const GaussianaCondicional::Fila& fl = G.filas[G.fila(val_discretos)];
+                std::vector<int> xs;
+                for(const Nodo* p: G.continuos) xs.push_back(p->id);
+                f.multiplicar(FactorCanonico::lineal(v, xs, fl.media, fl.coef, fl.varianza));
+            }
+            f = f.condicionar(fijas, valores);
+            if(con_consulta){
+                std::vector<int> resto;
+                for(int v: f.vars) if(v!=q) resto.push_back(v);
+                f = f.marginalizar(resto);
+                // queda φ(y) = exp(-½ K y² + h y + g): N(h/K, 1/K)
+                if(!(f.K[0]>0)) throw std::runtime_error("Densidad gaussiana impropia para "+Q->nombre);
+                media_q[e] = f.h[0]/f.K[0];
+                varianza_q[e] = 1/f.K[0];
+            }
+            log_w[e] = f.marginalizar(f.vars).g;
+            a.siguiente(card, asig);
+        }
+        // se resta el máximo para que exp() no se anule con densidades chicas
+        double mayor = -std::numeric_limits<double>::infinity();
+        for(double x: log_w) mayor = std::max(mayor, x);
+        log_escala += mayor;
+        std::vector<double> w(a.tam);
+        for(size_t e=0; e<a.tam; ++e) w[e] = std::exp(log_w[e]-mayor);
+        alcances.push_back(a);
+        datos.push_back(std::move(w));
+    }
+
+    // eliminación de variables discreta con la consulta (o los padres de su componente) conservados
+    std::vector<int> conservar = res.continua? libres_q : std::vector<int>{q};
+    PlanEliminacion plan = PlanEliminacion::compilar(alcances, card, conservar);
+    std::vector<const double*> punteros;
+    for(const auto& d: datos) punteros.push_back(d.data());
+    std::vector<double> salida;
+    plan.ejecutar(punteros, salida);
+    double z = 0;
+    for(double x: salida) z += x;
+    if(!(z>0)) throw std::runtime_error("Evidencia con probabilidad 0");
+    res.log_prob_evidencia = std::log(z) + log_escala;
+
+    if(!res.continua){
+        for(size_t k=0; k<salida.size(); ++k) res.distribucion.push_back({Q->valores[k], salida[k]/z});
+        return res;
+    }
+    // mezcla: salida recorre las combinaciones de libres_q en el mismo orden que media_q
+    AlcanceFactor a = AlcanceFactor::crear(libres_q, card);
+    for(int d: libres_q) asig[d] = 0;
+    double m2 = 0;
+    for(size_t e=0; e<a.tam; ++e){
+        ComponenteMezcla c;
+        for(size_t i=0; i<libres_q.size(); ++i){
+            if(i) c.contexto += ", ";
+            const Nodo* D = g.orden[libres_q[i]];
+            c.contexto += D->nombre+"="+D->valores[asig[libres_q[i]]];
+        }
+        c.peso = salida[e]/z;
+        c.media = media_q[e];
+        c.varianza = varianza_q[e];
+        a.siguiente(card, asig);
+        if(c.peso<=0) continue;
+        res.media += c.peso*c.media;
+        m2 += c.peso*(c.varianza + c.media*c.media);
+        res.mezcla.push_back(std::move(c));
+    }
+    res.varianza = std::max(0.0, m2 - res.media*res.media);
+    return res;
+}
@@ -0,0 +1,58 @@
+#ifndef HIBRIDA_H
+#define HIBRIDA_H
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct RedBayesiana;
+
+// Una gaussiana de la posterior de una variable continua: la que
+// corresponde a una combinación de los padres discretos de su componente
+struct ComponenteMezcla{
+    std::string contexto;      // "A=a, B=b" (vacío si no hay padres discretos libres)
+    double peso = 0;           // P(contexto | e)
+    double media = 0, varianza = 0;
+};
+
+struct ResultadoHibrido{
+    bool continua = false;
+    std::vector<std::pair<std::string,double>> distribucion;  // consulta discreta
+    std::vector<ComponenteMezcla> mezcla;                       // consulta continua
+    double media = 0, varianza = 0;                             // de toda la mezcla
+    // log p(e): con evidencia continua es una densidad, no una probabilidad
+    double log_prob_evidencia = 0;
+};
+
+// true si la red tiene algún nodo continuo
+bool es_hibrida(const RedBayesiana& rb);
+
+// Inferencia exacta en redes híbridas gaussianas lineales condicionales
+// (nodos continuos con padres discretos y continuos; los discretos solo
+// con padres discretos). Para cada consulta:
+//  - se podan los nodos fuera del cierre ancestral de consulta y evidencia;
+//  - los nodos continuos se agrupan en componentes conexas (arcos entre
+//    continuos). Para cada combinación de los padres discretos de una
+//    componente, sus densidades son gaussianas: se multiplican en forma
+//    canónica, se condiciona en la evidencia continua y se integra el
+//    resto. Queda la verosimilitud p(e_C | u) y, si la consulta es de la
+//    componente, su media y varianza;
+//  - las verosimilitudes entran como factores sobre los padres discretos
+//    en una eliminación de variables con las CPTs discretas reducidas.
+// Una consulta continua da una mezcla de gaussianas (una por combinación
+// de padres discretos libres de su componente); una discreta, su
+// distribución posterior. El coste crece con el número de combinaciones
+// de padres discretos de cada componente, no con ninguna discretización.
+class InferenciaHibrida{
+public:
+    explicit InferenciaHibrida(const RedBayesiana& rb): rb_(rb) {}
+
+    // evidencia por nombres; los valores de los nodos continuos son números
+    ResultadoHibrido consultar(const std::string& variable,
+                               const std::unordered_map<std::string,std::string>& evidencia) const;
+
+private:
+    const RedBayesiana& rb_;
+};
+
+#endif // HIBRIDA_H
@@ -2,159 +2,262 @@
 #include "red_bayesiana.h"
 #include "nodo.h"
 #include "tabla_probabilidad.h"
-#include <queue>
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 #include <sstream>
 
-// función estática que calcula el orden topológico de los nodos
-// usando el algoritmo de Kahn para grafos dirigidos acíclicos
-// el orden topológico es fundamental para la enumeración porque
-// garantiza que procesamos padres antes que hijos
-static std::vector<Nodo*> orden_topologico(const RedBayesiana& rb){
-    // algoritmo de Kahn para orden topologico.
-    // Utilizamos un mapa de grados de entrada y una cola de nodos de grado de entrada cero.
+// constructor del motor de inferencia
+// toma el orden topológico del análisis del grafo de la red, que se
+// calcula una sola vez por estructura y se reutiliza en todas las consultas
+InferenceEngine::InferenceEngine(const RedBayesiana& rb)
+    : rb_(rb), // guardamos referencia a la red bayesiana
+      orden_(rb.grafo().orden) // orden topológico (orden_[i]->id == i)
+{
+}
+
+InferenceEngine::InferenceEngine(std::shared_ptr<const RedBayesiana> rb)
+    : propia_(std::move(rb)), rb_(*propia_), orden_(rb_.grafo().orden)
+{
+}
+
+// pre-pasada de evidencia: se ejecuta una vez por consulta
+// traduce la evidencia a índices de valores y reduce cada CPT relevante
+// a la subtabla de los valores observados, de modo que la recursión
+// nunca vuelve a consultar la evidencia ni a buscar claves de texto
+InferenceEngine::Consulta InferenceEngine::preparar(
+    const std::unordered_map<std::string,std::string>& evidencia,
+    const Nodo* consulta, bool podar, bool descomponer) const{
+    
+    const size_t n = orden_.size();
+    Consulta c;
+    c.asig.assign(n, -1);
+    c.libre.assign(n, true);
     
-    // mapa que almacena el grado de entrada (número de padres) de cada nodo
-    std::unordered_map<Nodo*,int> indeg; 
-    // cola para procesar nodos que tienen indegree 0 (sin padres pendientes)
-    std::queue<Nodo*> q; 
-    // vector que almacenará el resultado del orden topológico
-    std::vector<Nodo*> topo;
+    // traducimos la evidencia a (posición, índice de valor)
+    for(const auto &kv: evidencia){
+        const Nodo* X = rb_.obtener(kv.first);
+        if(!X) 
+            throw std::runtime_error("Variable desconocida: "+kv.first);
+        // la evidencia sobre la propia variable de consulta se ignora:
+        // el bucle externo le asigna cada uno de sus valores
+        if(X==consulta) continue;
+        size_t pos = (size_t)X->id;
+        int k = -1;
+        for(size_t j=0;j<X->valores.size();++j) 
+            if(X->valores[j]==kv.second) k = (int)j;
+        if(k<0) 
+            throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        c.asig[pos] = k;
+        c.libre[pos] = false;
+    }
+    // la variable de consulta no se enumera: la fija el bucle externo
+    if(consulta) c.libre[(size_t)consulta->id] = false;
     
-    // Primera pasada: inicializar indegrees de todos los nodos
-    // contamos cuántos padres tiene cada nodo y encolamos las raíces
-    for(const auto &kv: rb.nodos){
-        // obtenemos el puntero al nodo desde el unique_ptr
-        auto* n = kv.second.get();
-        // el indegree es igual al número de padres del nodo
-        indeg[n] = (int)n->padres.size();
-        // si el nodo no tiene padres (indegree 0), es una raíz
-        // las raíces se pueden procesar inmediatamente
-        if(indeg[n] == 0) q.push(n);
+    // nodos relevantes: ancestros de la consulta y de la evidencia. El resto
+    // son nodos "estériles" cuya suma sobre sus valores vale 1. Con los
+    // bitsets de ancestros del análisis del grafo es una unión por nodo fijado.
+    std::vector<bool> relevante(n, !podar);
+    if(podar){
+        const AnalisisGrafo& g = rb_.grafo();
+        ConjuntoNodos fijados = g.vacio();
+        for(size_t i=0;i<n;++i) 
+            if(!c.libre[i]) fijados.insertar(i);
+        g.cierre_ancestral(fijados).para_cada([&](size_t i){ relevante[i] = true; });
     }
     
-    // Segunda pasada: procesamos nodos en orden topológico
-    // cada vez que procesamos un nodo, "eliminamos" sus aristas salientes
-    // decrementando el indegree de sus hijos
-    while(!q.empty()){
-        // extraemos el siguiente nodo con indegree 0 de la cola
-        auto* u = q.front(); 
-        q.pop();
-        // agregamos este nodo al orden topológico
-        topo.push_back(u);
+    // reducimos la CPT de cada nodo relevante
+    c.en_posicion.resize(n);
+    for(size_t pos=0; pos<n; ++pos){
+        if(!relevante[pos]) continue;
+        Nodo* Y = orden_[pos];
+        if(!Y->cpt || !Y->cpt->finalizada()) 
+            throw std::runtime_error(mensaje_sin_cpt(Y));
+        const TablaProbabilidad& T = *Y->cpt;
         
-        // decrementamos el indegree de cada hijo del nodo actual
-        // esto simula "eliminar" la arista u -> v
-        for(auto* v: u->hijos){
-            // decrementamos el indegree y verificamos si llega a 0
-            // si llega a 0, significa que ya procesamos todos sus padres
-            if(--indeg[v] == 0) 
-                // encolamos el hijo para procesarlo en la siguiente iteración
-                q.push(v);
+        // valores observados de los padres (solo evidencia: la variable de
+        // consulta todavía no está asignada y queda libre en el factor)
+        std::vector<int> ev_padres(T.padres.size(), -1);
+        std::vector<size_t> pos_padre(T.padres.size());
+        for(size_t k=0;k<T.padres.size();++k){
+            size_t pp = (size_t)T.padres[k]->id;
+            // la enumeración asigna las variables en orden topológico: un
+            // padre posterior al hijo no tendría valor al evaluar el factor
+            if(pp>pos || !relevante[pp]) 
+                throw std::runtime_error("CPT de "+Y->nombre+" usa un padre fuera de la estructura: "+T.padres[k]->nombre);
+            pos_padre[k] = pp;
+            if(!c.libre[pp] && orden_[pp]!=consulta) ev_padres[k] = c.asig[pp];
         }
+        int ev_var = (Y==consulta)? -1 : c.asig[pos];
+        
+        // el modelo local decide cómo se reparte en factores: un noisy-OR
+        // con hallazgo negativo da un factor por padre en vez de una tabla,
+        // y con cualquier otra evidencia (o libre) un noisy grande se
+        // descompone con una auxiliar Y' en lugar de expandirse
+        size_t aux = SIZE_MAX;
+        for(auto& fl: T.factorizar(ev_padres, ev_var, descomponer && ev_var!=0)){
+            FactorReducido f;
+            for(size_t k: fl.padres_libres) f.vars.push_back(pos_padre[k]);
+            if(fl.con_variable) f.vars.push_back(pos);
+            f.origen = pos;
+            if(fl.con_auxiliar){
+                if(aux==SIZE_MAX){
+                    aux = c.asig.size();
+                    c.auxiliar_de.push_back(pos);
+                    c.asig.push_back(-1);
+                    c.libre.push_back(true);
+                    c.en_posicion.emplace_back();
+                    c.pasos.push_back(aux);
+                }
+                f.vars.push_back(aux);
+                // los factores de los padres y la fuga son "la CPT de Y'";
+                // el de Δ, que también nombra a Y, sigue siendo de Y
+                if(!fl.con_variable) f.origen = aux;
+            }
+            f.valores = std::move(fl.valores);
+            
+            // un factor sin variables libres es una constante: se multiplica
+            // una sola vez en lugar de evaluarlo en cada rama de la recursión
+            if(f.vars.empty()){ c.constante *= f.valores[0]; continue; }
+            
+            // pasos: la última variable varía más rápido
+            f.pasos.assign(f.vars.size(), 1);
+            for(size_t k=f.vars.size(); k-- > 1; ) 
+                f.pasos[k-1] = f.pasos[k]*nodo_de(c, f.vars[k])->valores.size();
+            // se evalúa en la última de sus variables en el orden de la
+            // recursión; la auxiliar de Y va justo antes de Y
+            auto rango = [&](size_t v){ return v<n? 2*v+1 : 2*c.auxiliar_de[v-n]; };
+            size_t ultima = f.vars[0];
+            for(size_t v: f.vars) if(rango(v)>rango(ultima)) ultima = v;
+            c.en_posicion[ultima].push_back(c.factores.size());
+            c.factores.push_back(std::move(f));
+        }
+        if(c.libre[pos] || Y==consulta) c.pasos.push_back(pos);
     }
-    // retornamos el vector con el orden topológico completo
-    return topo;
+    return c;
 }
 
-// constructor del motor de inferencia
-// recibe la red bayesiana y calcula su orden topológico
-// el orden topológico se guarda para reutilizarlo en múltiples consultas
-InferenceEngine::InferenceEngine(const RedBayesiana& rb)
-    : rb_(rb), // guardamos referencia a la red bayesiana
-      orden_(orden_topologico(rb)) // calculamos y guardamos el orden topológico
-{}
+// lanza ConsultaInterrumpida si la consulta fue cancelada o venció su plazo
+static void comprobar_limite(const LimiteConsulta& l){
+    if(l.cancelada && l.cancelada->load(std::memory_order_relaxed)) throw ConsultaInterrumpida(false);
+    if(std::chrono::steady_clock::now() >= l.plazo) throw ConsultaInterrumpida(true);
+}
+
+// evalúa un factor reducido con la asignación actual de la consulta
+static inline double evaluar(const std::vector<size_t>& vars, const std::vector<size_t>& pasos,
+                             const std::vector<double>& valores, const std::vector<int>& asig){
+    size_t idx = 0;
+    for(size_t k=0;k<vars.size();++k) idx += (size_t)asig[vars[k]]*pasos[k];
+    return valores[idx];
+}
 
 // función recursiva que implementa la enumeración completa
 // esta es la función core del algoritmo de inferencia por enumeración
 // calcula P(X1,...,Xn | evidencia) donde X1,...,Xn son las variables no observadas
 // 
 // Parámetros:
-// i: índice actual en el orden topológico (qué variable estamos procesando)
-// evidencia: mapa mutable con las asignaciones de variables (observadas y temporales)
+// i: índice actual en la lista de posiciones relevantes (c.pasos)
+// c: estado de la consulta con los factores ya reducidos por la evidencia
 // trace: stream opcional para imprimir traza de ejecución (debugging)
 // depth: profundidad actual de recursión (solo para indentación en traza)
 double InferenceEngine::enumerar_todo(size_t i, 
-                                      std::unordered_map<std::string,std::string>& evidencia,
+                                      Consulta& c,
                                       std::ostream* trace, 
                                       int depth) const{
     // caso base de la recursión: si ya procesamos todas las variables
     // retornamos 1.0 porque no quedan más factores que multiplicar
-    if(i==orden_.size()) return 1.0;
+    if(i==c.pasos.size()) return 1.0;
+
+    // el límite se mira cada 4096 visitas: leer el reloj en cada nodo
+    // costaría más que la propia enumeración
+    if(c.limite && (++c.visitas & 4095)==0) comprobar_limite(*c.limite);
     
-    // obtenemos la variable Y que corresponde al índice i en el orden topológico
-    Nodo* Y = orden_[i];
+    // obtenemos la variable Y que corresponde al índice i y los factores
+    // reducidos que quedan completos al asignarla
+    const size_t pos = c.pasos[i];
+    const Nodo* Y = nodo_de(c, pos);
+    const std::vector<size_t>& ids = c.en_posicion[pos];
+    // en la traza la auxiliar de un noisy descompuesto se llama Y'
+    const std::string nombre = trace? Y->nombre+(pos<orden_.size()? "" : "'") : std::string();
     
-    // buscamos si Y está en la evidencia (observada o temporalmente asignada)
-    auto it = evidencia.find(Y->nombre);
+    // producto de esos factores; en `propio` queda el de la CPT de Y
+    // (P(Y=y | padres)), el resto son CPTs de nodos observados
+    auto producto = [&](double& propio){
+        double resto = 1.0;
+        propio = 1.0;
+        for(size_t id: ids){
+            const FactorReducido& f = c.factores[id];
+            double v = evaluar(f.vars, f.pasos, f.valores, c.asig);
+            if(f.origen==pos) propio *= v; else resto *= v;
+        }
+        return propio*resto;
+    };
+    // en la traza, cada factor de evidencia que se aplica en esta posición
+    auto mostrar_evidencia = [&](const std::string& sangria){
+        for(size_t id: ids){
+            const FactorReducido& f = c.factores[id];
+            if(f.origen==pos) continue;
+            const Nodo* E = nodo_de(c, f.origen);
+            (*trace) << sangria << "Usando evidencia: " << E->nombre << "=" 
+                     << E->valores[c.asig[f.origen]] << " -> P=" 
+                     << evaluar(f.vars, f.pasos, f.valores, c.asig) << "\n";
+        }
+    };
     
     // creamos string de indentación para hacer la traza más legible
     // cada nivel de profundidad añade 2 espacios
-    std::string indent(depth*2, ' ');
+    std::string indent(trace? depth*2 : 0, ' ');
     
-    // verificamos si Y está en la evidencia
-    if(it!=evidencia.end()){
-        // Caso 1: la variable Y está fijada por la evidencia
-        // esto significa que Y es una variable observada o fue asignada
-        // temporalmente en una iteración anterior de la enumeración
+    // verificamos si Y está fijada (evidencia o variable de consulta)
+    if(!c.libre[pos]){
+        // Caso 1: la variable Y está fijada
         // No debemos sumar sobre sus valores: usamos directamente la
         // probabilidad condicional P(Y = y | padres) y seguimos.
-        
-        // obtenemos P(Y = valor_observado | valores_de_padres)
-        // la CPT consulta los valores de los padres en el mapa evidencia
-        double py = Y->cpt->condicionada(evidencia, it->second);
+        double propio;
+        double py = producto(propio);
         
         // si hay traza activa, imprimimos que usamos evidencia
         if(trace){ 
             (*trace) << indent << "Usando evidencia: "
-                    << Y->nombre << "=" << it->second 
-                    << " -> P=" << py << "\n"; 
+                    << Y->nombre << "=" << Y->valores[c.asig[pos]] 
+                    << " -> P=" << propio << "\n"; 
+            mostrar_evidencia(indent);
         }
         
         // multiplicamos por la probabilidad condicional y continuamos
-        // con la siguiente variable (i+1) en el orden topológico
-        // incrementamos depth para la indentación en la siguiente llamada
-        return py * enumerar_todo(i+1, evidencia, trace, depth+1);
+        return py * enumerar_todo(i+1, c, trace, depth+1);
     }else{
         // Caso 2: la variable Y no está en la evidencia
         // debemos marginalizar (sumar) sobre todos los posibles valores de Y
         // esto implementa: Σ_y P(Y=y | padres) * P(resto | Y=y, evidencia)
-        
-        // acumulador para la suma sobre todos los valores de Y
         double suma=0.0;
         
         // si hay traza, indicamos que vamos a enumerar sobre Y
         if(trace){ 
-            (*trace) << indent << "Enumerando " << Y->nombre 
+            (*trace) << indent << "Enumerando " << nombre 
                     << " sobre " << Y->valores.size() << " valores\n"; 
         }
         
-        // iteramos sobre cada posible valor que puede tomar Y
-        for(const std::string& y: Y->valores){
-            // asignamos temporalmente Y=y en el mapa de evidencia
-            // esto permite que las llamadas recursivas vean este valor
-            evidencia[Y->nombre]=y;
+        // iteramos sobre cada posible valor (índice) que puede tomar Y
+        for(size_t y=0; y<Y->valores.size(); ++y){
+            // asignamos temporalmente Y=y para las llamadas recursivas
+            c.asig[pos] = (int)y;
             
-            // obtenemos P(Y=y | padres) dado el contexto actual
-            double py = Y->cpt->condicionada(evidencia, y);
+            // obtenemos P(Y=y | padres) y los factores de evidencia que
+            // dependen de Y (y de variables anteriores)
+            double propio;
+            double py = producto(propio);
             
-            // si hay traza, mostramos el valor que estamos probando
             if(trace){ 
-                (*trace) << indent << "  Probar " << Y->nombre 
-                        << "=" << y << " -> P=" << py << "\n"; 
+                (*trace) << indent << "  Probar " << nombre 
+                        << "=" << Y->valores[y] << " -> P=" << propio << "\n"; 
+                mostrar_evidencia(indent+"    ");
             }
             
-            // llamada recursiva para procesar las variables restantes
-            // con Y fijado temporalmente a este valor
-            // el resultado es P(resto | Y=y, evidencia)
-            double sub = enumerar_todo(i+1, evidencia, trace, depth+2);
-            
-            // calculamos la contribución de este valor específico de Y
-            // que es: P(Y=y | padres) * P(resto | Y=y, evidencia)
+            // llamada recursiva: P(resto | Y=y, evidencia)
+            double sub = enumerar_todo(i+1, c, trace, depth+2);
             double contrib = py * sub;
             
-            // Cada valor de Y contribuye con P(Y=y | padres) * (suma
-            // recursiva sobre las variables posteriores).
             if(trace){ 
                 (*trace) << indent << "  Resultado recursivo: " << sub 
                         << " contrib=" << contrib << "\n"; 
@@ -162,19 +265,14 @@ double InferenceEngine::enumerar_todo(size_t i,
             
             // acumulamos la contribución de este valor a la suma total
             suma += contrib;
-            
-            // IMPORTANTE: removemos Y del mapa de evidencia antes de
-            // probar el siguiente valor, para no contaminar iteraciones
-            evidencia.erase(Y->nombre);
         }
+        // IMPORTANTE: dejamos Y sin asignar para no contaminar otras ramas
+        c.asig[pos] = -1;
         
-        // si hay traza, mostramos el resultado final de la suma
         if(trace){ 
-            (*trace) << indent << "Suma para " << Y->nombre 
+            (*trace) << indent << "Suma para " << nombre 
                     << " = " << suma << "\n"; 
         }
-        
-        // retornamos la suma sobre todos los valores de Y
         return suma;
     }
 }
@@ -192,58 +290,49 @@ double InferenceEngine::enumerar_todo(size_t i,
 std::vector<std::pair<std::string,double>> InferenceEngine::consultar_enumeracion(
     const std::string& variable,
     const std::unordered_map<std::string,std::string>& evidencia,
-    std::ostream* trace) const{
+    std::ostream* trace,
+    const LimiteConsulta* limite) const{
 
     // verificamos que la variable de consulta exista en la red
-    auto it = rb_.nodos.find(variable);
-    if(it==rb_.nodos.end()) 
+    const Nodo* Q = rb_.obtener(variable);
+    if(!Q) 
         throw std::runtime_error("Variable desconocida: "+variable);
-    
-    // obtenemos el puntero al nodo de la variable de consulta
-    Nodo* Q = it->second.get();
+    const size_t pos_q = (size_t)Q->id;
+
+    // pre-pasada: la evidencia se instancia en las CPTs una sola vez
+    Consulta c = preparar(evidencia, Q, true, true);
+    c.limite = limite;
+    if(limite) comprobar_limite(*limite);
+    if(trace){
+        (*trace) << "Factores reducidos por la evidencia: " << c.factores.size()
+                 << " (constante=" << c.constante << ")\n";
+    }
 
-    // vector que contendrá la distribución de probabilidad resultante
-    // cada entrada es un par (valor, probabilidad)
     std::vector<std::pair<std::string,double>> dist; 
-    // reservamos espacio para evitar realocaciones
     dist.reserve(Q->valores.size());
     
     // calculamos la probabilidad conjunta no normalizada para cada valor
-    // iteramos sobre todos los posibles valores de la variable de consulta
-    for(const std::string& x: Q->valores){
-        // Para cada valor x de la variable de consulta, creamos una
-        // evidencia extendida que incluye la asignación variable=x
-        auto e = evidencia; // copiamos la evidencia original
-        e[variable] = x; // agregamos la asignación variable=x
+    for(size_t x=0; x<Q->valores.size(); ++x){
+        // fijamos variable=x en la asignación de la consulta
+        c.asig[pos_q] = (int)x;
         
-        // si hay traza, mostramos qué estamos calculando
         if(trace){ 
-            (*trace) << "--- Calcular P(" << variable << "=" << x 
+            (*trace) << "--- Calcular P(" << variable << "=" << Q->valores[x] 
                     << " , evidencia) ---\n"; 
         }
         
-        // llamamos a enumerar_todo empezando desde el primer nodo (índice 0)
-        // esto calcula P(variable=x, evidencia) = P(variable=x ∧ evidencia)
-        // que es la probabilidad conjunta no normalizada
-        double v = enumerar_todo(0, e, trace, 0);
+        // P(variable=x, evidencia): producto de los factores constantes por
+        // la enumeración sobre las variables libres relevantes
+        double v = c.constante * enumerar_todo(0, c, trace, 0);
         
-        // si hay traza, mostramos el valor calculado
         if(trace){ 
-            (*trace) << "  => P_unorm(" << variable << "=" << x 
+            (*trace) << "  => P_unorm(" << variable << "=" << Q->valores[x] 
                     << ") = " << v << "\n\n"; 
         }
-        
-        // v es la probabilidad no normalizada; la normalización se
-        // hace después de computar todas las entradas de la distribución
-        // para normalizar necesitamos dividir por la suma de todas las probabilidades
-        dist.push_back({x, v});
+        dist.push_back({Q->valores[x], v});
     }
     
-    // Fase de normalización: necesitamos dividir cada probabilidad por Z
-    // donde Z = Σ P(variable=x, evidencia) para todos los valores x
-    // esto da P(variable=x | evidencia) = P(variable=x, evidencia) / Z
-    
-    // calculamos la constante de normalización Z
+    // Fase de normalización: P(variable=x | evidencia) = P(variable=x, evidencia) / Z
     double Z=0; 
     for(auto &p: dist) 
         Z+=p.second; 
@@ -252,11 +341,9 @@ std::vector<std::pair<std::string,double>> InferenceEngine::consultar_enumeracio
     if(Z==0) 
         throw std::runtime_error("Normalización 0");
     
-    // normalizamos dividiendo cada probabilidad por Z
     for(auto &p: dist) 
         p.second/=Z;
     
-    // si hay traza, mostramos información de la normalización
     if(trace){ 
         (*trace) << "Normalización Z=" << Z << "\n"; 
         (*trace) << "Distribución normalizada:\n"; 
@@ -264,6 +351,71 @@ std::vector<std::pair<std::string,double>> InferenceEngine::consultar_enumeracio
             (*trace) << p.first << ": " << p.second << "\n"; 
     }
     
-    // retornamos la distribución de probabilidad normalizada
     return dist;
-}
\ No newline at end of file
+}
+
+// búsqueda en profundidad para la MPE: recorre el orden topológico
+// multiplicando los factores reducidos y ramificando sobre los valores de
+// las variables no observadas. Como cada factor es <= 1, el producto
+// parcial `acumulado` es una cota superior de cualquier completación, así
+// que podemos podar las ramas que ya no superan la mejor encontrada.
+void InferenceEngine::maximizar_todo(size_t i, Consulta& c,
+                                     double acumulado, double& mejor,
+                                     std::vector<int>& mejor_asig) const{
+    // poda: ninguna completación puede superar a la mejor actual
+    if(acumulado<=mejor) return;
+    
+    // asignación completa: es la nueva mejor
+    if(i==c.pasos.size()){ 
+        mejor = acumulado; 
+        mejor_asig = c.asig; 
+        return; 
+    }
+    
+    const size_t pos = c.pasos[i];
+    // producto de los factores que quedan completos en esta posición
+    auto producto = [&](){
+        double p = 1.0;
+        for(size_t id: c.en_posicion[pos]){
+            const FactorReducido& f = c.factores[id];
+            p *= evaluar(f.vars, f.pasos, f.valores, c.asig);
+        }
+        return p;
+    };
+    if(!c.libre[pos]){
+        // variable fijada: solo contribuye con sus factores
+        maximizar_todo(i+1, c, acumulado*producto(), mejor, mejor_asig);
+        return;
+    }
+    
+    // variable libre: probamos cada valor (maximización en lugar de suma)
+    for(size_t y=0; y<orden_[pos]->valores.size(); ++y){
+        c.asig[pos] = (int)y;
+        maximizar_todo(i+1, c, acumulado*producto(), mejor, mejor_asig);
+    }
+    c.asig[pos] = -1;
+}
+
+// calcula la explicación más probable de la evidencia
+std::vector<std::pair<std::string,std::string>> InferenceEngine::mpe(
+    const std::unordered_map<std::string,std::string>& evidencia,
+    double& prob) const{
+    
+    // sin poda: en la MPE todas las variables libres forman parte de la
+    // explicación, también las que no tienen descendientes observados.
+    // Sin descomponer: la poda supone factores entre 0 y 1.
+    Consulta c = preparar(evidencia, nullptr, false, false);
+    std::vector<int> mejor_asig;
+    // empezamos con mejor=0 para que cualquier asignación posible la supere
+    prob = 0.0;
+    maximizar_todo(0, c, c.constante, prob, mejor_asig);
+    if(prob==0) 
+        throw std::runtime_error("Evidencia con probabilidad 0");
+    
+    // devolvemos la asignación en orden topológico
+    std::vector<std::pair<std::string,std::string>> res;
+    res.reserve(orden_.size());
+    for(size_t i=0;i<orden_.size();++i) 
+        res.push_back({orden_[i]->nombre, orden_[i]->valores[mejor_asig[i]]});
+    return res;
+}
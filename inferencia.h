@@ -5,32 +5,108 @@
 #include <unordered_map>
 #include <utility>
 #include <ostream>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
 
 struct RedBayesiana; struct Nodo;
 
+// Límite cooperativo de una consulta: la enumeración lo comprueba cada
+// cierto número de nodos visitados y, si se cumple, abandona la consulta
+// lanzando ConsultaInterrumpida. `cancelada` puede ser nullptr.
+struct LimiteConsulta{
+    const std::atomic<bool>* cancelada = nullptr;
+    std::chrono::steady_clock::time_point plazo = std::chrono::steady_clock::time_point::max();
+};
+
+struct ConsultaInterrumpida : std::runtime_error{
+    bool por_plazo; // false = cancelada
+    explicit ConsultaInterrumpida(bool plazo)
+        : std::runtime_error(plazo? "plazo agotado" : "consulta cancelada"), por_plazo(plazo) {}
+};
+
 // Clase orientada a objetos para realizar inferencia por enumeración.
 // Permite habilitar una traza paso a paso enviando un std::ostream* (por ejemplo &std::cout).
 class InferenceEngine{
 public:
     explicit InferenceEngine(const RedBayesiana& rb);
+    // Comparte la propiedad de la red: el motor la mantiene viva aunque
+    // quien la publicó ya la haya reemplazado (ver ModeloVivo).
+    explicit InferenceEngine(std::shared_ptr<const RedBayesiana> rb);
 
     // Realiza la consulta para la variable dada con la evidencia provista.
     // Si 'trace' != nullptr, se emitirá una traza paso a paso en ese stream.
+    // Con 'limite' la consulta lanza ConsultaInterrumpida si se cancela o
+    // vence el plazo antes de terminar.
     std::vector<std::pair<std::string,double>> consultar_enumeracion(
         const std::string& variable,
         const std::unordered_map<std::string,std::string>& evidencia,
-        std::ostream* trace = nullptr) const;
+        std::ostream* trace = nullptr,
+        const LimiteConsulta* limite = nullptr) const;
+
+    // Explicación más probable (MPE): asignación completa de las variables
+    // no observadas que maximiza P(x, evidencia). Devuelve los pares
+    // (variable, valor) en orden topológico y, en `prob`, P(x, evidencia).
+    std::vector<std::pair<std::string,std::string>> mpe(
+        const std::unordered_map<std::string,std::string>& evidencia,
+        double& prob) const;
+
+    // orden topológico usado por el motor (también el de la salida de mpe)
+    const std::vector<Nodo*>& orden() const { return orden_; }
 
 private:
+    std::shared_ptr<const RedBayesiana> propia_; // vacía si la red es del llamador
     const RedBayesiana& rb_;
-    // Orden topológico precalculado de nodos de la red. Se usa para
-    // recorrer las variables en un orden consistente durante la
-    // enumeración (Kahn). Guardar este vector evita recalcularlo
-    // en cada llamada a la función de enumeración recursiva.
+    // Orden topológico de la red, tomado de RedBayesiana::grafo(): la
+    // posición de cada nodo en orden_ es su Nodo::id. Si la estructura
+    // cambia hay que construir un motor nuevo.
     std::vector<Nodo*> orden_;
 
-    double enumerar_todo(size_t i, std::unordered_map<std::string,std::string>& evidencia,
-                         std::ostream* trace, int depth) const;
+    // Factor que resulta de instanciar la evidencia en la CPT de un nodo:
+    // tabla densa sobre las variables libres de su familia. Un modelo
+    // local compacto (noisy-OR) puede producir varios factores pequeños.
+    struct FactorReducido{
+        std::vector<size_t> vars;    // posiciones (padres libres, la variable y la auxiliar)
+        std::vector<size_t> pasos;   // paso de cada variable dentro de `valores`
+        std::vector<double> valores;
+        size_t origen = 0;           // posición del nodo (o de la auxiliar) que lo generó
+    };
+
+    // Estado de una consulta tras la pre-pasada de evidencia. La recursión
+    // solo trabaja con índices de valores y tablas reducidas.
+    // Las posiciones 0..n-1 son los nodos de orden_; a partir de n van las
+    // variables auxiliares Y' de los noisy-OR/MAX descompuestos, que se
+    // enumeran justo antes de su nodo.
+    struct Consulta{
+        std::vector<int> asig;                // valor por posición (-1 = sin asignar)
+        std::vector<size_t> auxiliar_de;      // posición n+i: nodo de la i-ésima auxiliar
+        std::vector<bool> libre;              // la variable se enumera (no es evidencia ni consulta)
+        std::vector<FactorReducido> factores; // factores con alguna variable libre
+        // factores que se evalúan en cada posición: la última (en orden
+        // topológico) de sus variables, cuando ya están todas asignadas
+        std::vector<std::vector<size_t>> en_posicion;
+        std::vector<size_t> pasos;            // posiciones que participan en la recursión
+        double constante = 1.0;               // producto de los factores sin variables libres
+        const LimiteConsulta* limite = nullptr;
+        size_t visitas = 0;                   // llamadas a enumerar_todo (para espaciar las comprobaciones)
+    };
+
+    // Instancia la evidencia en las CPTs. Si `podar` es true, descarta los
+    // nodos que no son ancestros de la consulta ni de la evidencia (suman 1).
+    // Con `descomponer`, un noisy-OR/MAX grande se parte con una auxiliar
+    // (TablaProbabilidad::factorizar); sus factores tienen signo, así que la
+    // MPE, que poda con cotas, no lo usa.
+    Consulta preparar(const std::unordered_map<std::string,std::string>& evidencia,
+                      const Nodo* consulta, bool podar, bool descomponer) const;
+    // nodo de una posición (el del noisy si es una auxiliar)
+    const Nodo* nodo_de(const Consulta& c, size_t pos) const {
+        return pos<orden_.size()? orden_[pos] : orden_[c.auxiliar_de[pos-orden_.size()]];
+    }
+
+    double enumerar_todo(size_t i, Consulta& c, std::ostream* trace, int depth) const;
+    void maximizar_todo(size_t i, Consulta& c, double acumulado, double& mejor,
+                        std::vector<int>& mejor_asig) const;
 };
 
 #endif // INFERENCIA_H
\ No newline at end of file
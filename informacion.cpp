@@ -0,0 +1,83 @@
+#include "informacion.h"
+#include "circuito.h"
+#include "nodo.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace{
+
+double entropia_bits(const double* p, size_t n){
+    double h = 0;
+    for(size_t k=0;k<n;++k) if(p[k]>0) h -= p[k]*std::log2(p[k]);
+    return h;
+}
+
+} // namespace
+
+std::vector<ValorInformacion> valor_informacion(const CircuitoAritmetico& ac, int objetivo,
+                                                const std::vector<int>& ev, unsigned hilos,
+                                                double* entropia){
+    const std::vector<Nodo*>& vars = ac.variables();
+    const size_t n = vars.size();
+    if(objetivo<0 || (size_t)objetivo>=n) throw std::runtime_error("Objetivo fuera de rango");
+    if(ev.size()!=n) throw std::runtime_error("Evidencia de tamaño incorrecto");
+    if(ev[objetivo]>=0) throw std::runtime_error("El objetivo está observado: "+vars[objetivo]->nombre);
+
+    std::vector<size_t> base(n+1, 0);
+    for(size_t v=0; v<n; ++v) base[v+1] = base[v] + vars[v]->valores.size();
+    const size_t ct = vars[objetivo]->valores.size();
+
+    // una pasada por valor del objetivo: cond[t][base(x)+k] = P(X=k | T=t, e)
+    std::vector<std::vector<double>> cond(ct, std::vector<double>(base[n]));
+    std::vector<double> pt(ct, 0);
+    unsigned h = hilos? hilos : std::max(1u, std::thread::hardware_concurrency());
+    h = (unsigned)std::min<size_t>(h, ct);
+    std::atomic<size_t> siguiente(0);
+    auto pasar = [&]{
+        CircuitoAritmetico::Espacio esp;
+        std::vector<int> e = ev;
+        for(size_t t; (t = siguiente++) < ct; ){
+            e[objetivo] = (int)t;
+            pt[t] = ac.marginales(e, cond[t].data(), esp);
+        }
+    };
+    std::vector<std::thread> th;
+    for(unsigned i=1; i<h; ++i) th.emplace_back(pasar);
+    pasar();
+    for(auto& t: th) t.join();
+
+    double pe = 0;
+    for(double p: pt) pe += p;
+    if(!(pe>0)) throw std::runtime_error("Evidencia con probabilidad 0");
+    for(double& p: pt) p /= pe;
+    const double h_t = entropia_bits(pt.data(), ct);
+    if(entropia) *entropia = h_t;
+
+    std::vector<ValorInformacion> res;
+    std::vector<double> px, post(ct);
+    for(size_t v=0; v<n; ++v){
+        if((int)v==objetivo || ev[v]>=0) continue;
+        const size_t cx = base[v+1]-base[v];
+        // P(x | e) = Σ_t P(t | e)·P(x | t, e)
+        px.assign(cx, 0);
+        for(size_t t=0;t<ct;++t)
+            if(pt[t]>0) for(size_t k=0;k<cx;++k) px[k] += pt[t]*cond[t][base[v]+k];
+        ValorInformacion r;
+        r.variable = vars[v];
+        for(size_t k=0;k<cx;++k){
+            if(!(px[k]>0)) continue;
+            // P(t | x, e) por Bayes con las tablas ya calculadas
+            for(size_t t=0;t<ct;++t) post[t] = pt[t]>0? pt[t]*cond[t][base[v]+k]/px[k] : 0;
+            r.entropia_esperada += px[k]*entropia_bits(post.data(), ct);
+        }
+        r.ganancia = std::max(0.0, h_t - r.entropia_esperada);
+        res.push_back(r);
+    }
+    std::stable_sort(res.begin(), res.end(), [](const ValorInformacion& a, const ValorInformacion& b){
+        return a.ganancia > b.ganancia;
+    });
+    return res;
+}
@@ -0,0 +1,29 @@
+#ifndef INFORMACION_H
+#define INFORMACION_H
+#include <vector>
+
+class CircuitoAritmetico; struct Nodo;
+
+// Valor de observar una variable para conocer el objetivo T
+struct ValorInformacion{
+    const Nodo* variable = nullptr;
+    double ganancia = 0;              // I(T; X | e) = H(T | e) - entropia_esperada, en bits
+    double entropia_esperada = 0;     // Σ_x P(x | e)·H(T | e, X=x)
+};
+
+// Ordena las variables no observadas (salvo T) por la reducción esperada
+// de la entropía de T al observarlas, de mayor a menor.
+//
+// En vez de una consulta por candidata y valor, usa que
+//   P(X=x, T=t | e) = P(t | e)·P(x | t, e)
+// y una pasada arriba/abajo del circuito con la evidencia e ∪ {T=t} da
+// P(x | t, e) para todas las X a la vez. Bastan card(T) pasadas (una por
+// valor del objetivo, repartidas entre hilos); la ganancia de cada
+// candidata sale después de esas tablas sin volver a evaluar el circuito.
+// `ev` es el índice de valor por variable del circuito (-1 = libre) y no
+// debe observar el objetivo. Si `entropia` no es nulo recibe H(T | e).
+std::vector<ValorInformacion> valor_informacion(const CircuitoAritmetico& ac, int objetivo,
+                                                const std::vector<int>& ev, unsigned hilos = 0,
+                                                double* entropia = nullptr);
+
+#endif // INFORMACION_H
@@ -0,0 +1,270 @@
+#include "lote_csv.h"
+#include "red_bayesiana.h"
+#include "inferencia.h"
+#include "nodo.h"
+#include "util.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// bloque de líneas completas leídas del CSV. Los campos son vistas sobre
+// `texto`, que no se modifica ni se mueve mientras el bloque existe
+// (los bloques viajan por el pipeline dentro de un unique_ptr).
+struct Bloque{
+    size_t secuencia = 0;
+    size_t primera_fila = 0;               // número de la primera fila de datos del bloque
+    std::string texto;
+    std::vector<std::string_view> campos;  // filas x columnas
+    std::vector<bool> valida;              // la fila tiene el número correcto de columnas
+    std::string resultado;                 // líneas de salida ya formateadas
+};
+
+// cola bloqueante sin cota: la cota de memoria la impone el semáforo de
+// bloques en vuelo, no las colas
+template<class T>
+class Cola{
+public:
+    void meter(T x){
+        { std::lock_guard<std::mutex> l(m_); q_.push_back(std::move(x)); }
+        cv_.notify_one();
+    }
+    // devuelve false cuando la cola está cerrada y vacía
+    bool sacar(T& x){
+        std::unique_lock<std::mutex> l(m_);
+        cv_.wait(l, [&]{ return !q_.empty() || cerrada_; });
+        if(q_.empty()) return false;
+        x = std::move(q_.front()); q_.pop_front();
+        return true;
+    }
+    void cerrar(){
+        { std::lock_guard<std::mutex> l(m_); cerrada_ = true; }
+        cv_.notify_all();
+    }
+private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<T> q_;
+    bool cerrada_ = false;
+};
+
+// semáforo de conteo: el lector adquiere un permiso por bloque y el
+// escritor lo devuelve cuando el bloque ya se escribió
+class Semaforo{
+public:
+    explicit Semaforo(size_t n): libres_(n) {}
+    void adquirir(){
+        std::unique_lock<std::mutex> l(m_);
+        cv_.wait(l, [&]{ return libres_>0; });
+        --libres_;
+    }
+    void liberar(){
+        { std::lock_guard<std::mutex> l(m_); ++libres_; }
+        cv_.notify_one();
+    }
+private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    size_t libres_;
+};
+
+// separa una línea en campos por comas sin copiar; recorta espacios y '\r'
+void tokenizar(std::string_view linea, std::vector<std::string_view>& campos){
+    auto recortar_vista = [](std::string_view v){
+        size_t a = v.find_first_not_of(" \t\r");
+        if(a==std::string_view::npos) return std::string_view();
+        size_t b = v.find_last_not_of(" \t\r");
+        return v.substr(a, b-a+1);
+    };
+    size_t ini = 0;
+    for(;;){
+        size_t coma = linea.find(',', ini);
+        if(coma==std::string_view::npos){ campos.push_back(recortar_vista(linea.substr(ini))); break; }
+        campos.push_back(recortar_vista(linea.substr(ini, coma-ini)));
+        ini = coma+1;
+    }
+}
+
+} // namespace
+
+ResumenLote procesar_csv(const RedBayesiana& rb, std::istream& entrada,
+                         std::ostream& salida, const OpcionesLote& op){
+    // --- cabecera: se lee de forma síncrona para fijar las columnas ---
+    std::string cab;
+    while(std::getline(entrada, cab)){
+        cab = recortar(cab);
+        if(!cab.empty() && cab[0]!='#') break;
+    }
+    if(cab.empty())
+        throw std::runtime_error("CSV sin cabecera");
+    std::vector<std::string_view> nombres;
+    tokenizar(cab, nombres);
+    const size_t ncol = nombres.size();
+
+    // cada columna apunta al nodo que observa (nullptr si no está en la red)
+    std::vector<const Nodo*> columnas(ncol, nullptr);
+    std::string desconocidas;
+    for(size_t j=0;j<ncol;++j){
+        columnas[j] = rb.obtener(std::string(nombres[j]));
+        if(!columnas[j]) desconocidas += (desconocidas.empty()? "" : ", ")+std::string(nombres[j]);
+    }
+    if(!desconocidas.empty() && !op.ignorar_desconocidas)
+        throw std::runtime_error("Columnas que no son variables de la red: "+desconocidas+
+                                 " (IGNORAR_DESCONOCIDAS las salta)");
+
+    InferenceEngine engine(rb);
+    const Nodo* objetivo = nullptr;
+    if(!op.mpe){
+        objetivo = rb.obtener(op.objetivo);
+        if(!objetivo)
+            throw std::runtime_error("Variable desconocida: "+op.objetivo);
+    }
+
+    // cabecera de salida: fila + una columna por valor (posterior) o por variable (MPE)
+    if(op.mpe){
+        // mpe() devuelve las variables en el orden topológico del motor
+        salida << "fila,prob";
+        for(Nodo* n: engine.orden()) salida << "," << n->nombre;
+    }else{
+        salida << "fila";
+        for(auto& v: objetivo->valores) salida << "," << objetivo->nombre << "=" << v;
+    }
+    salida << "\n";
+
+    const unsigned hilos = op.hilos ? op.hilos : std::max(1u, std::thread::hardware_concurrency());
+    Semaforo en_vuelo(op.bloques_en_vuelo ? op.bloques_en_vuelo : 2*hilos+2);
+    Cola<std::unique_ptr<Bloque>> trabajo, hechos;
+    std::exception_ptr error_lector;
+
+    // --- lector: trocea la entrada en bloques de líneas completas ---
+    std::thread lector([&]{
+        try{
+            std::string arrastre; // línea incompleta al final del bloque anterior
+            size_t secuencia = 0, fila = 1;
+            bool fin = false;
+            while(!fin){
+                en_vuelo.adquirir();
+                auto b = std::make_unique<Bloque>();
+                b->secuencia = secuencia++;
+                b->primera_fila = fila;
+                b->texto.swap(arrastre);
+                // leemos hasta completar al menos una línea (o llegar al final)
+                size_t corte = std::string::npos;
+                while(corte==std::string::npos){
+                    size_t prev = b->texto.size();
+                    b->texto.resize(prev + op.tam_bloque);
+                    entrada.read(&b->texto[prev], (std::streamsize)op.tam_bloque);
+                    b->texto.resize(prev + (size_t)entrada.gcount());
+                    if(!entrada){ fin = true; break; }
+                    corte = b->texto.rfind('\n');
+                }
+                if(!fin){
+                    arrastre.assign(b->texto, corte+1, std::string::npos);
+                    b->texto.resize(corte+1);
+                }
+
+                // tokenización sin copia: vistas sobre b->texto
+                std::string_view resto(b->texto);
+                while(!resto.empty()){
+                    size_t nl = resto.find('\n');
+                    std::string_view linea = resto.substr(0, nl);
+                    resto = nl==std::string_view::npos ? std::string_view() : resto.substr(nl+1);
+                    size_t a = linea.find_first_not_of(" \t\r");
+                    if(a==std::string_view::npos || linea[a]=='#') continue;
+                    size_t antes = b->campos.size();
+                    tokenizar(linea, b->campos);
+                    bool ok = b->campos.size()-antes==ncol;
+                    // normalizamos a ncol campos por fila para indexar directamente
+                    b->campos.resize(antes+ncol);
+                    b->valida.push_back(ok);
+                    ++fila;
+                }
+                trabajo.meter(std::move(b));
+            }
+        }catch(...){
+            error_lector = std::current_exception();
+        }
+        trabajo.cerrar();
+    });
+
+    // --- trabajadores: inferencia por fila ---
+    std::atomic<unsigned> vivos(hilos);
+    std::atomic<size_t> errores(0);
+    std::vector<std::thread> trabajadores;
+    for(unsigned t=0;t<hilos;++t) trabajadores.emplace_back([&]{
+        std::unique_ptr<Bloque> b;
+        std::unordered_map<std::string,std::string> ev;
+        char num[64];
+        while(trabajo.sacar(b)){
+            for(size_t r=0; r<b->valida.size(); ++r){
+                const size_t n_fila = b->primera_fila + r;
+                b->resultado += std::to_string(n_fila);
+                if(!b->valida[r]){
+                    b->resultado += ",ERROR\n"; ++errores;
+                    continue;
+                }
+                ev.clear();
+                for(size_t j=0;j<ncol;++j){
+                    std::string_view v = b->campos[r*ncol+j];
+                    // la propia variable objetivo no se usa como evidencia
+                    if(v.empty() || !columnas[j] || columnas[j]==objetivo) continue;
+                    ev[columnas[j]->nombre] = std::string(v);
+                }
+                try{
+                    if(op.mpe){
+                        double p;
+                        auto asig = engine.mpe(ev, p);
+                        std::snprintf(num, sizeof num, ",%.6g", p);
+                        b->resultado += num;
+                        for(auto& kv: asig){ b->resultado += ","; b->resultado += kv.second; }
+                    }else{
+                        for(auto& kv: engine.consultar_enumeracion(objetivo->nombre, ev)){
+                            std::snprintf(num, sizeof num, ",%.6f", kv.second);
+                            b->resultado += num;
+                        }
+                    }
+                }catch(const std::exception&){
+                    // evidencia imposible o valores desconocidos: la fila se marca
+                    b->resultado += ",ERROR"; ++errores;
+                }
+                b->resultado += "\n";
+            }
+            hechos.meter(std::move(b));
+        }
+        // el último trabajador en salir cierra la cola de resultados
+        if(--vivos==0) hechos.cerrar();
+    });
+
+    // --- escritor (hilo llamante): reordena por secuencia y escribe ---
+    ResumenLote res;
+    std::map<size_t, std::unique_ptr<Bloque>> pendientes;
+    size_t siguiente = 0;
+    std::unique_ptr<Bloque> b;
+    while(hechos.sacar(b)){
+        size_t s = b->secuencia;
+        pendientes.emplace(s, std::move(b));
+        for(auto it = pendientes.find(siguiente); it!=pendientes.end(); it = pendientes.find(siguiente)){
+            salida << it->second->resultado;
+            res.filas += it->second->valida.size();
+            pendientes.erase(it);
+            ++siguiente;
+            en_vuelo.liberar();
+        }
+    }
+    lector.join();
+    for(auto& t: trabajadores) t.join();
+    if(error_lector) std::rethrow_exception(error_lector);
+    res.errores = errores;
+    return res;
+}
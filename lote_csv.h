@@ -0,0 +1,35 @@
+#ifndef LOTE_CSV_H
+#define LOTE_CSV_H
+#include <string>
+#include <istream>
+#include <ostream>
+
+struct RedBayesiana;
+
+struct OpcionesLote{
+    std::string objetivo;          // variable cuya posterior se escribe por fila
+    bool mpe = false;              // si es true se escribe la MPE por fila
+    bool ignorar_desconocidas = false; // columnas que no son variables de la red: saltarlas en vez de fallar
+    unsigned hilos = 0;            // trabajadores de inferencia (0 = hardware_concurrency)
+    size_t tam_bloque = 1u<<20;    // bytes leídos por bloque
+    size_t bloques_en_vuelo = 0;   // bloques vivos a la vez (0 = 2*hilos+2)
+};
+
+struct ResumenLote{
+    size_t filas = 0;
+    size_t errores = 0;
+};
+
+// Puntúa un CSV de evidencias fila a fila. La cabecera da los nombres de
+// las variables; las celdas vacías son no observadas. Una columna que no
+// es variable de la red es un error (una errata dejaría esa evidencia sin
+// observar en todas las filas), salvo con `ignorar_desconocidas`. Las filas pasan por
+// un pipeline: un hilo lector trocea la entrada en bloques y los tokeniza
+// sin copiar (string_view sobre el bloque), un grupo de trabajadores
+// ejecuta la inferencia y el hilo llamante escribe los resultados en el
+// orden de entrada. La memoria queda acotada por `bloques_en_vuelo`
+// bloques, sin importar el tamaño del archivo.
+ResumenLote procesar_csv(const RedBayesiana& rb, std::istream& entrada,
+                         std::ostream& salida, const OpcionesLote& op);
+
+#endif // LOTE_CSV_H
@@ -5,6 +5,27 @@
 #include "red_bayesiana.h"
 #include "inferencia.h"
 #include "util.h"
+#include "aprendizaje.h"
+#include "lote_csv.h"
+#include "generador.h"
+#include "circuito.h"
+#include "informacion.h"
+#include "propagacion.h"
+#include "muestreo.h"
+#include "dseparacion.h"
+#include "dinamica.h"
+#include "explicaciones.h"
+#include "compacto.h"
+#include "servicio.h"
+#include "modelo_vivo.h"
+#include "planificador.h"
+#include "hibrida.h"
+#include "cutset.h"
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
 
 // función auxiliar para imprimir la distribución de probabilidad resultante
 // recibe un vector de pares donde cada par contiene (valor, probabilidad)
@@ -51,12 +72,144 @@ static std::unordered_map<std::string,std::string> parsear_evidencia(const std::
     return e;
 }
 
+// valor de una opción numérica "NOMBRE=n" dentro de [minimo, maximo].
+// std::stoul solo diría "stoul" y además convierte "-1" en un número enorme
+static unsigned long opcion_entera(const std::string& nombre, const std::string& texto,
+                                   unsigned long minimo, unsigned long maximo){
+    size_t usados = 0;
+    long long v = 0;
+    try{ v = std::stoll(texto, &usados); }catch(const std::exception&){ usados = 0; }
+    if(usados==0 || usados!=texto.size() || v<(long long)minimo || v>(long long)maximo)
+        throw std::runtime_error("valor inválido para "+nombre+": '"+texto+"' (se espera un entero entre "+
+                                 std::to_string(minimo)+" y "+std::to_string(maximo)+")");
+    return (unsigned long)v;
+}
+
+// modo de aprendizaje: "APRENDER: datos.csv salida.txt [BIC|BDEU] [PADRES=n]"
+// no necesita una red cargada, por eso se atiende antes que el resto de comandos
+static int aprender(const std::string& cmd){
+    // separamos los argumentos del comando por espacios
+    auto args = dividir(recortar(cmd.substr(9)), ' ');
+    if(args.size()<2){
+        std::cerr << "Uso: APRENDER: <datos.csv> <salida.txt> [BIC|BDEU] [PADRES=n]\n";
+        return 1;
+    }
+    OpcionesAprendizaje op;
+    try{
+        for(size_t k=2;k<args.size();++k){
+            if(args[k]=="BIC") op.puntaje = Puntaje::BIC;
+            else if(args[k]=="BDEU") op.puntaje = Puntaje::BDeu;
+            else if(args[k].rfind("PADRES=",0)==0) op.max_padres = std::stoul(args[k].substr(7));
+            else { std::cerr << "Opción desconocida: "<<args[k]<<"\n"; return 1; }
+        }
+        auto datos = DatosDiscretos::cargar_csv(args[0]);
+        RedBayesiana rb;
+        double s = aprender_estructura(datos, rb, op);
+        std::ofstream out(args[1]);
+        if(!out) throw std::runtime_error("No se puede escribir: "+args[1]);
+        escribir_estructura(rb, out);
+        const size_t completas = datos.filas_completas().size();
+        std::cout << "Estructura aprendida ("<<(op.puntaje==Puntaje::BIC?"BIC":"BDeu")
+                  << ") con "<<completas<<" filas";
+        if(completas<datos.filas) std::cout << " completas de "<<datos.filas;
+        std::cout << ", puntaje="<<s<<" -> "<<args[1]<<"\n";
+    }catch(const std::exception& ex){
+        std::cerr << "Error en APRENDER: "<<ex.what()<<"\n";
+        return 2;
+    }
+    return 0;
+}
+
+// filtrado de una red dinámica: "FILTRAR: estructura.txt cpts.txt evidencia.csv [salida.csv] [VARS=A,B]"
+// la evidencia tiene una fila por rebanada (celdas vacías = no observadas);
+// la salida tiene una fila por paso con P(var_t | e_1..t) y log P(e_1..t)
+static int filtrar(const std::string& cmd){
+    auto args = dividir(recortar(cmd.substr(8)), ' ');
+    if(args.size()<3){
+        std::cerr << "Uso: FILTRAR: <estructura.txt> <cpts.txt> <evidencia.csv> [salida.csv] [VARS=A,B]\n";
+        return 1;
+    }
+    std::string ruta_salida;
+    std::vector<std::string> vars;
+    for(size_t k=3;k<args.size();++k){
+        if(args[k].rfind("VARS=",0)==0) vars = dividir(args[k].substr(5), ',');
+        else if(ruta_salida.empty()) ruta_salida = args[k];
+        else { std::cerr << "Opción desconocida: "<<args[k]<<"\n"; return 1; }
+    }
+    // separa por comas conservando las celdas vacías
+    auto campos = [](const std::string& linea){
+        std::vector<std::string> r(1);
+        for(char c: linea){ if(c==',') r.emplace_back(); else r.back() += c; }
+        for(auto& x: r) x = recortar(x);
+        return r;
+    };
+    try{
+        RedDinamica dbn;
+        dbn.cargar(args[0], args[1]);
+        FiltroDinamico filtro(dbn, vars);
+        std::ifstream in(args[2]);
+        if(!in) throw std::runtime_error("No se puede abrir: "+args[2]);
+        std::ofstream fout;
+        if(!ruta_salida.empty()){
+            fout.open(ruta_salida);
+            if(!fout) throw std::runtime_error("No se puede escribir: "+ruta_salida);
+        }
+        std::ostream& out = ruta_salida.empty()? std::cout : fout;
+
+        std::string linea;
+        std::vector<std::string> cab;
+        while(cab.empty() && std::getline(in, linea)){
+            linea = recortar(linea);
+            if(!linea.empty() && linea[0]!='#') cab = campos(linea);
+        }
+        if(cab.empty()) throw std::runtime_error("CSV sin cabecera");
+
+        out << "t";
+        for(const auto& q: filtro.consulta())
+            for(const auto& v: dbn.transicion.obtener(q)->valores) out << "," << q << "=" << v;
+        out << ",log_verosimilitud\n" << std::fixed << std::setprecision(6);
+
+        // una fila por rebanada: se procesa y se escribe antes de leer la siguiente
+        size_t ln = 1;
+        while(std::getline(in, linea)){
+            ++ln;
+            linea = recortar(linea);
+            if(linea.empty() || linea[0]=='#') continue;
+            auto c = campos(linea);
+            if(c.size()!=cab.size())
+                throw std::runtime_error("Línea "+std::to_string(ln)+": se esperaban "+std::to_string(cab.size())+" columnas");
+            std::unordered_map<std::string,std::string> e;
+            for(size_t k=0;k<c.size();++k) if(!c[k].empty()) e[cab[k]] = c[k];
+            filtro.avanzar(filtro.indices_evidencia(e));
+            out << filtro.pasos()-1;
+            for(const auto& m: filtro.marginales()) for(double p: m) out << "," << p;
+            out << "," << filtro.log_verosimilitud() << "\n";
+        }
+        if(!ruta_salida.empty())
+            std::cout << "FILTRAR: "<<filtro.pasos()<<" pasos, log P(e) = "<<filtro.log_verosimilitud()
+                      <<" -> "<<ruta_salida<<"\n";
+    }catch(const std::exception& ex){
+        std::cerr << "Error en FILTRAR: "<<ex.what()<<"\n";
+        return 2;
+    }
+    return 0;
+}
+
 int main(int argc, char** argv){
+    // el aprendizaje de estructura trabaja sobre datos, no sobre una red cargada
+    if(argc==2 && std::string(argv[1]).rfind("APRENDER:",0)==0)
+        return aprender(argv[1]);
+    // el filtrado de una red dinámica carga su propia red de dos rebanadas
+    if(argc==2 && std::string(argv[1]).rfind("FILTRAR:",0)==0)
+        return filtrar(argv[1]);
+
     // verificamos que se pasen al menos los dos archivos requeridos como argumentos
     // argc incluye el nombre del programa, por eso necesitamos al menos 3
     if(argc<3){
         // mostramos mensaje de uso explicando los parámetros requeridos
-        std::cerr << "Uso: ./bn <estructura.txt> <cpts.txt> [COMANDOS]\n\n";
+        std::cerr << "Uso: ./bn <estructura.txt> <cpts.txt> [COMANDOS]\n";
+        std::cerr << "     ./bn --binario <modelo.rbn> [COMANDOS]\n";
+        std::cerr << "     ./bn 'APRENDER: datos.csv salida.txt [BIC|BDEU] [PADRES=n]'\n\n";
         // explicamos los comandos disponibles con ejemplos
         std::cerr << "Comandos:\n  MOSTRAR:ESTRUCT\n  MOSTRAR:CPTS\n  CONSULTAR: Var | evidencias  (ej. CONSULTAR: Cita | Tren=tiempo)\n";
         // retornamos código de error 1 indicando uso incorrecto
@@ -68,15 +221,26 @@ int main(int argc, char** argv){
     // extraemos el nombre del archivo de CPTs desde el segundo argumento
     std::string f_cpts = argv[2];
 
-    // creamos una instancia de la red bayesiana vacía
-    RedBayesiana rb;
+    // carga la red desde los archivos de texto o, con --binario, desde un
+    // modelo guardado con GUARDAR_BIN (MEMORIA: y PRECISION: vuelven a cargarla)
+    auto cargar_desde = [](RedBayesiana& r, const std::string& estructura, const std::string& cpts){
+        if(estructura=="--binario"){ cargar_binario(r, cpts); return; }
+        // primero cargamos la estructura (grafo dirigido con las conexiones)
+        r.cargar_estructura(estructura); 
+        // luego cargamos las tablas de probabilidad condicional para cada nodo
+        r.cargar_cpts(cpts); 
+    };
+    auto cargar_red = [&](RedBayesiana& r){ cargar_desde(r, f_estructura, f_cpts); };
+
+    // la red se publica como una instantánea inmutable; RECARGAR: y
+    // PRECISION: publican versiones nuevas sin parar las consultas en curso
+    ModeloVivo modelo;
     
     // intentamos cargar los archivos, envolvemos en try-catch para manejar errores
     try{ 
-        // primero cargamos la estructura (grafo dirigido con las conexiones)
-        rb.cargar_estructura(f_estructura); 
-        // luego cargamos las tablas de probabilidad condicional para cada nodo
-        rb.cargar_cpts(f_cpts); 
+        auto red = std::make_shared<RedBayesiana>();
+        cargar_red(*red);
+        modelo.publicar(red);
     }
     catch(const std::exception& ex){ 
         // si ocurre cualquier error durante la carga, capturamos la excepción
@@ -86,11 +250,47 @@ int main(int argc, char** argv){
         return 2; 
     }
 
+    // circuito aritmético: se compila la primera vez que se usa y se
+    // reutiliza en las consultas siguientes (hasta que cambia la versión)
+    std::unique_ptr<CircuitoAritmetico> circuito;
+    auto obtener_circuito = [&](const RedBayesiana& rb) -> const CircuitoAritmetico& {
+        if(!circuito) circuito = std::make_unique<CircuitoAritmetico>(CircuitoAritmetico::compilar(rb));
+        return *circuito;
+    };
+
+    // circuito sin poda ni valores compartidos, solo para SENSIBILIDAD:
+    // cada entrada de CPT tiene su propio nodo
+    std::unique_ptr<CircuitoAritmetico> circuito_sens;
+    // planificador de eliminación de variables: guarda un plan por patrón
+    // de consulta mientras no cambie la versión
+    std::unique_ptr<Planificador> planificador;
+    // condicionamiento por cutset: sus procesos trabajadores se crean en la
+    // primera consulta y se cierran al cambiar la versión o las opciones
+    std::unique_ptr<InferenciaCutset> cutset;
+    uint64_t version_circuitos = 0;
+
+    // servicio de consultas con plazo: su grupo de hilos se crea al primer uso
+    std::unique_ptr<ServicioConsultas> servicio;
+
     // procesamos cada comando adicional pasado como argumento
     // comenzamos desde el índice 3 (después de nombre_programa, estructura, cpts)
     for(int i=3;i<argc;++i){
         // obtenemos el comando actual como string
         std::string cmd = argv[i];
+
+        // cada comando trabaja sobre la versión vigente al empezar; el motor
+        // de inferencia exacta viene con la instantánea y reutiliza el orden
+        // topológico que la red ya tiene calculado (RedBayesiana::grafo)
+        std::shared_ptr<const Instantanea> actual = modelo.instantanea();
+        const RedBayesiana& rb = *actual->red;
+        const InferenceEngine& engine = actual->motor;
+        if(actual->version!=version_circuitos){
+            circuito.reset();
+            circuito_sens.reset();
+            planificador.reset();
+            cutset.reset();
+            version_circuitos = actual->version;
+        }
         
         // verificamos si el comando comienza con "MOSTRAR:ESTRUCT"
         // rfind con posición 0 verifica que empiece desde el inicio
@@ -131,10 +331,6 @@ int main(int argc, char** argv){
                 // parseamos el string de evidencias a un mapa variable->valor
                 auto e = parsear_evidencia(evs);
                 
-                // creamos el motor de inferencia pasándole la red bayesiana
-                // el constructor calcula el orden topológico de los nodos
-                InferenceEngine engine(rb);
-                
                 // verificamos si queremos traza de ejecución
                 if(trace){
                     // llamamos a consultar_enumeracion pasando &std::cout
@@ -162,6 +358,583 @@ int main(int argc, char** argv){
                 // puede ser variable inexistente, evidencia inconsistente, etc.
                 std::cerr << "Error en CONSULTAR: "<<ex.what()<<"\n"; 
             }
+        }
+        // puntuación por lotes: "LOTE: <Var|MPE> <entrada.csv> <salida.csv> [HILOS=n] [IGNORAR_DESCONOCIDAS]"
+        else if(cmd.rfind("LOTE:",0)==0){
+            auto args = dividir(recortar(cmd.substr(5)), ' ');
+            if(args.size()<3){
+                std::cerr << "Uso: LOTE: <Var|MPE> <entrada.csv> <salida.csv> [HILOS=n] [IGNORAR_DESCONOCIDAS]\n";
+                continue;
+            }
+            try{
+                OpcionesLote op;
+                // "MPE" pide la explicación más probable; cualquier otro nombre es la variable objetivo
+                if(args[0]=="MPE") op.mpe = true; else op.objetivo = args[0];
+                for(size_t k=3;k<args.size();++k){
+                    if(args[k].rfind("HILOS=",0)==0) op.hilos = (unsigned)std::stoul(args[k].substr(6));
+                    else if(args[k]=="IGNORAR_DESCONOCIDAS") op.ignorar_desconocidas = true;
+                    else throw std::runtime_error("opción desconocida "+args[k]);
+                }
+                std::ifstream in(args[1]);
+                if(!in) throw std::runtime_error("No se puede abrir: "+args[1]);
+                std::ofstream out(args[2]);
+                if(!out) throw std::runtime_error("No se puede escribir: "+args[2]);
+                auto r = procesar_csv(rb, in, out, op);
+                std::cout << "LOTE: "<<r.filas<<" filas ("<<r.errores<<" con error) -> "<<args[2]<<"\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en LOTE: "<<ex.what()<<"\n";
+            }
+        }
+        // consultas sobre el circuito aritmético compilado
+        else if(cmd.rfind("CONSULTAR_AC:",0)==0){
+            std::string resto = recortar(cmd.substr(13));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                auto d = obtener_circuito(rb).consultar(var, parsear_evidencia(evs));
+                std::cout << "P("<<var<<" | "<<evs<<")\n";
+                imprimir_distribucion(d);
+            }catch(const std::exception& ex){
+                std::cerr << "Error en CONSULTAR_AC: "<<ex.what()<<"\n";
+            }
+        }
+        // eliminación de variables con el plan en caché del patrón de consulta
+        else if(cmd.rfind("CONSULTAR_VE:",0)==0){
+            std::string resto = recortar(cmd.substr(13));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                if(!planificador) planificador = std::make_unique<Planificador>(rb);
+                auto d = planificador->consultar(var, parsear_evidencia(evs));
+                std::cout << "P("<<var<<" | "<<evs<<")\n";
+                imprimir_distribucion(d);
+            }catch(const std::exception& ex){
+                std::cerr << "Error en CONSULTAR_VE: "<<ex.what()<<"\n";
+            }
+        }
+        // condicionamiento por cutset repartido en procesos:
+        // "CONSULTAR_CUTSET: Var | ev [; TRABAJADORES=n BLOQUES=b]"
+        else if(cmd.rfind("CONSULTAR_CUTSET:",0)==0){
+            std::string resto = recortar(cmd.substr(17));
+            auto pc = resto.find(';');
+            std::string opciones = pc==std::string::npos? std::string("") : recortar(resto.substr(pc+1));
+            resto = recortar(resto.substr(0, pc));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                OpcionesCutset op;
+                for(auto& a: dividir(opciones, ' ')){
+                    if(a.rfind("TRABAJADORES=",0)==0)
+                        op.trabajadores = (unsigned)opcion_entera("TRABAJADORES", a.substr(13), 1, MAX_TRABAJADORES_CUTSET);
+                    else if(a.rfind("BLOQUES=",0)==0)
+                        op.bloques_por_trabajador = opcion_entera("BLOQUES", a.substr(8), 1, 1024);
+                    else throw std::runtime_error("opción desconocida "+a);
+                }
+                if(!cutset || cutset->opciones().trabajadores!=op.trabajadores ||
+                   cutset->opciones().bloques_por_trabajador!=op.bloques_por_trabajador){
+                    cutset.reset();
+                    cutset = std::make_unique<InferenciaCutset>(rb, op);
+                }
+                auto r = cutset->consultar(var, parsear_evidencia(evs));
+                std::cout << "P("<<var<<" | "<<evs<<")\n";
+                imprimir_distribucion(r.distribucion);
+                std::cout << "cutset:";
+                for(const Nodo* c: r.cutset) std::cout << " "<<c->nombre;
+                if(r.cutset.empty()) std::cout << " (vacío, poliárbol)";
+                std::cout << " | "<<r.instanciaciones<<" instanciaciones en "<<r.bloques<<" bloques, ";
+                if(r.trabajadores) std::cout << r.trabajadores<<" trabajadores\n";
+                else std::cout << "en este proceso\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en CONSULTAR_CUTSET: "<<ex.what()<<"\n";
+            }
+        }
+        // redes híbridas: "CONSULTAR_HIBRIDA: Var | A=a, Temp=21.5" (los nodos
+        // continuos se observan con números)
+        else if(cmd.rfind("CONSULTAR_HIBRIDA:",0)==0){
+            std::string resto = recortar(cmd.substr(18));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                ResultadoHibrido r = InferenciaHibrida(rb).consultar(var, parsear_evidencia(evs));
+                if(!r.continua){
+                    std::cout << "P("<<var<<" | "<<evs<<")\n";
+                    imprimir_distribucion(r.distribucion);
+                }else{
+                    std::cout << "p("<<var<<" | "<<evs<<"): mezcla de "<<r.mezcla.size()<<" gaussiana(s)\n";
+                    std::cout << std::fixed << std::setprecision(6);
+                    std::cout << "media: "<<r.media<<"  varianza: "<<r.varianza<<"\n";
+                    for(const auto& c: r.mezcla)
+                        std::cout << (c.contexto.empty()? std::string("-") : c.contexto)
+                                  <<": peso "<<c.peso<<"  N("<<c.media<<", "<<c.varianza<<")\n";
+                }
+                std::cout << "log p(e) = "<<r.log_prob_evidencia<<"\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en CONSULTAR_HIBRIDA: "<<ex.what()<<"\n";
+            }
+        }
+        // plan elegido para el patrón de una consulta y el coste de cada heurística
+        else if(cmd.rfind("EXPLICAR:",0)==0){
+            std::string resto = recortar(cmd.substr(9));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                if(!planificador) planificador = std::make_unique<Planificador>(rb);
+                const Nodo* Q = rb.obtener(var);
+                if(!Q) throw std::runtime_error("Variable desconocida: "+var);
+                std::vector<int> ids;
+                for(const auto& e: planificador->indices_evidencia(parsear_evidencia(evs))) ids.push_back(e.first);
+                bool en_cache = false;
+                auto plan = planificador->planificar({Q->id}, ids, &en_cache);
+                const auto& orden = rb.grafo().orden;
+
+                std::cout << "Patrón: "<<var<<" |";
+                if(plan->evidencia.empty()) std::cout << " (sin evidencia)";
+                for(int e: plan->evidencia) std::cout << " "<<orden[e]->nombre;
+                std::cout << "\nPlan: "<<(en_cache? "en caché" : "nuevo")
+                          <<" (planificado en "<<std::fixed<<std::setprecision(3)<<plan->segundos*1000<<" ms; "
+                          <<planificador->planes_en_cache()<<" planes, "
+                          <<planificador->aciertos()<<" aciertos, "<<planificador->fallos()<<" fallos)\n";
+                size_t familias = 0;
+                for(size_t k=0; k<plan->familias.size(); ++k)
+                    if(!k || plan->familias[k]!=plan->familias[k-1]) ++familias;
+                std::cout << "Factores: "<<plan->factores.size()<<" de "<<familias<<" CPTs"
+                          <<" (de "<<orden.size()<<"; el resto está fuera del cierre ancestral)";
+                if(!plan->auxiliares.empty())
+                    std::cout << "; noisy-OR/MAX descompuestos: "<<plan->auxiliares.size();
+                std::cout << "\n";
+                std::cout << std::defaultfloat << std::setprecision(6);
+                std::cout << std::left << std::setw(22) << "Heurística"
+                          << std::right << std::setw(14) << "mayor factor" << std::setw(16) << "operaciones" << "\n";
+                for(const auto& c: plan->candidatos)
+                    std::cout << std::left << std::setw(22) << c.heuristica << std::right
+                              << std::setw(14) << c.coste.max_factor << std::setw(16) << c.coste.flops
+                              << (c.heuristica==plan->heuristica? "  <- elegido" : "") << "\n";
+                std::cout << std::left << "Orden ("<<plan->orden.size()<<" pasos):\n";
+                for(size_t k=0; k<plan->orden.size(); ++k){
+                    // las auxiliares Y' de los noisy descompuestos van después de los nodos
+                    const int u = plan->orden[k];
+                    std::string nombre = (size_t)u<orden.size()? orden[u]->nombre
+                                                               : orden[plan->auxiliares[u-orden.size()]]->nombre+"'";
+                    std::cout << "  "<<(k+1)<<". "<<nombre<<" -> factor de "<<plan->coste.tam_paso[k]<<"\n";
+                }
+                std::cout << std::right;
+            }catch(const std::exception& ex){
+                std::cerr << "Error en EXPLICAR: "<<ex.what()<<"\n";
+            }
+        }
+        // todos los marginales con una pasada hacia arriba y otra hacia abajo
+        else if(cmd.rfind("MARGINALES_AC:",0)==0){
+            std::string evs = recortar(cmd.substr(14));
+            try{
+                const CircuitoAritmetico& ac = obtener_circuito(rb);
+                std::vector<std::vector<double>> marg;
+                double pe = ac.marginales(ac.indices_evidencia(parsear_evidencia(evs)), marg);
+                std::cout << "P(e) = "<<pe<<"\n";
+                for(size_t v=0; v<ac.variables().size(); ++v){
+                    const Nodo* X = ac.variables()[v];
+                    std::cout << "P("<<X->nombre<<" | "<<evs<<")\n";
+                    std::vector<std::pair<std::string,double>> d;
+                    for(size_t k=0;k<marg[v].size();++k) d.push_back({X->valores[k], marg[v][k]});
+                    imprimir_distribucion(d);
+                }
+            }catch(const std::exception& ex){
+                std::cerr << "Error en MARGINALES_AC: "<<ex.what()<<"\n";
+            }
+        }
+        else if(cmd.rfind("MOSTRAR:CIRCUITO",0)==0){
+            try{
+                const CircuitoAritmetico& ac = obtener_circuito(rb);
+                std::cout << "Circuito aritmético: "<<ac.num_nodos()<<" nodos, "
+                          << ac.num_aristas()<<" aristas, "<<ac.num_parametros()<<" parámetros\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en MOSTRAR:CIRCUITO: "<<ex.what()<<"\n";
+            }
+        }
+        // las k explicaciones más probables: "MPE_TOPK: k | ev"
+        // se imprimen a medida que se confirman, de mayor a menor probabilidad
+        else if(cmd.rfind("MPE_TOPK:",0)==0){
+            std::string resto = recortar(cmd.substr(9));
+            auto barra = resto.find('|');
+            std::string ks = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                size_t k = ks.empty()? 1 : std::stoul(ks);
+                MejoresExplicaciones mx(rb);
+                auto ev = mx.indices_evidencia(parsear_evidencia(evs));
+                std::cout << "Explicaciones más probables dado " << (evs.empty()? "(sin evidencia)" : evs) << ":\n";
+                size_t n = mx.enumerar(ev, k, [&](const Explicacion& e){
+                    std::cout << "#" << e.rango << " P(x|e)=" << std::fixed << std::setprecision(6) << e.prob
+                              << " P(x,e)=" << std::scientific << std::setprecision(4) << e.prob_conjunta
+                              << std::fixed << std::setprecision(6) << ":";
+                    bool primero = true;
+                    for(size_t v=0; v<mx.variables().size(); ++v){
+                        if(ev[v]>=0) continue;
+                        const Nodo* X = mx.variables()[v];
+                        std::cout << (primero? " " : ", ") << X->nombre << "=" << X->valores[e.asig[v]];
+                        primero = false;
+                    }
+                    std::cout << std::endl; // se vuelca cada una en cuanto se encuentra
+                    return true;
+                });
+                std::cout << "MPE_TOPK: " << n << " explicaciones, " << mx.evaluaciones() << " evaluaciones max-producto\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en MPE_TOPK: "<<ex.what()<<"\n";
+            }
+        }
+        // análisis de sensibilidad: "SENSIBILIDAD: Var=valor | ev [; TOP=n]"
+        // lista las entradas de CPT a las que P(Var=valor | ev) es más sensible
+        else if(cmd.rfind("SENSIBILIDAD:",0)==0){
+            std::string resto = recortar(cmd.substr(13));
+            auto pc = resto.find(';');
+            std::string opciones = pc==std::string::npos? std::string("") : recortar(resto.substr(pc+1));
+            resto = recortar(resto.substr(0, pc));
+            auto barra = resto.find('|');
+            std::string consulta = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                size_t top = 10;
+                for(auto& a: dividir(opciones, ' ')){
+                    if(a.rfind("TOP=",0)==0) top = std::stoul(a.substr(4));
+                    else throw std::runtime_error("opción desconocida "+a);
+                }
+                auto eq = consulta.find('=');
+                if(eq==std::string::npos) throw std::runtime_error("la consulta debe ser Var=valor");
+                std::string var = recortar(consulta.substr(0, eq));
+                if(!circuito_sens)
+                    circuito_sens = std::make_unique<CircuitoAritmetico>(
+                        CircuitoAritmetico::compilar(rb, CircuitoAritmetico::opciones_sensibilidad()));
+                const CircuitoAritmetico& ac = *circuito_sens;
+                auto q = ac.indices_evidencia({{var, recortar(consulta.substr(eq+1))}});
+                size_t v = 0;
+                while(q[v]<0) ++v;
+                auto ev = ac.indices_evidencia(parsear_evidencia(evs));
+                ev[v] = -1;
+                double post = 0;
+                auto ds = ac.sensibilidad((int)v, q[v], ev, &post);
+                std::cout << "P("<<consulta<<" | "<<evs<<") = "<<std::fixed<<std::setprecision(6)<<post<<"\n";
+                std::cout << "parámetro | θ | ∂/∂θ | ∂/∂θ (covariada)\n";
+                for(size_t i=0; i<ds.size() && i<top; ++i){
+                    const DerivadaParametro& d = ds[i];
+                    const TablaProbabilidad& T = *d.nodo->cpt;
+                    // la fila se decodifica con el primer padre como dígito más significativo
+                    std::string padres;
+                    size_t f = d.fila;
+                    for(size_t j=T.padres.size(); j-- > 0; ){
+                        const Nodo* P = T.padres[j];
+                        padres = P->nombre+"="+P->valores[f % P->valores.size()] + (padres.empty()? "" : ", ") + padres;
+                        f /= P->valores.size();
+                    }
+                    std::cout << "P("<<d.nodo->nombre<<"="<<d.nodo->valores[d.k]
+                              << (padres.empty()? "" : " | "+padres) << ") | "
+                              << d.valor<<" | "<<d.derivada<<" | "<<d.covariada<<"\n";
+                }
+            }catch(const std::exception& ex){
+                std::cerr << "Error en SENSIBILIDAD: "<<ex.what()<<"\n";
+            }
+        }
+        // valor de la información: "VOI: Objetivo | ev [; TOP=n HILOS=h]" ordena
+        // las variables no observadas por la reducción esperada de H(Objetivo)
+        else if(cmd.rfind("VOI:",0)==0){
+            std::string resto = recortar(cmd.substr(4));
+            auto pc = resto.find(';');
+            std::string opciones = pc==std::string::npos? std::string("") : recortar(resto.substr(pc+1));
+            resto = recortar(resto.substr(0, pc));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                size_t top = 10;
+                unsigned hilos = 0;
+                for(auto& a: dividir(opciones, ' ')){
+                    if(a.rfind("TOP=",0)==0) top = std::stoul(a.substr(4));
+                    else if(a.rfind("HILOS=",0)==0) hilos = (unsigned)std::stoul(a.substr(6));
+                    else throw std::runtime_error("opción desconocida "+a);
+                }
+                const CircuitoAritmetico& ac = obtener_circuito(rb);
+                int t = -1;
+                for(size_t v=0; v<ac.variables().size(); ++v) if(ac.variables()[v]->nombre==var) t = (int)v;
+                if(t<0) throw std::runtime_error("Variable desconocida: "+var);
+                auto ev = ac.indices_evidencia(parsear_evidencia(evs));
+                double h = 0;
+                auto r = valor_informacion(ac, t, ev, hilos, &h);
+                std::cout << "H("<<var<<" | "<<evs<<") = "<<std::fixed<<std::setprecision(6)<<h<<" bits\n";
+                std::cout << "variable | ganancia (bits) | entropía esperada\n";
+                for(size_t i=0; i<r.size() && i<top; ++i)
+                    std::cout << r[i].variable->nombre<<" | "<<r[i].ganancia<<" | "<<r[i].entropia_esperada<<"\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en VOI: "<<ex.what()<<"\n";
+            }
+        }
+        // propagación de creencias con bucles (aproximada):
+        // "LBP: ev [; AMORT=a TOL=t ITER=n HILOS=h]", o LBP_RESIDUAL con el mismo formato
+        else if(cmd.rfind("LBP:",0)==0 || cmd.rfind("LBP_RESIDUAL:",0)==0){
+            bool residual = (cmd.rfind("LBP_RESIDUAL:",0)==0);
+            std::string resto = recortar(cmd.substr(residual?13:4));
+            auto pc = resto.find(';');
+            std::string evs = recortar(resto.substr(0, pc));
+            try{
+                OpcionesLBP op;
+                if(residual) op.plan = OpcionesLBP::Planificacion::Residual;
+                if(pc!=std::string::npos){
+                    for(auto& a: dividir(recortar(resto.substr(pc+1)), ' ')){
+                        if(a.rfind("AMORT=",0)==0) op.amortiguacion = std::stod(a.substr(6));
+                        else if(a.rfind("TOL=",0)==0) op.tolerancia = std::stod(a.substr(4));
+                        else if(a.rfind("ITER=",0)==0) op.max_iter = std::stoul(a.substr(5));
+                        else if(a.rfind("HILOS=",0)==0) op.hilos = (unsigned)std::stoul(a.substr(6));
+                        else throw std::runtime_error("opción desconocida "+a);
+                    }
+                }
+                PropagacionCreencias lbp(rb);
+                ResultadoLBP r = lbp.ejecutar(lbp.indices_evidencia(parsear_evidencia(evs)), op);
+                for(size_t v=0; v<lbp.variables().size(); ++v){
+                    const Nodo* X = lbp.variables()[v];
+                    std::cout << "P("<<X->nombre<<" | "<<evs<<") ~\n";
+                    std::vector<std::pair<std::string,double>> d;
+                    for(size_t k=0;k<r.marginales[v].size();++k) d.push_back({X->valores[k], r.marginales[v][k]});
+                    imprimir_distribucion(d);
+                }
+                std::cout << (residual?"LBP_RESIDUAL: ":"LBP: ") << r.iteraciones << " iteraciones, residuo "
+                          << r.residuo << (r.convergio? " (convergió)\n" : " (sin converger)\n");
+            }catch(const std::exception& ex){
+                std::cerr << "Error en LBP: "<<ex.what()<<"\n";
+            }
+        }
+        // consulta exacta con plazo: "CONSULTAR_PLAZO: Var | ev ; PLAZO=ms [MUESTRAS=n] [SIN_RESPALDO]"
+        // se envía al servicio asíncrono; si vence el plazo responde con una
+        // estimación por ponderación por verosimilitud (o solo con el aviso)
+        else if(cmd.rfind("CONSULTAR_PLAZO:",0)==0){
+            std::string resto = recortar(cmd.substr(16));
+            auto pc = resto.find(';');
+            std::string opciones = pc==std::string::npos? std::string("") : recortar(resto.substr(pc+1));
+            resto = recortar(resto.substr(0, pc));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                OpcionesConsulta op;
+                for(auto& a: dividir(opciones, ' ')){
+                    if(a.rfind("PLAZO=",0)==0) op.plazo = std::chrono::milliseconds(std::stoul(a.substr(6)));
+                    else if(a.rfind("MUESTRAS=",0)==0) op.muestras_respaldo = std::stoul(a.substr(9));
+                    else if(a=="SIN_RESPALDO") op.respaldo = false;
+                    else throw std::runtime_error("opción desconocida "+a);
+                }
+                if(!servicio) servicio = std::make_unique<ServicioConsultas>(modelo);
+                ResultadoConsulta r = servicio->enviar(var, parsear_evidencia(evs), op).resultado.get();
+                if(r.estado==EstadoConsulta::Error) throw std::runtime_error(r.mensaje);
+                std::cout << "P("<<var<<" | "<<evs<<") ["<<nombre_estado(r.estado)<<", "
+                          << std::fixed << std::setprecision(1) << r.segundos*1e3 << " ms]\n"
+                          << std::setprecision(6);
+                for(size_t k=0;k<r.distribucion.size();++k){
+                    std::cout << r.distribucion[k].first << ": " << r.distribucion[k].second;
+                    if(!r.error_estandar.empty()) std::cout << " ± " << r.error_estandar[k];
+                    std::cout << "\n";
+                }
+            }catch(const std::exception& ex){
+                std::cerr << "Error en CONSULTAR_PLAZO: "<<ex.what()<<"\n";
+            }
+        }
+        // muestreo de importancia: "CONSULTAR_LW: Var | ev [; MUESTRAS=n HILOS=h SEMILLA=s]"
+        // o CONSULTAR_AIS (propuesta adaptativa, admite además LOTES=k y TAM_LOTE=m)
+        else if(cmd.rfind("CONSULTAR_LW:",0)==0 || cmd.rfind("CONSULTAR_AIS:",0)==0){
+            bool ais = (cmd.rfind("CONSULTAR_AIS:",0)==0);
+            std::string resto = recortar(cmd.substr(ais?14:13));
+            auto pc = resto.find(';');
+            std::string opciones = pc==std::string::npos? std::string("") : recortar(resto.substr(pc+1));
+            resto = recortar(resto.substr(0, pc));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                OpcionesMuestreo op;
+                op.adaptativo = ais;
+                for(auto& a: dividir(opciones, ' ')){
+                    if(a.rfind("MUESTRAS=",0)==0) op.muestras = std::stoul(a.substr(9));
+                    else if(a.rfind("LOTES=",0)==0) op.lotes_aprendizaje = std::stoul(a.substr(6));
+                    else if(a.rfind("TAM_LOTE=",0)==0) op.tam_lote = std::stoul(a.substr(9));
+                    else if(a.rfind("HILOS=",0)==0) op.hilos = (unsigned)std::stoul(a.substr(6));
+                    else if(a.rfind("SEMILLA=",0)==0) op.semilla = std::stoull(a.substr(8));
+                    else throw std::runtime_error("opción desconocida "+a);
+                }
+                MuestreoImportancia m(rb);
+                ResultadoMuestreo r = m.consultar(var, parsear_evidencia(evs), op);
+                std::cout << "P("<<var<<" | "<<evs<<") ~\n" << std::fixed << std::setprecision(6);
+                for(size_t k=0;k<r.distribucion.size();++k)
+                    std::cout << r.distribucion[k].first << ": " << r.distribucion[k].second
+                              << " ± " << r.error_estandar[k] << "\n";
+                std::cout << (ais?"AIS: ":"LW: ") << r.muestras << " muestras, "
+                          << std::setprecision(1) << r.muestras_efectivas << " efectivas, P(e) ~ "
+                          << std::scientific << std::setprecision(4) << r.prob_evidencia << "\n"
+                          << std::fixed << std::setprecision(6);
+            }catch(const std::exception& ex){
+                std::cerr << "Error en " << (ais?"CONSULTAR_AIS":"CONSULTAR_LW") << ": "<<ex.what()<<"\n";
+            }
+        }
+        // d-separación: "DSEP: X1,X2 ; Y1,Y2 | Z1,Z2" responde si X ⊥ Y | Z;
+        // "DSEP: X | Z" lista los nodos d-separados de X dado Z
+        else if(cmd.rfind("DSEP:",0)==0){
+            std::string resto = recortar(cmd.substr(5));
+            auto barra = resto.find('|');
+            std::string zs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            resto = recortar(resto.substr(0, barra));
+            auto pc = resto.find(';');
+            auto nombres = [](const std::string& s){
+                std::vector<std::string> r;
+                for(auto& n: dividir(s, ',')) if(!recortar(n).empty()) r.push_back(recortar(n));
+                return r;
+            };
+            try{
+                DSeparacion ds(rb);
+                ConjuntoNodos x = ds.conjunto(nombres(resto.substr(0, pc)));
+                ConjuntoNodos z = ds.conjunto(nombres(zs));
+                if(x.vacio()) throw std::runtime_error("falta el conjunto X");
+                if(pc!=std::string::npos){
+                    ConjuntoNodos y = ds.conjunto(nombres(resto.substr(pc+1)));
+                    std::cout << recortar(resto.substr(0, pc)) << " ⊥ " << recortar(resto.substr(pc+1))
+                              << " | " << zs << ": " << (ds.independiente(x, y, z)? "sí" : "no") << "\n";
+                }else{
+                    std::cout << "d-separados de " << resto << " dado {" << zs << "}:";
+                    bool alguno = false;
+                    ds.separados(x, z).para_cada([&](size_t i){
+                        std::cout << (alguno? ", " : " ") << ds.grafo().orden[i]->nombre;
+                        alguno = true;
+                    });
+                    std::cout << (alguno? "\n" : " (ninguno)\n");
+                }
+            }catch(const std::exception& ex){
+                std::cerr << "Error en DSEP: "<<ex.what()<<"\n";
+            }
+        }
+        // precisión de las CPTs: "PRECISION: DOBLE|FLOAT32|LOG16" vuelve a cargar
+        // la red, la recodifica y la publica como versión nueva
+        else if(cmd.rfind("PRECISION:",0)==0){
+            try{
+                auto p = precision_desde_texto(recortar(cmd.substr(10)));
+                uint64_t v = modelo.recargar([&](RedBayesiana& r){ cargar_red(r); compactar_cpts(r, p); }).get();
+                std::cout << "CPTs en "<<nombre_precision(p)<<": "<<bytes_cpts(rb)<<" -> "
+                          <<bytes_cpts(*modelo.instantanea()->red)<<" bytes (versión "<<v<<")\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en PRECISION: "<<ex.what()<<"\n";
+            }
+        }
+        // recarga en caliente: "RECARGAR: [estructura.txt cpts.txt | --binario modelo.rbn]"
+        // (sin argumentos, los mismos archivos). La red nueva se construye en
+        // otro hilo y se publica de una vez; si falla, sigue la versión actual
+        else if(cmd.rfind("RECARGAR:",0)==0){
+            auto args = dividir(recortar(cmd.substr(9)), ' ');
+            if(!args.empty() && args.size()!=2){
+                std::cerr << "Uso: RECARGAR: [<estructura.txt> <cpts.txt> | --binario <modelo.rbn>]\n";
+                continue;
+            }
+            try{
+                std::string e = args.empty()? f_estructura : args[0];
+                std::string c = args.empty()? f_cpts : args[1];
+                auto t0 = std::chrono::steady_clock::now();
+                uint64_t v = modelo.recargar([&](RedBayesiana& r){ cargar_desde(r, e, c); }).get();
+                f_estructura = e;
+                f_cpts = c;
+                std::cout << "Modelo recargado: versión "<<v<<" ("<<std::fixed<<std::setprecision(1)
+                          << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t0).count()
+                          << " ms)\n" << std::setprecision(6);
+            }catch(const std::exception& ex){
+                std::cerr << "Error en RECARGAR: "<<ex.what()<<"\n";
+            }
+        }
+        // modelo binario con la precisión actual de cada CPT: "GUARDAR_BIN: modelo.rbn"
+        else if(cmd.rfind("GUARDAR_BIN:",0)==0){
+            std::string ruta = recortar(cmd.substr(12));
+            try{
+                if(ruta.empty()) throw std::runtime_error("falta la ruta de salida");
+                guardar_binario(rb, ruta);
+                std::cout << "Modelo binario guardado: "<<ruta<<"\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en GUARDAR_BIN: "<<ex.what()<<"\n";
+            }
+        }
+        // memoria y exactitud de cada precisión: "MEMORIA: [Var | evidencias]"
+        // vuelve a cargar la red en cada precisión y la compara con double
+        // (entrada a entrada y, si se da una consulta, en la posterior)
+        else if(cmd.rfind("MEMORIA:",0)==0){
+            std::string resto = recortar(cmd.substr(8));
+            auto barra = resto.find('|');
+            std::string var = recortar(barra==std::string::npos? resto : resto.substr(0,barra));
+            std::string evs = barra==std::string::npos? std::string("") : recortar(resto.substr(barra+1));
+            try{
+                auto e = parsear_evidencia(evs);
+                RedBayesiana ref;
+                cargar_red(ref);
+                compactar_cpts(ref, TablaProbabilidad::Precision::Doble);
+                std::vector<std::pair<std::string,double>> post_ref;
+                if(!var.empty()) post_ref = InferenceEngine(ref).consultar_enumeracion(var, e, nullptr);
+                const size_t bytes_ref = bytes_cpts(ref);
+                const auto formato = std::cout.flags();
+                const auto decimales = std::cout.precision();
+
+                std::cout << "precisión  bytes CPT   ahorro  err. máx. entrada  err. rel. máx.  cota rel.";
+                if(!var.empty()) std::cout << "  err. máx. P("<<var<<" | "<<evs<<")";
+                std::cout << "\n";
+                for(auto p: {TablaProbabilidad::Precision::Doble, TablaProbabilidad::Precision::Simple,
+                             TablaProbabilidad::Precision::Log16}){
+                    RedBayesiana r;
+                    cargar_red(r);
+                    compactar_cpts(r, TablaProbabilidad::Precision::Doble);
+                    compactar_cpts(r, p);
+                    // error por entrada almacenada, y la peor cota declarada
+                    double err_abs = 0, err_rel = 0, cota = 0;
+                    for(const auto& kv: r.nodos){
+                        const TablaProbabilidad* T = kv.second->cpt.get();
+                        if(!T || !T->finalizada()) continue;
+                        const TablaProbabilidad& R = *ref.obtener(kv.first)->cpt;
+                        cota = std::max(cota, T->cota_error_relativo());
+                        for(size_t k=0;k<T->num_datos();++k){
+                            double a = R.dato(k), b = T->dato(k);
+                            if(std::isnan(a) || a==b) continue;
+                            err_abs = std::max(err_abs, std::fabs(a-b));
+                            err_rel = std::max(err_rel, std::fabs(a-b)/a);
+                        }
+                    }
+                    const size_t bytes = bytes_cpts(r);
+                    std::cout << std::left << std::setw(11) << nombre_precision(p) << std::right
+                              << std::setw(9) << bytes << std::fixed << std::setprecision(1)
+                              << std::setw(8) << 100.0*(1.0-(double)bytes/(double)bytes_ref) << "%"
+                              << std::scientific << std::setprecision(2)
+                              << std::setw(19) << err_abs << std::setw(16) << err_rel << std::setw(11) << cota;
+                    if(!var.empty()){
+                        auto d = InferenceEngine(r).consultar_enumeracion(var, e, nullptr);
+                        double err = 0;
+                        for(size_t k=0;k<d.size();++k) err = std::max(err, std::fabs(d[k].second-post_ref[k].second));
+                        std::cout << std::setw(14) << err;
+                    }
+                    std::cout << "\n";
+                }
+                std::cout.flags(formato);
+                std::cout.precision(decimales);
+            }catch(const std::exception& ex){
+                std::cerr << "Error en MEMORIA: "<<ex.what()<<"\n";
+            }
+        }
+        // generación de código: "GENERAR: salida.h [namespace]"
+        else if(cmd.rfind("GENERAR:",0)==0){
+            auto args = dividir(recortar(cmd.substr(8)), ' ');
+            if(args.empty()){
+                std::cerr << "Uso: GENERAR: <salida.h> [namespace]\n";
+                continue;
+            }
+            try{
+                // se genera en memoria: si la red se rechaza no queda
+                // una cabecera a medias en el disco
+                std::ostringstream cabecera;
+                generar_cabecera(rb, cabecera, args.size()>1? args[1] : "red_fija");
+                std::ofstream out(args[0]);
+                if(!out || !(out << cabecera.str())) throw std::runtime_error("No se puede escribir: "+args[0]);
+                std::cout << "Cabecera generada: "<<args[0]<<"\n";
+            }catch(const std::exception& ex){
+                std::cerr << "Error en GENERAR: "<<ex.what()<<"\n";
+            }
         }else{
             // si el comando no coincide con ninguno de los anteriores
             // mostramos mensaje indicando que no se reconoce
@@ -0,0 +1,67 @@
+#include "modelo_vivo.h"
+#include "red_bayesiana.h"
+#include <stdexcept>
+#include <thread>
+
+Instantanea::Instantanea(std::shared_ptr<const RedBayesiana> r, uint64_t v)
+    : red(std::move(r)), version(v), motor(red){
+}
+
+// call_once deja la bandera sin marcar si el constructor lanza: la
+// siguiente consulta vuelve a intentarlo y recibe el mismo error
+const MuestreoImportancia& Instantanea::muestreo() const{
+    std::call_once(muestreo_listo_, [this]{
+        muestreo_ = std::make_unique<MuestreoImportancia>(*red);
+    });
+    return *muestreo_;
+}
+
+ModeloVivo::ModeloVivo(std::shared_ptr<const RedBayesiana> inicial){
+    publicar(std::move(inicial));
+}
+
+ModeloVivo::~ModeloVivo(){
+    delete actual_.load();
+}
+
+std::shared_ptr<const Instantanea> ModeloVivo::instantanea() const{
+    // mientras el lector está anotado en su época, publicar() no libera
+    // el puntero que pudo haber leído
+    std::atomic<uint64_t>& lectores = lectores_[epoca_.load() & 1];
+    lectores.fetch_add(1);
+    const Puntero* p = actual_.load();
+    Puntero copia = p? *p : nullptr;
+    lectores.fetch_sub(1);
+    return copia;
+}
+
+// Un lector que leyó el puntero viejo se anotó antes del intercambio, en
+// la época par o impar. Cada cambio de época desvía a los lectores nuevos
+// al otro contador, así que el contador que se espera solo puede bajar;
+// dos cambios cubren las dos paridades.
+void ModeloVivo::esperar_lectores(){
+    for(int fase=0; fase<2; ++fase){
+        const uint64_t e = epoca_.fetch_add(1);
+        while(lectores_[e & 1].load()!=0) std::this_thread::yield();
+    }
+}
+
+uint64_t ModeloVivo::publicar(std::shared_ptr<const RedBayesiana> red){
+    if(!red) throw std::runtime_error("No se puede publicar una red vacía");
+    std::lock_guard<std::mutex> lk(publicacion_);
+    // todo el trabajo caro (análisis del grafo, motores) ocurre antes de publicar
+    auto nueva = new Puntero(std::make_shared<const Instantanea>(std::move(red), version_+1));
+    const Puntero* vieja = actual_.exchange(nueva);
+    ++version_;
+    esperar_lectores();
+    delete vieja;
+    return version_;
+}
+
+std::future<uint64_t> ModeloVivo::recargar(std::function<void(RedBayesiana&)> cargar){
+    return std::async(std::launch::async, [this, cargar]{
+        auto red = std::make_shared<RedBayesiana>();
+        cargar(*red);
+        return publicar(std::move(red));
+    });
+}
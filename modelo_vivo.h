@@ -0,0 +1,77 @@
+#ifndef MODELO_VIVO_H
+#define MODELO_VIVO_H
+#include "inferencia.h"
+#include "muestreo.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+struct RedBayesiana;
+
+// Versión inmutable del modelo con los motores que se construyen una vez
+// por red. Se comparte con shared_ptr: una consulta que la tomó la
+// mantiene viva hasta terminar, aunque ya se haya publicado otra.
+struct Instantanea{
+    std::shared_ptr<const RedBayesiana> red;
+    uint64_t version;
+    InferenceEngine motor;
+
+    Instantanea(std::shared_ptr<const RedBayesiana> r, uint64_t v);
+
+    // Muestreador (LW/AIS) de esta versión. Se construye en la primera
+    // consulta que lo pide, porque exige una CPT en cada nodo y una red
+    // sin alguna debe poder publicarse igual; en ese caso lanza aquí.
+    const MuestreoImportancia& muestreo() const;
+
+private:
+    mutable std::once_flag muestreo_listo_;
+    mutable std::unique_ptr<MuestreoImportancia> muestreo_;
+};
+
+// Modelo que se puede reemplazar en caliente, al estilo RCU:
+//  - instantanea() no toma ningún mutex: anota al lector en el contador de
+//    la época actual, copia el shared_ptr publicado y se borra del
+//    contador (unas pocas operaciones atómicas).
+//  - publicar() construye la instantánea (análisis del grafo y motores)
+//    antes de tocar nada, la publica con un solo intercambio atómico de
+//    puntero y espera un período de gracia: dos cambios de época, cada uno
+//    hasta que se vacía el contador de la época anterior. Después ningún
+//    lector puede estar copiando el puntero viejo y se libera (la red
+//    sigue viva mientras alguna consulta en curso la use).
+// Los lectores nunca esperan a los publicadores. Los publicadores se
+// serializan entre sí y solo esperan a lectores que están copiando un
+// puntero, no a consultas.
+class ModeloVivo{
+public:
+    ModeloVivo() = default;
+    explicit ModeloVivo(std::shared_ptr<const RedBayesiana> inicial);
+    ~ModeloVivo();
+    ModeloVivo(const ModeloVivo&) = delete;
+    ModeloVivo& operator=(const ModeloVivo&) = delete;
+
+    // versión actual (nullptr si aún no se publicó ninguna)
+    std::shared_ptr<const Instantanea> instantanea() const;
+
+    // publica `red` como versión nueva y devuelve su número
+    uint64_t publicar(std::shared_ptr<const RedBayesiana> red);
+
+    // Carga una red nueva con `cargar` en un hilo aparte y la publica.
+    // Si la carga falla, la versión actual no cambia y el future lleva la
+    // excepción.
+    std::future<uint64_t> recargar(std::function<void(RedBayesiana&)> cargar);
+
+private:
+    using Puntero = std::shared_ptr<const Instantanea>;
+    std::atomic<const Puntero*> actual_{nullptr};
+    std::atomic<uint64_t> epoca_{0};
+    mutable std::atomic<uint64_t> lectores_[2] = {};
+    std::mutex publicacion_;
+    uint64_t version_ = 0;
+
+    void esperar_lectores();
+};
+
+#endif // MODELO_VIVO_H
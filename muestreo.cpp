@@ -0,0 +1,235 @@
+#include "muestreo.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// las ICPTs se guardan densas: más filas que esto y el nodo se muestrea
+// con su CPT (sin aprender), como haría la ponderación por verosimilitud
+const size_t MAX_ENTRADAS_ICPT = 1u<<20;
+
+} // namespace
+
+// distribución propuesta: ICPT densa por nodo (vacía = usar la CPT)
+struct MuestreoImportancia::Propuesta{
+    std::vector<std::vector<double>> icpt;
+};
+
+// sumas de pesos de un hilo; `cuentas` solo se usa al aprender
+struct MuestreoImportancia::Acumulador{
+    size_t muestras = 0;
+    double sw = 0, sw2 = 0;
+    std::vector<double> swk, sw2k;                 // por valor de la consulta
+    std::vector<std::vector<double>> cuentas;      // Σ w por entrada de cada ICPT
+
+    void sumar(const Acumulador& o){
+        muestras += o.muestras; sw += o.sw; sw2 += o.sw2;
+        for(size_t k=0;k<swk.size();++k){ swk[k] += o.swk[k]; sw2k[k] += o.sw2k[k]; }
+        for(size_t v=0; v<cuentas.size(); ++v)
+            for(size_t i=0;i<cuentas[v].size();++i) cuentas[v][i] += o.cuentas[v][i];
+    }
+};
+
+MuestreoImportancia::MuestreoImportancia(const RedBayesiana& rb): rb_(rb){
+    vars_ = rb.grafo().orden;
+    for(size_t v=0; v<vars_.size(); ++v) card_.push_back(vars_[v]->valores.size());
+    padres_.resize(vars_.size());
+    pasos_.resize(vars_.size());
+    for(size_t v=0; v<vars_.size(); ++v){
+        const Nodo* X = vars_[v];
+        // una red híbrida se puede cargar igual; el error llega al consultar
+        if(X->gauss){ continuo_ = X; continue; }
+        if(!X->cpt || !X->cpt->finalizada())
+            throw std::runtime_error(mensaje_sin_cpt(X));
+        const TablaProbabilidad& T = *X->cpt;
+        for(Nodo* p: T.padres){
+            size_t pp = (size_t)p->id;
+            if(pp>v) throw std::runtime_error("CPT de "+X->nombre+" usa un padre fuera de la estructura: "+p->nombre);
+            padres_[v].push_back(pp);
+        }
+        pasos_[v].assign(T.padres.size(), 1);
+        for(size_t k=T.padres.size(); k-- > 1; ) pasos_[v][k-1] = pasos_[v][k]*card_[padres_[v][k]];
+    }
+}
+
+// muestreo hacia adelante con pesos de importancia:
+// w = Π_{libres} P(x|pa)/Q(x|pa) · Π_{observadas} P(e|pa)
+template<class Rng>
+void MuestreoImportancia::muestrear(size_t n, const std::vector<int>& ev, const std::vector<bool>& relevante,
+                                    const Propuesta& q, size_t consulta, Rng& rng, Acumulador& acc,
+                                    std::chrono::steady_clock::time_point plazo) const{
+    std::uniform_real_distribution<double> U(0.0, 1.0);
+    std::vector<int> asig(vars_.size(), 0);
+    std::vector<size_t> fila(vars_.size(), 0);
+    const bool con_plazo = plazo!=std::chrono::steady_clock::time_point::max();
+    for(size_t s=0; s<n; ++s){
+        if(con_plazo && (s & 255)==255 && std::chrono::steady_clock::now()>=plazo) break;
+        double w = 1.0;
+        for(size_t v=0; v<vars_.size() && w>0; ++v){
+            if(!relevante[v]) continue;
+            const TablaProbabilidad& T = *vars_[v]->cpt;
+            size_t f = 0;
+            for(size_t j=0;j<padres_[v].size();++j) f += (size_t)asig[padres_[v][j]]*pasos_[v][j];
+            fila[v] = f;
+            if(ev[v]>=0){
+                asig[v] = ev[v];
+                w *= T.prob(f, (size_t)ev[v]);
+                continue;
+            }
+            // muestreo por inversión de la acumulada de la propuesta
+            const double* icpt = q.icpt[v].empty()? nullptr : &q.icpt[v][f*card_[v]];
+            double u = U(rng), a = 0;
+            size_t k = 0;
+            for(; k+1<card_[v]; ++k){
+                a += icpt? icpt[k] : T.prob(f, k);
+                if(u<a) break;
+            }
+            asig[v] = (int)k;
+            if(icpt) w *= T.prob(f, k)/icpt[k];
+        }
+        ++acc.muestras;
+        if(w<=0) continue;
+        acc.sw += w;
+        acc.sw2 += w*w;
+        acc.swk[asig[consulta]] += w;
+        acc.sw2k[asig[consulta]] += w*w;
+        for(size_t v=0; v<acc.cuentas.size(); ++v)
+            if(!acc.cuentas[v].empty()) acc.cuentas[v][fila[v]*card_[v]+asig[v]] += w;
+    }
+}
+
+ResultadoMuestreo MuestreoImportancia::consultar(
+    const std::string& variable,
+    const std::unordered_map<std::string,std::string>& evidencia,
+    const OpcionesMuestreo& op) const{
+
+    if(continuo_) throw std::runtime_error(mensaje_sin_cpt(continuo_));
+    const size_t n = vars_.size();
+    auto itq = std::find_if(vars_.begin(), vars_.end(), [&](const Nodo* X){ return X->nombre==variable; });
+    if(itq==vars_.end()) throw std::runtime_error("Variable desconocida: "+variable);
+    const size_t consulta = (size_t)(itq-vars_.begin());
+
+    // evidencia por índices (la de la propia consulta se ignora)
+    std::vector<int> ev(n, -1);
+    for(const auto& kv: evidencia){
+        auto it = std::find_if(vars_.begin(), vars_.end(), [&](const Nodo* X){ return X->nombre==kv.first; });
+        if(it==vars_.end()) throw std::runtime_error("Variable desconocida: "+kv.first);
+        const Nodo* X = *it;
+        auto jt = std::find(X->valores.begin(), X->valores.end(), kv.second);
+        if(jt==X->valores.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        if(X!=*itq) ev[it-vars_.begin()] = (int)(jt-X->valores.begin());
+    }
+
+    // solo se muestrean los ancestros de la consulta y de la evidencia;
+    // `ancestro_ev` marca los que pueden beneficiarse de una ICPT
+    const AnalisisGrafo& g = rb_.grafo();
+    ConjuntoNodos observados = g.vacio();
+    for(size_t v=0; v<n; ++v) if(ev[v]>=0) observados.insertar(v);
+    ConjuntoNodos fijados = observados;
+    fijados.insertar(consulta);
+    std::vector<bool> relevante(n, false), ancestro_ev(n, false), padre_ev(n, false);
+    g.cierre_ancestral(fijados).para_cada([&](size_t v){ relevante[v] = true; });
+    g.cierre_ancestral(observados).para_cada([&](size_t v){ ancestro_ev[v] = true; });
+    observados.para_cada([&](size_t v){ for(size_t p: padres_[v]) padre_ev[p] = true; });
+
+    // propuesta inicial: la CPT. AIS-BN parte de ella con dos heurísticas:
+    // uniforme para los padres de la evidencia y un mínimo de 0.1/r para
+    // que las probabilidades pequeñas (que la evidencia puede volver
+    // importantes) se muestreen desde el primer lote
+    Propuesta q;
+    q.icpt.resize(n);
+    if(op.adaptativo){
+        for(size_t v=0; v<n; ++v){
+            if(!relevante[v] || !ancestro_ev[v] || ev[v]>=0) continue;
+            const TablaProbabilidad& T = *vars_[v]->cpt;
+            const size_t r = card_[v];
+            if(T.num_filas() > MAX_ENTRADAS_ICPT/r) continue;
+            std::vector<double>& I = q.icpt[v];
+            I.resize(T.num_filas()*r);
+            const double minimo = 0.1/(double)r;
+            for(size_t f=0; f<T.num_filas(); ++f){
+                double z = 0;
+                for(size_t k=0;k<r;++k){
+                    double p = padre_ev[v]? 1.0/(double)r : T.prob(f, k);
+                    I[f*r+k] = std::max(p, minimo);
+                    z += I[f*r+k];
+                }
+                for(size_t k=0;k<r;++k) I[f*r+k] /= z;
+            }
+        }
+    }
+
+    unsigned hilos = op.hilos ? op.hilos : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::mt19937_64> rng;
+    for(unsigned t=0; t<hilos; ++t){
+        std::seed_seq semilla{(uint64_t)op.semilla, (uint64_t)t};
+        rng.emplace_back(semilla);
+    }
+    auto acumulador = [&](bool aprender){
+        Acumulador a;
+        a.swk.assign(card_[consulta], 0.0);
+        a.sw2k.assign(card_[consulta], 0.0);
+        if(aprender){
+            a.cuentas.resize(n);
+            for(size_t v=0; v<n; ++v) a.cuentas[v].assign(q.icpt[v].size(), 0.0);
+        }
+        return a;
+    };
+    // reparte `total` muestras entre los hilos y suma sus acumuladores
+    auto lote = [&](size_t total, bool aprender){
+        std::vector<Acumulador> parcial;
+        for(unsigned t=0; t<hilos; ++t) parcial.push_back(acumulador(aprender));
+        std::vector<std::thread> th;
+        for(unsigned t=1; t<hilos; ++t)
+            th.emplace_back([&, t]{ muestrear(total*(t+1)/hilos - total*t/hilos, ev, relevante, q, consulta, rng[t], parcial[t], op.plazo); });
+        muestrear(total/hilos, ev, relevante, q, consulta, rng[0], parcial[0], op.plazo);
+        for(auto& x: th) x.join();
+        for(unsigned t=1; t<hilos; ++t) parcial[0].sumar(parcial[t]);
+        return parcial[0];
+    };
+
+    // aprendizaje de las ICPTs: Q <- Q + η(k) (P'(x | pa, e) - Q), donde P'
+    // es la frecuencia ponderada del lote y η decae geométricamente
+    if(op.adaptativo){
+        for(size_t k=0; k<op.lotes_aprendizaje; ++k){
+            Acumulador a = lote(op.tam_lote, true);
+            const double eta = op.tasa_inicial * std::pow(op.tasa_final/op.tasa_inicial,
+                                                          (double)k/(double)std::max<size_t>(1, op.lotes_aprendizaje));
+            for(size_t v=0; v<n; ++v){
+                std::vector<double>& I = q.icpt[v];
+                const size_t r = card_[v];
+                for(size_t f=0; f<I.size()/std::max<size_t>(1, r); ++f){
+                    double tot = 0;
+                    for(size_t j=0;j<r;++j) tot += a.cuentas[v][f*r+j];
+                    if(tot<=0) continue; // fila no visitada con peso: se conserva
+                    for(size_t j=0;j<r;++j) I[f*r+j] += eta*(a.cuentas[v][f*r+j]/tot - I[f*r+j]);
+                }
+            }
+        }
+    }
+
+    // estimación final con la propuesta aprendida (o la CPT en LW)
+    Acumulador a = lote(op.muestras, false);
+    if(a.sw<=0)
+        throw std::runtime_error("Todas las muestras tienen peso 0 (evidencia muy improbable: aumentar MUESTRAS)");
+
+    ResultadoMuestreo res;
+    res.muestras = a.muestras;
+    res.prob_evidencia = a.sw/(double)a.muestras;
+    res.muestras_efectivas = a.sw*a.sw/a.sw2;
+    const Nodo* Q = vars_[consulta];
+    for(size_t k=0;k<card_[consulta];++k){
+        // p = Σ w·1[q=k] / Σ w; varianza por el método delta del cociente
+        double p = a.swk[k]/a.sw;
+        double var = (a.sw2k[k]*(1.0-2.0*p) + p*p*a.sw2)/(a.sw*a.sw);
+        res.distribucion.push_back({Q->valores[k], p});
+        res.error_estandar.push_back(std::sqrt(std::max(0.0, var)));
+    }
+    return res;
+}
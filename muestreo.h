@@ -0,0 +1,72 @@
+#ifndef MUESTREO_H
+#define MUESTREO_H
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct RedBayesiana; struct Nodo;
+
+struct OpcionesMuestreo{
+    bool adaptativo = true;        // AIS-BN; false = ponderación por verosimilitud
+    size_t muestras = 100000;      // muestras de la estimación final
+    size_t tam_lote = 5000;        // muestras por lote de aprendizaje
+    size_t lotes_aprendizaje = 10; // lotes usados para ajustar las CPTs de importancia
+    double tasa_inicial = 0.4;     // tasa de aprendizaje: decae de la inicial a la final
+    double tasa_final = 0.14;
+    unsigned hilos = 0;            // 0 = hardware_concurrency
+    uint64_t semilla = 12345;
+    // al llegar al plazo se deja de muestrear y se estima con las muestras
+    // hechas hasta entonces (al menos unas pocas por hilo)
+    std::chrono::steady_clock::time_point plazo = std::chrono::steady_clock::time_point::max();
+};
+
+struct ResultadoMuestreo{
+    std::vector<std::pair<std::string,double>> distribucion; // P(var | e) estimada
+    std::vector<double> error_estandar;                      // por valor (método delta)
+    double prob_evidencia = 0;     // estimación de P(e): peso medio
+    double muestras_efectivas = 0; // (Σw)² / Σw²
+    size_t muestras = 0;
+};
+
+// Muestreo de importancia. Cada muestra recorre la red en orden
+// topológico: las variables libres se muestrean de una distribución
+// propuesta y las observadas multiplican el peso por P(e | padres).
+//  - Ponderación por verosimilitud (LW): la propuesta es la propia CPT.
+//    Con evidencia improbable en las hojas casi todos los pesos son ~0.
+//  - AIS-BN: la propuesta es una CPT de importancia (ICPT) por nodo que
+//    se aprende en lotes sucesivos a partir de las muestras ponderadas,
+//    partiendo de la CPT con dos heurísticas iniciales (uniforme en los
+//    padres de la evidencia y un mínimo para las probabilidades muy
+//    pequeñas). Solo se aprenden los ancestros de la evidencia: para el
+//    resto la CPT ya es la propuesta óptima.
+// Los lotes se reparten entre hilos, cada uno con su propio generador
+// (mt19937_64 sembrado con la semilla y el número de hilo), así que el
+// resultado es reproducible para una semilla y un número de hilos dados.
+class MuestreoImportancia{
+public:
+    explicit MuestreoImportancia(const RedBayesiana& rb);
+
+    ResultadoMuestreo consultar(const std::string& variable,
+                                const std::unordered_map<std::string,std::string>& evidencia,
+                                const OpcionesMuestreo& op) const;
+
+private:
+    const RedBayesiana& rb_;
+    std::vector<Nodo*> vars_;                 // orden topológico (índice = Nodo::id)
+    std::vector<size_t> card_;
+    std::vector<std::vector<size_t>> padres_; // posiciones de los padres de cada CPT
+    std::vector<std::vector<size_t>> pasos_;  // paso de cada padre en el índice de fila
+    const Nodo* continuo_ = nullptr;          // algún nodo continuo: solo se muestrean redes discretas
+
+    struct Propuesta;
+    struct Acumulador;
+    // genera `n` muestras con la propuesta `q` y acumula en `acc`
+    template<class Rng>
+    void muestrear(size_t n, const std::vector<int>& ev, const std::vector<bool>& relevante,
+                   const Propuesta& q, size_t consulta, Rng& rng, Acumulador& acc,
+                   std::chrono::steady_clock::time_point plazo) const;
+};
+
+#endif // MUESTREO_H
@@ -6,6 +6,7 @@
 
 // Hacer visible la definición de TablaProbabilidad antes de usar std::unique_ptr<TablaProbabilidad>
 #include "tabla_probabilidad.h"
+#include "gaussiana.h"
 
 struct Nodo{
     std::string nombre;
@@ -13,6 +14,8 @@ struct Nodo{
     std::vector<Nodo*> padres;
     std::vector<Nodo*> hijos;
     std::unique_ptr<TablaProbabilidad> cpt; // tabla de probabilidad condicional
+    std::unique_ptr<GaussianaCondicional> gauss; // nodo continuo: densidad CLG (sin cpt ni valores)
+    int id = -1;                           // posición topológica (la asigna RedBayesiana::grafo())
 
     // Nodo representa una variable aleatoria en la red. Mantiene
     // - `valores`: dominio discreto de la variable
@@ -21,4 +24,9 @@ struct Nodo{
     explicit Nodo(std::string n="");
 };
 
+// error de los motores que solo admiten nodos discretos con CPT
+inline std::string mensaje_sin_cpt(const Nodo* X){
+    return X->gauss? "Nodo continuo (use CONSULTAR_HIBRIDA): "+X->nombre : "Nodo sin CPT: "+X->nombre;
+}
+
 #endif // NODO_H
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "planificador.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+Planificador::Planificador(const RedBayesiana& rb, const OpcionesPlanificador& op)
+    : rb_(rb), op_(op){
+    for(const Nodo* X: rb.grafo().orden) card_.push_back(X->valores.size());
+}
+
+std::shared_ptr<PlanConsulta> Planificador::calcular(const std::vector<int>& consulta,
+                                                     const std::vector<int>& evidencia) const{
+    const auto inicio = std::chrono::steady_clock::now();
+    const AnalisisGrafo& g = rb_.grafo();
+    const size_t n = g.orden.size();
+    auto plan = std::make_shared<PlanConsulta>();
+    plan->consulta = consulta;
+    plan->evidencia = evidencia;
+
+    std::vector<bool> observada(n, false);
+    ConjuntoNodos fijados(n);
+    for(int e: evidencia){ observada[e] = true; fijados.insertar((size_t)e); }
+    for(int q: consulta) fijados.insertar((size_t)q);
+    // los nodos fuera del cierre ancestral suman 1 y no entran
+    std::vector<bool> relevante(n, false);
+    g.cierre_ancestral(fijados).para_cada([&](size_t i){ relevante[i] = true; });
+
+    // alcances globales y numeración local de las variables que aparecen.
+    // La forma de los factores de cada familia la da factorizar() con el
+    // patrón (los valores observados no cambian la forma): un noisy-OR/MAX
+    // grande se descompone con una variable auxiliar en vez de expandirse.
+    std::vector<std::vector<int>> alcances;
+    std::vector<int> local(n, -1), global;
+    plan->card = card_;
+    for(size_t v=0; v<n; ++v){
+        if(!relevante[v]) continue;
+        const Nodo* X = g.orden[v];
+        if(!X->cpt || !X->cpt->finalizada()) throw std::runtime_error(mensaje_sin_cpt(X));
+        const TablaProbabilidad& T = *X->cpt;
+        std::vector<int> ev_padres;
+        for(const Nodo* p: T.padres){
+            if(p->id<0 || !relevante[(size_t)p->id] || (size_t)p->id>=v)
+                throw std::runtime_error("CPT de "+X->nombre+" usa un padre fuera de la estructura: "+p->nombre);
+            ev_padres.push_back(observada[(size_t)p->id]? 0 : -1);
+        }
+        int aux = -1;
+        for(const auto& f: T.factorizar(ev_padres, observada[v]? 0 : -1, true)){
+            std::vector<int> vars;
+            for(size_t k: f.padres_libres) vars.push_back(T.padres[k]->id);
+            if(f.con_variable) vars.push_back((int)v);
+            if(f.con_auxiliar){
+                if(aux<0){
+                    aux = (int)plan->card.size();
+                    plan->card.push_back(X->valores.size());
+                    plan->auxiliares.push_back((int)v);
+                    local.push_back(-1);
+                }
+                vars.push_back(aux);
+            }
+            for(int u: vars) if(local[u]<0){ local[u] = (int)global.size(); global.push_back(u); }
+            plan->familias.push_back((int)v);
+            plan->factores.push_back(AlcanceFactor::crear(vars, plan->card));
+            alcances.push_back(std::move(vars));
+        }
+    }
+    std::vector<std::vector<int>> alc_local = alcances;
+    for(auto& a: alc_local) for(int& u: a) u = local[u];
+    std::vector<size_t> card_local;
+    for(int u: global) card_local.push_back(plan->card[u]);
+    std::vector<bool> conservar(global.size(), false);
+    for(int q: consulta) conservar[local[q]] = true;
+
+    // candidatos: las tres heurísticas y los reinicios aleatorios
+    const Heuristica fijas[] = {Heuristica::MinFill, Heuristica::MinFillPonderado, Heuristica::MinGrado};
+    const size_t total = 3 + op_.reinicios;
+    plan->candidatos.resize(total);
+    auto generar = [&](size_t k){
+        CandidatoPlan& c = plan->candidatos[k];
+        std::vector<int> orden;
+        if(k<3){
+            c.heuristica = nombre_heuristica(fijas[k]);
+            orden = orden_eliminacion(alc_local, card_local, conservar, fijas[k]);
+        }else{
+            c.heuristica = "aleatorio #"+std::to_string(k-2);
+            std::mt19937_64 rng(op_.semilla + k);
+            orden = orden_eliminacion(alc_local, card_local, conservar, Heuristica::MinFillPonderado,
+                                      &rng, op_.candidatas);
+        }
+        c.coste = coste_eliminacion(alc_local, card_local, orden);
+        for(int u: orden) c.orden.push_back(global[u]);
+    };
+    unsigned hilos = op_.hilos? op_.hilos : std::max(1u, std::thread::hardware_concurrency());
+    hilos = (unsigned)std::min<size_t>(hilos, total);
+    std::atomic<size_t> siguiente(0);
+    auto trabajar = [&]{ for(size_t k; (k = siguiente++) < total; ) generar(k); };
+    std::vector<std::thread> th;
+    for(unsigned t=1; t<hilos; ++t) th.emplace_back(trabajar);
+    trabajar();
+    for(auto& t: th) t.join();
+
+    // el de menos operaciones; a igualdad, menor factor máximo y luego el primero
+    size_t mejor = 0;
+    for(size_t k=1; k<total; ++k){
+        const CosteEliminacion& a = plan->candidatos[k].coste;
+        const CosteEliminacion& b = plan->candidatos[mejor].coste;
+        if(a.flops<b.flops || (a.flops==b.flops && a.max_factor<b.max_factor)) mejor = k;
+    }
+    plan->orden = plan->candidatos[mejor].orden;
+    plan->coste = plan->candidatos[mejor].coste;
+    plan->heuristica = plan->candidatos[mejor].heuristica;
+    plan->eliminacion = PlanEliminacion::compilar(plan->factores, plan->card, plan->consulta, plan->orden);
+    plan->segundos = std::chrono::duration<double>(std::chrono::steady_clock::now()-inicio).count();
+    return plan;
+}
+
+std::shared_ptr<const PlanConsulta> Planificador::planificar(std::vector<int> consulta, std::vector<int> evidencia,
+                                                             bool* en_cache){
+    std::sort(consulta.begin(), consulta.end());
+    consulta.erase(std::unique(consulta.begin(), consulta.end()), consulta.end());
+    std::sort(evidencia.begin(), evidencia.end());
+    evidencia.erase(std::unique(evidencia.begin(), evidencia.end()), evidencia.end());
+    // la evidencia sobre la consulta se ignora, como en CONSULTAR
+    evidencia.erase(std::remove_if(evidencia.begin(), evidencia.end(), [&](int e){
+        return std::binary_search(consulta.begin(), consulta.end(), e);
+    }), evidencia.end());
+    std::string clave;
+    for(int q: consulta) clave += std::to_string(q) + ",";
+    clave += "|";
+    for(int e: evidencia) clave += std::to_string(e) + ",";
+
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto it = cache_.find(clave);
+        if(it!=cache_.end()){
+            ++aciertos_;
+            uso_.splice(uso_.begin(), uso_, it->second.second);
+            if(en_cache) *en_cache = true;
+            return it->second.first;
+        }
+        ++fallos_;
+    }
+    if(en_cache) *en_cache = false;
+
+    // se planifica sin el candado; si otro hilo guardó el mismo patrón
+    // entretanto, se queda el suyo
+    std::shared_ptr<const PlanConsulta> plan = calcular(consulta, evidencia);
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = cache_.find(clave);
+    if(it!=cache_.end()) return it->second.first;
+    uso_.push_front(clave);
+    cache_[clave] = {plan, uso_.begin()};
+    while(cache_.size() > std::max<size_t>(1, op_.max_planes)){
+        cache_.erase(uso_.back());
+        uso_.pop_back();
+    }
+    return plan;
+}
+
+std::vector<std::pair<int,int>> Planificador::indices_evidencia(
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    std::vector<std::pair<int,int>> ev;
+    for(const auto& kv: evidencia){
+        const Nodo* X = rb_.obtener(kv.first);
+        if(!X) throw std::runtime_error("Variable desconocida: "+kv.first);
+        auto it = std::find(X->valores.begin(), X->valores.end(), kv.second);
+        if(it==X->valores.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        ev.push_back({X->id, (int)(it-X->valores.begin())});
+    }
+    std::sort(ev.begin(), ev.end());
+    return ev;
+}
+
+std::vector<std::pair<std::string,double>> Planificador::consultar(
+    const std::string& variable,
+    const std::unordered_map<std::string,std::string>& evidencia,
+    bool* en_cache){
+    const Nodo* Q = rb_.obtener(variable);
+    if(!Q) throw std::runtime_error("Variable desconocida: "+variable);
+    const auto ev = indices_evidencia(evidencia);
+    std::vector<int> ids, valor(card_.size(), -1);
+    for(const auto& e: ev){
+        if(e.first==Q->id) continue; // la evidencia sobre la consulta se ignora
+        ids.push_back(e.first);
+        valor[e.first] = e.second;
+    }
+    auto plan = planificar({Q->id}, ids, en_cache);
+    if(plan->coste.max_factor > op_.max_entradas){
+        std::ostringstream os;
+        os << "El plan necesita un factor de "<<plan->coste.max_factor<<" entradas (límite "<<op_.max_entradas<<")";
+        throw std::runtime_error(os.str());
+    }
+
+    // datos de cada factor: la CPT de su familia factorizada por la evidencia
+    const AnalisisGrafo& g = rb_.grafo();
+    std::vector<std::vector<double>> datos;
+    std::vector<const double*> punteros;
+    for(size_t i=0; i<plan->familias.size(); ){
+        const int v = plan->familias[i];
+        const TablaProbabilidad& T = *g.orden[v]->cpt;
+        std::vector<int> ev_padres;
+        for(const Nodo* p: T.padres) ev_padres.push_back(valor[p->id]);
+        for(auto& f: T.factorizar(ev_padres, valor[v], true)){
+            if(i>=plan->familias.size() || plan->familias[i]!=v || f.valores.size()!=plan->factores[i].tam)
+                throw std::runtime_error("La factorización de "+g.orden[v]->nombre+" no coincide con el plan");
+            datos.push_back(std::move(f.valores));
+            ++i;
+        }
+    }
+    for(const auto& d: datos) punteros.push_back(d.data());
+
+    PlanEliminacion::Estado estado;
+    std::vector<double> salida;
+    plan->eliminacion.ejecutar(punteros, salida, estado);
+    double z = 0;
+    for(double x: salida) z += x;
+    if(!(z>0)) throw std::runtime_error("Normalización 0");
+
+    std::vector<std::pair<std::string,double>> dist;
+    for(size_t k=0; k<salida.size(); ++k) dist.push_back({Q->valores[k], salida[k]/z});
+    return dist;
+}
+
+size_t Planificador::aciertos() const{ std::lock_guard<std::mutex> lk(mutex_); return aciertos_; }
+size_t Planificador::fallos() const{ std::lock_guard<std::mutex> lk(mutex_); return fallos_; }
+size_t Planificador::planes_en_cache() const{ std::lock_guard<std::mutex> lk(mutex_); return cache_.size(); }
@@ -0,0 +1,103 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+#include "eliminacion.h"
+#include "factor.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct RedBayesiana;
+
+struct OpcionesPlanificador{
+    size_t reinicios = 8;        // órdenes aleatorios además de las tres heurísticas
+    size_t candidatas = 3;       // en los aleatorios, se elige entre las k mejores por min-fill ponderado
+    unsigned hilos = 0;          // 0 = hardware_concurrency
+    uint64_t semilla = 1;
+    size_t max_planes = 1024;    // planes en caché (se descarta el usado hace más tiempo)
+    double max_entradas = 1<<26; // consultar() rechaza planes con un factor intermedio mayor
+};
+
+// Un orden probado y su coste estimado
+struct CandidatoPlan{
+    std::string heuristica;
+    std::vector<int> orden;      // variables del plan (ver PlanConsulta::card)
+    CosteEliminacion coste;
+};
+
+// Plan de un patrón de consulta: qué variables se consultan y cuáles
+// están observadas, no sus valores.
+struct PlanConsulta{
+    std::vector<int> consulta, evidencia;  // Nodo::id, ordenados
+    // una familia por factor: el nodo cuya CPT, factorizada por la
+    // evidencia (TablaProbabilidad::factorizar con auxiliar), da el factor.
+    // Los factores de una familia van seguidos y en el orden de factorizar.
+    std::vector<int> familias;
+    std::vector<AlcanceFactor> factores;
+    // variables: Nodo::id y, a partir de num_nodos, una auxiliar Y' por
+    // cada noisy-OR/MAX descompuesto (auxiliares[i] es el nodo de la i-ésima)
+    std::vector<size_t> card;
+    std::vector<int> auxiliares;
+    std::vector<int> orden;                // orden elegido
+    PlanEliminacion eliminacion;           // compilado con `orden`; se ejecuta con un Estado por llamada
+    CosteEliminacion coste;
+    std::string heuristica;
+    std::vector<CandidatoPlan> candidatos; // todos los probados, en el orden en que se generan
+    double segundos = 0;                   // tiempo que llevó planificar
+};
+
+// Planificador de eliminación de variables con caché por patrón.
+// Para un patrón (consulta, evidencia):
+//  - poda los nodos estériles (fuera del cierre ancestral de consulta y
+//    evidencia) y quita las variables observadas de los alcances;
+//  - genera órdenes con min-fill, min-fill ponderado, min-grado y
+//    `reinicios` órdenes aleatorios, en paralelo;
+//  - estima el coste de cada uno (mayor factor intermedio y operaciones)
+//    y se queda con el de menos operaciones (a igualdad, el de menor
+//    factor máximo).
+// El plan (con su eliminación ya compilada) se guarda en una caché LRU
+// con clave el patrón; las consultas con la misma forma no vuelven a
+// planificar ni a compilar. La evidencia sobre una variable de consulta
+// se ignora. Es seguro usarlo desde varios hilos mientras la red no cambie.
+class Planificador{
+public:
+    explicit Planificador(const RedBayesiana& rb, const OpcionesPlanificador& op = {});
+
+    // `en_cache` (opcional) indica si el plan ya estaba en la caché
+    std::shared_ptr<const PlanConsulta> planificar(std::vector<int> consulta, std::vector<int> evidencia,
+                                                   bool* en_cache = nullptr);
+
+    // P(variable | evidencia) por eliminación de variables con el plan del patrón
+    std::vector<std::pair<std::string,double>> consultar(
+        const std::string& variable,
+        const std::unordered_map<std::string,std::string>& evidencia,
+        bool* en_cache = nullptr);
+
+    // evidencia como (Nodo::id, índice de valor), ordenada por id
+    std::vector<std::pair<int,int>> indices_evidencia(
+        const std::unordered_map<std::string,std::string>& evidencia) const;
+
+    size_t aciertos() const;
+    size_t fallos() const;
+    size_t planes_en_cache() const;
+
+private:
+    const RedBayesiana& rb_;
+    OpcionesPlanificador op_;
+    std::vector<size_t> card_;            // por Nodo::id
+
+    mutable std::mutex mutex_;
+    std::list<std::string> uso_;          // claves, la usada más recientemente al frente
+    std::unordered_map<std::string, std::pair<std::shared_ptr<const PlanConsulta>,
+                                              std::list<std::string>::iterator>> cache_;
+    size_t aciertos_ = 0, fallos_ = 0;
+
+    std::shared_ptr<PlanConsulta> calcular(const std::vector<int>& consulta,
+                                           const std::vector<int>& evidencia) const;
+};
+
+#endif // PLANIFICADOR_H
@@ -0,0 +1,322 @@
+#include "propagacion.h"
+#include "red_bayesiana.h"
+#include "nodo.h"
+#include "tabla_probabilidad.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+// barrera reutilizable: el último hilo en llegar ejecuta `al_completar`
+// antes de liberar a los demás (reducción del residuo y swap de buffers)
+class Barrera{
+public:
+    explicit Barrera(unsigned n): n_(n) {}
+    template<class F>
+    void esperar(F al_completar){
+        std::unique_lock<std::mutex> l(m_);
+        size_t gen = generacion_;
+        if(++llegados_ == n_){
+            al_completar();
+            llegados_ = 0;
+            ++generacion_;
+            cv_.notify_all();
+        }else{
+            cv_.wait(l, [&]{ return gen!=generacion_; });
+        }
+    }
+private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    unsigned n_, llegados_ = 0;
+    size_t generacion_ = 0;
+};
+
+// normaliza un mensaje para que sume 1 en valor absoluto (si es todo
+// ceros se deja así); solo los mensajes de las auxiliares tienen signo
+void normalizar(double* m, size_t n){
+    double s = 0;
+    for(size_t k=0;k<n;++k) s += std::fabs(m[k]);
+    if(s>0) for(size_t k=0;k<n;++k) m[k] /= s;
+}
+
+} // namespace
+
+// buffers de una ejecución: mensajes en ambos sentidos y, para la
+// planificación residual, los mensajes candidatos y su residuo
+struct PropagacionCreencias::Estado{
+    std::vector<double> vf;        // variable -> factor
+    std::vector<double> fv;        // factor -> variable
+    std::vector<double> nuevo;     // factor -> variable candidato / del barrido siguiente
+    std::vector<double> residuo;   // por arista
+};
+
+PropagacionCreencias::PropagacionCreencias(const RedBayesiana& rb){
+    vars_ = rb.grafo().orden;
+    const size_t n = vars_.size();
+    for(size_t v=0; v<n; ++v) card_.push_back(vars_[v]->valores.size());
+
+    // factores de cada CPT sin evidencia (entra como λ en las variables):
+    // la tabla completa, o la descomposición de un noisy-OR/MAX grande
+    std::vector<std::vector<uint32_t>> de_var(n);
+    primera_.push_back(0);
+    for(size_t v=0; v<n; ++v){
+        const Nodo* X = vars_[v];
+        if(!X->cpt || !X->cpt->finalizada())
+            throw std::runtime_error(mensaje_sin_cpt(X));
+        const TablaProbabilidad& T = *X->cpt;
+        uint32_t aux = 0;
+        for(auto& f: T.factorizar(std::vector<int>(T.padres.size(), -1), -1, true)){
+            std::vector<uint32_t> alcance;
+            for(size_t k: f.padres_libres) alcance.push_back((uint32_t)T.padres[k]->id);
+            if(f.con_variable) alcance.push_back((uint32_t)v);
+            if(f.con_auxiliar){
+                if(!aux){
+                    aux = (uint32_t)card_.size();
+                    card_.push_back(card_[v]);
+                    de_var.emplace_back();
+                }
+                alcance.push_back(aux);
+            }
+            const uint32_t g = (uint32_t)(primera_.size()-1);
+            for(uint32_t u: alcance){
+                de_var[u].push_back((uint32_t)factor_de_.size());
+                factor_de_.push_back(g);
+                var_de_.push_back(u);
+                desp_.push_back(tam_mensajes_);
+                tam_mensajes_ += card_[u];
+            }
+            primera_.push_back(factor_de_.size());
+            tabla_.push_back(tablas_.size());
+            tablas_.insert(tablas_.end(), f.valores.begin(), f.valores.end());
+        }
+    }
+    inicio_var_.push_back(0);
+    for(size_t v=0; v<card_.size(); ++v){
+        aristas_var_.insert(aristas_var_.end(), de_var[v].begin(), de_var[v].end());
+        inicio_var_.push_back(aristas_var_.size());
+    }
+}
+
+std::vector<int> PropagacionCreencias::indices_evidencia(
+    const std::unordered_map<std::string,std::string>& evidencia) const{
+    std::vector<int> ev(vars_.size(), -1);
+    for(const auto& kv: evidencia){
+        auto it = std::find_if(vars_.begin(), vars_.end(), [&](const Nodo* X){ return X->nombre==kv.first; });
+        if(it==vars_.end()) throw std::runtime_error("Variable desconocida: "+kv.first);
+        const Nodo* X = *it;
+        auto jt = std::find(X->valores.begin(), X->valores.end(), kv.second);
+        if(jt==X->valores.end()) throw std::runtime_error("Valor desconocido: "+kv.first+"="+kv.second);
+        ev[it-vars_.begin()] = (int)(jt-X->valores.begin());
+    }
+    return ev;
+}
+
+// m_{v->f}(k) = λ_v(k) Π_{g≠f} m_{g->v}(k), con productos prefijo/sufijo
+// para no repetir multiplicaciones cuando la variable tiene muchos factores
+void PropagacionCreencias::actualizar_variable(size_t v, const std::vector<int>& ev,
+                                               Estado& s, Memoria& mem) const{
+    const size_t a0 = inicio_var_[v], na = inicio_var_[v+1]-a0, c = card_[v];
+    const int obs = v<ev.size()? ev[v] : -1;   // las auxiliares nunca se observan
+    std::vector<double>& aux = mem.productos;
+    aux.resize(na+1);
+    for(size_t k=0;k<c;++k){
+        const double lambda = (obs<0 || obs==(int)k)? 1.0 : 0.0;
+        // aux[i] = producto de los mensajes de las aristas anteriores a i
+        aux[0] = lambda;
+        for(size_t i=0;i<na;++i) aux[i+1] = aux[i]*s.fv[desp_[aristas_var_[a0+i]]+k];
+        double suf = 1.0;
+        for(size_t i=na; i-- > 0; ){
+            const uint32_t e = aristas_var_[a0+i];
+            s.vf[desp_[e]+k] = aux[i]*suf;
+            suf *= s.fv[desp_[e]+k];
+        }
+    }
+    for(size_t i=0;i<na;++i) normalizar(&s.vf[desp_[aristas_var_[a0+i]]], c);
+}
+
+// m_{f->u}(x) = Σ_{a: a_u=x} φ(a) Π_{w≠u} m_{w->f}(a_w): un solo recorrido de
+// la tabla calcula los mensajes hacia todas las variables del alcance
+double PropagacionCreencias::actualizar_factor(size_t f, double amortiguacion, Estado& s,
+                                               std::vector<double>& destino,
+                                               Memoria& mem) const{
+    const size_t e0 = primera_[f], m = primera_[f+1]-e0;
+    for(size_t j=0;j<m;++j){
+        const size_t e = e0+j;
+        std::fill(destino.begin()+desp_[e], destino.begin()+desp_[e]+card_[var_de_[e]], 0.0);
+    }
+
+    // odómetro sobre el alcance y productos prefijo de los mensajes entrantes
+    mem.indices.assign(m, 0);
+    mem.productos.resize(m+1);
+    size_t* idx = mem.indices.data();
+    double* pre = mem.productos.data();
+    const double* phi = &tablas_[tabla_[f]];
+    const size_t tam = (f+1<tabla_.size()? tabla_[f+1] : tablas_.size()) - tabla_[f];
+    for(size_t t=0; t<tam; ++t){
+        pre[0] = phi[t];
+        for(size_t j=0;j<m;++j) pre[j+1] = pre[j]*s.vf[desp_[e0+j]+idx[j]];
+        if(phi[t]!=0){
+            double suf = 1.0;
+            for(size_t j=m; j-- > 0; ){
+                const size_t e = e0+j, k = idx[j];
+                destino[desp_[e]+k] += pre[j]*suf;
+                suf *= s.vf[desp_[e]+k];
+            }
+        }
+        // avanzamos el odómetro (la última variable varía más rápido)
+        for(size_t j=m; j-- > 0; ){
+            if(++idx[j] < card_[var_de_[e0+j]]) break;
+            idx[j] = 0;
+        }
+    }
+
+    // normalización, amortiguación y residuo de cada mensaje
+    double maximo = 0;
+    for(size_t j=0;j<m;++j){
+        const size_t e = e0+j, c = card_[var_de_[e]];
+        double* nm = &destino[desp_[e]];
+        const double* viejo = &s.fv[desp_[e]];
+        // hacia una variable de la red el mensaje es una diferencia de
+        // acumuladas >= 0; se quita el redondeo negativo
+        if(var_de_[e] < vars_.size()) for(size_t k=0;k<c;++k) nm[k] = std::max(0.0, nm[k]);
+        normalizar(nm, c);
+        double r = 0;
+        for(size_t k=0;k<c;++k){
+            nm[k] = amortiguacion*viejo[k] + (1.0-amortiguacion)*nm[k];
+            r = std::max(r, std::fabs(nm[k]-viejo[k]));
+        }
+        s.residuo[e] = r;
+        maximo = std::max(maximo, r);
+    }
+    return maximo;
+}
+
+// barridos síncronos: primero todos los mensajes variable->factor, luego
+// todos los factor->variable sobre el buffer `nuevo`, y se intercambian.
+// Cada hilo tiene un rango fijo de variables y otro de factores.
+void PropagacionCreencias::sincrona(const std::vector<int>& ev, const OpcionesLBP& op,
+                                    Estado& s, ResultadoLBP& r) const{
+    const size_t n = card_.size(), nf = tabla_.size();
+    unsigned hilos = op.hilos ? op.hilos : std::max(1u, std::thread::hardware_concurrency());
+    hilos = (unsigned)std::max<size_t>(1, std::min<size_t>(hilos, n));
+
+    Barrera barrera(hilos);
+    std::vector<double> residuo_hilo(hilos, 0.0);
+    bool parar = false;
+
+    auto trabajo = [&](unsigned t){
+        const size_t a = n*t/hilos, b = n*(t+1)/hilos, fa = nf*t/hilos, fb = nf*(t+1)/hilos;
+        Memoria aux;
+        for(;;){
+            for(size_t v=a; v<b; ++v) actualizar_variable(v, ev, s, aux);
+            barrera.esperar([]{});
+            double res = 0;
+            for(size_t f=fa; f<fb; ++f) res = std::max(res, actualizar_factor(f, op.amortiguacion, s, s.nuevo, aux));
+            residuo_hilo[t] = res;
+            // el último hilo en terminar el barrido decide si seguimos
+            barrera.esperar([&]{
+                s.fv.swap(s.nuevo);
+                r.residuo = *std::max_element(residuo_hilo.begin(), residuo_hilo.end());
+                ++r.iteraciones;
+                r.convergio = r.residuo < op.tolerancia;
+                parar = r.convergio || r.iteraciones>=op.max_iter;
+            });
+            if(parar) break;
+        }
+    };
+
+    std::vector<std::thread> th;
+    for(unsigned t=1; t<hilos; ++t) th.emplace_back(trabajo, t);
+    trabajo(0);
+    for(auto& x: th) x.join();
+}
+
+// planificación residual: se aplica el mensaje candidato con mayor
+// cambio y solo se recalculan los candidatos de los factores vecinos
+// de la variable afectada
+void PropagacionCreencias::residual(const std::vector<int>& ev, const OpcionesLBP& op,
+                                    Estado& s, ResultadoLBP& r) const{
+    const size_t n = card_.size(), nf = tabla_.size(), na = factor_de_.size();
+    Memoria aux;
+    std::vector<uint32_t> version(na, 0);
+    using Entrada = std::tuple<double, uint32_t, uint32_t>; // (residuo, arista, versión)
+    std::priority_queue<Entrada> cola;
+
+    auto candidatos = [&](size_t f){
+        actualizar_factor(f, op.amortiguacion, s, s.nuevo, aux);
+        for(size_t e=primera_[f]; e<primera_[f+1]; ++e) cola.emplace(s.residuo[e], (uint32_t)e, ++version[e]);
+    };
+    for(size_t v=0; v<n; ++v) actualizar_variable(v, ev, s, aux);
+    for(size_t f=0; f<nf; ++f) candidatos(f);
+
+    const size_t limite = op.max_iter*na;
+    size_t actualizaciones = 0;
+    r.convergio = true;
+    r.residuo = 0;
+    while(!cola.empty()){
+        double res; uint32_t e, ver;
+        std::tie(res, e, ver) = cola.top();
+        if(ver!=version[e]){ cola.pop(); continue; } // entrada obsoleta
+        r.residuo = res;
+        if(res < op.tolerancia) break;
+        if(actualizaciones>=limite){ r.convergio = false; break; }
+        cola.pop();
+
+        // aplicamos el mensaje f->v y propagamos a los demás factores de v
+        const size_t c = card_[var_de_[e]];
+        std::copy(s.nuevo.begin()+desp_[e], s.nuevo.begin()+desp_[e]+c, s.fv.begin()+desp_[e]);
+        s.residuo[e] = 0;
+        ++version[e];
+        ++actualizaciones;
+        const uint32_t v = var_de_[e];
+        actualizar_variable(v, ev, s, aux);
+        for(size_t i=inicio_var_[v]; i<inicio_var_[v+1]; ++i){
+            const uint32_t g = factor_de_[aristas_var_[i]];
+            if(g!=factor_de_[e]) candidatos(g);
+        }
+    }
+    r.iteraciones = na? (actualizaciones+na-1)/na : 0;
+}
+
+ResultadoLBP PropagacionCreencias::ejecutar(const std::vector<int>& ev, const OpcionesLBP& op) const{
+    if(ev.size()!=vars_.size()) throw std::runtime_error("LBP: evidencia de tamaño incorrecto");
+    if(op.amortiguacion<0 || op.amortiguacion>=1) throw std::runtime_error("LBP: amortiguación fuera de [0,1)");
+
+    // mensajes factor->variable iniciales uniformes
+    Estado s;
+    s.vf.assign(tam_mensajes_, 0.0);
+    s.fv.assign(tam_mensajes_, 0.0);
+    s.nuevo.assign(tam_mensajes_, 0.0);
+    s.residuo.assign(factor_de_.size(), 0.0);
+    for(size_t e=0; e<factor_de_.size(); ++e){
+        const size_t c = card_[var_de_[e]];
+        std::fill(s.fv.begin()+desp_[e], s.fv.begin()+desp_[e]+c, 1.0/c);
+    }
+
+    ResultadoLBP r;
+    if(op.plan==OpcionesLBP::Planificacion::Sincrona) sincrona(ev, op, s, r);
+    else residual(ev, op, s, r);
+
+    // creencias: b_v(k) ∝ λ_v(k) Π_f m_{f->v}(k)
+    r.marginales.resize(vars_.size());
+    for(size_t v=0; v<vars_.size(); ++v){
+        std::vector<double>& b = r.marginales[v];
+        b.assign(card_[v], 1.0);
+        for(size_t k=0;k<card_[v];++k){
+            if(ev[v]>=0 && ev[v]!=(int)k){ b[k] = 0; continue; }
+            for(size_t i=inicio_var_[v]; i<inicio_var_[v+1]; ++i) b[k] *= s.fv[desp_[aristas_var_[i]]+k];
+        }
+        double z = 0;
+        for(double x: b) z += x;
+        if(z==0) throw std::runtime_error("LBP: evidencia con probabilidad 0 ("+vars_[v]->nombre+")");
+        for(double& x: b) x /= z;
+    }
+    return r;
+}
@@ -0,0 +1,93 @@
+#ifndef PROPAGACION_H
+#define PROPAGACION_H
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct RedBayesiana; struct Nodo;
+
+struct OpcionesLBP{
+    enum class Planificacion{ Sincrona, Residual };
+    Planificacion plan = Planificacion::Sincrona;
+    double amortiguacion = 0.0;    // m = a*m_anterior + (1-a)*m_nuevo (0 = sin amortiguar)
+    double tolerancia = 1e-6;      // cambio máximo de un mensaje para declarar convergencia
+    size_t max_iter = 100;         // barridos completos (en residual: actualizaciones / aristas)
+    unsigned hilos = 0;            // hilos del barrido síncrono (0 = hardware_concurrency)
+};
+
+struct ResultadoLBP{
+    std::vector<std::vector<double>> marginales; // marginales[v][k] ≈ P(v=k | e)
+    size_t iteraciones = 0;
+    double residuo = 0;            // cambio máximo en la última iteración
+    bool convergio = false;
+};
+
+// Propagación de creencias con bucles (loopy BP) sobre el grafo de
+// factores de la red: un factor por CPT, conectado a la variable y a sus
+// padres. Es aproximada en redes con ciclos no dirigidos, pero cada
+// iteración cuesta lo mismo que el tamaño de las CPTs, sin importar el
+// ancho de árbol. Un noisy-OR/MAX grande no se expande: se descompone en
+// una estrella de factores pequeños alrededor de una variable auxiliar Y'
+// (ver TablaProbabilidad::factorizar). La estrella es un árbol, así que
+// no agrega bucles; los mensajes hacia y desde Y' pueden ser negativos.
+//
+// La estructura del grafo (alcances, tablas y desplazamientos de los
+// mensajes) se calcula una vez en el constructor; cada ejecución usa dos
+// buffers contiguos, uno por sentido (variable->factor y factor->variable).
+//  - Síncrona: cada barrido actualiza todos los mensajes a partir de los
+//    del barrido anterior; las variables y los factores se reparten entre
+//    hilos y cada uno escribe solo sus propios mensajes.
+//  - Residual: se actualiza primero el mensaje que más cambiaría (cola de
+//    prioridad por residuo). Es secuencial pero suele converger con
+//    muchas menos actualizaciones en redes con bucles.
+class PropagacionCreencias{
+public:
+    explicit PropagacionCreencias(const RedBayesiana& rb);
+
+    // `ev` tiene un índice de valor por variable (-1 = no observada)
+    ResultadoLBP ejecutar(const std::vector<int>& ev, const OpcionesLBP& op) const;
+
+    std::vector<int> indices_evidencia(const std::unordered_map<std::string,std::string>& evidencia) const;
+    const std::vector<Nodo*>& variables() const { return vars_; }
+
+private:
+    std::vector<Nodo*> vars_;                     // orden topológico (índice = Nodo::id)
+    // por variable: las de la red y luego las auxiliares de los noisy descompuestos
+    std::vector<size_t> card_;
+
+    // factor f: aristas [primera_[f], primera_[f+1]) en el orden del alcance
+    // (padres, la variable y la auxiliar); tabla en tablas_[tabla_[f] ...]
+    std::vector<size_t> primera_;
+    std::vector<size_t> tabla_;
+    std::vector<double> tablas_;
+
+    // arista e = (factor, variable): mensaje en [desp_[e], desp_[e]+card)
+    std::vector<uint32_t> factor_de_;
+    std::vector<uint32_t> var_de_;
+    std::vector<size_t> desp_;
+    size_t tam_mensajes_ = 0;
+
+    // aristas de cada variable (CSR)
+    std::vector<size_t> inicio_var_;
+    std::vector<uint32_t> aristas_var_;
+
+    struct Estado;
+    // memoria de trabajo de un hilo (se reutiliza entre llamadas)
+    struct Memoria{
+        std::vector<double> productos;
+        std::vector<size_t> indices;
+    };
+    // mensaje variable->factor de todas las aristas de la variable v
+    void actualizar_variable(size_t v, const std::vector<int>& ev, Estado& s, Memoria& mem) const;
+    // mensajes factor->variable del factor f, escritos en `destino`
+    // (con su residuo por arista); devuelve el cambio máximo respecto a
+    // los mensajes actuales
+    double actualizar_factor(size_t f, double amortiguacion, Estado& s, std::vector<double>& destino,
+                             Memoria& mem) const;
+
+    void sincrona(const std::vector<int>& ev, const OpcionesLBP& op, Estado& s, ResultadoLBP& r) const;
+    void residual(const std::vector<int>& ev, const OpcionesLBP& op, Estado& s, ResultadoLBP& r) const;
+};
+
+#endif // PROPAGACION_H
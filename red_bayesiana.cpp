@@ -4,8 +4,11 @@
 #include "util.h"
 #include <iostream>
 #include <fstream>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_set>
 
 // método auxiliar que obtiene un nodo existente o crea uno nuevo si no existe
 // esto permite construcción incremental de la red durante la carga de archivos
@@ -19,8 +22,11 @@ Nodo* RedBayesiana::obtener_o_crear(const std::string& nombre){
     // la correcta construcción y propiedad exclusiva del puntero.
     // make_unique crea un unique_ptr que gestiona automáticamente
     // la memoria y evita fugas
-    if(it==nodos.end()) 
+    // un nodo nuevo cambia la estructura: el análisis del grafo se recalcula
+    if(it==nodos.end()){
         nodos[nombre] = std::make_unique<Nodo>(nombre);
+        invalidar_grafo();
+    }
     
     // Devolvemos el puntero crudo gestionado por el unique_ptr.
     // Es seguro usar el puntero crudo mientras el mapa `nodos`
@@ -49,49 +55,94 @@ void RedBayesiana::cargar_estructura(const std::string& ruta){
     // si no se puede abrir, lanzamos excepción con mensaje descriptivo
     if(!in) 
         throw std::runtime_error("No se puede abrir estructura: "+ruta);
-    
+    cargar_estructura(in);
+}
+
+// misma carga desde un flujo ya abierto (p. ej. la parte de un archivo
+// que corresponde a una rebanada de una red dinámica)
+void RedBayesiana::cargar_estructura(std::istream& in){
     std::string linea; // buffer para leer cada línea
     int ln=0; // contador de líneas para mensajes de error informativos
     
-    // leemos el archivo línea por línea hasta el final
-    while(std::getline(in, linea)){
-        ++ln; // incrementamos contador de línea
+    // leemos el archivo línea por línea hasta el final, con las
+    // plantillas PLATE ya expandidas
+    LectorPlantillas lector(in);
+    while(lector.siguiente(linea, ln)){
         linea = recortar(linea); // eliminamos espacios al inicio y final
         
         // ignoramos líneas vacías y líneas de comentario (que empiezan con #)
         // esto permite documentar el archivo de estructura
         if(linea.empty()||linea[0]=='#') continue;
         
-        // dividimos la línea usando '-' como delimitador
-        // esperamos obtener dos partes: "padre" y "> hijo"
-        auto partes = dividir(linea, '-');
+        // buscamos la flecha "->" que separa padre e hijo (los nombres
+        // pueden contener '-', como "X(t-1)" en las redes dinámicas)
+        auto flecha = linea.find("->");
         
-        // validamos el formato: debe tener exactamente 2 partes
-        // la segunda parte debe empezar con '>' (formando "->")
-        if(partes.size()!=2 || partes[1].empty() || partes[1][0] != '>')
+        // validamos el formato: una sola flecha con un nombre a cada lado
+        if(flecha==std::string::npos || linea.find("->", flecha+2)!=std::string::npos)
             throw std::runtime_error("Formato inválido en estructura línea "+
                                    std::to_string(ln)+": "+linea);
         
-        // extraemos el nombre del padre (primera parte, antes del '-')
-        std::string padre = recortar(partes[0]);
-        // extraemos el nombre del hijo (segunda parte, después del '>')
-        // usamos substr(1) para saltar el carácter '>'
-        std::string hijo  = recortar(partes[1].substr(1));
+        // extraemos el nombre del padre (antes de la flecha)
+        std::string padre = recortar(linea.substr(0, flecha));
+        // extraemos el nombre del hijo (después de la flecha)
+        std::string hijo  = recortar(linea.substr(flecha+2));
+        if(padre.empty() || hijo.empty())
+            throw std::runtime_error("Formato inválido en estructura línea "+
+                                   std::to_string(ln)+": "+linea);
         
         // Construimos la relación dirigida padre -> hijo en el grafo
         // obtener_o_crear garantiza que ambos nodos existan
         Nodo* u = obtener_o_crear(padre);
         Nodo* v = obtener_o_crear(hijo);
         
-        // Agregamos punteros crudos para establecer la relación bidireccional
-        // el hijo conoce a sus padres (necesario para inferencia)
-        v->padres.push_back(u);
-        // el padre conoce a sus hijos (útil para orden topológico)
-        u->hijos.push_back(v);
+        // Agregamos punteros crudos para establecer la relación bidireccional:
+        // el hijo conoce a sus padres (necesario para inferencia) y el
+        // padre conoce a sus hijos (útil para orden topológico)
+        agregar_arco(u, v);
         
         // Nota: la propiedad de memoria está en el mapa `nodos` con unique_ptr,
         // por lo que no hay fugas de memoria aunque usemos punteros crudos aquí
     }
+    
+    // analizamos el grafo una vez al terminar la carga: así un ciclo se
+    // detecta aquí, con un error, y no en la primera consulta
+    grafo();
+}
+
+// agrega el arco padre -> hijo en ambas listas de adyacencia
+void RedBayesiana::agregar_arco(Nodo* padre, Nodo* hijo){
+    hijo->padres.push_back(padre);
+    padre->hijos.push_back(hijo);
+    invalidar_grafo();
+}
+
+// quita el arco padre -> hijo (si existe) de ambas listas
+void RedBayesiana::quitar_arco(Nodo* padre, Nodo* hijo){
+    auto& hs = padre->hijos;
+    auto& ps = hijo->padres;
+    hs.erase(std::remove(hs.begin(), hs.end(), hijo), hs.end());
+    ps.erase(std::remove(ps.begin(), ps.end(), padre), ps.end());
+    invalidar_grafo();
+}
+
+void RedBayesiana::invalidar_grafo(){
+    std::atomic_store(&analisis_, std::shared_ptr<const AnalisisGrafo>());
+}
+
+// análisis perezoso del grafo. El cálculo escribe Nodo::id, así que se
+// hace una sola vez bajo el cerrojo: los demás hilos esperan y leen el
+// análisis publicado, y la publicación (atomic_store) ordena esas
+// escrituras antes de cualquier lectura que haya pasado por aquí
+const AnalisisGrafo& RedBayesiana::grafo() const{
+    std::shared_ptr<const AnalisisGrafo> a = std::atomic_load(&analisis_);
+    if(a) return *a;
+    std::lock_guard<std::mutex> cerrojo(*calculo_);
+    a = std::atomic_load(&analisis_);
+    if(a) return *a;
+    a = std::make_shared<const AnalisisGrafo>(AnalisisGrafo::calcular(*this));
+    std::atomic_store(&analisis_, a);
+    return *a;
 }
 
 // carga las tablas de probabilidad condicional (CPTs) desde un archivo de texto
@@ -103,218 +154,492 @@ void RedBayesiana::cargar_cpts(const std::string& ruta){
     // si no se puede abrir, lanzamos excepción
     if(!in) 
         throw std::runtime_error("No se puede abrir CPTs: "+ruta);
-    
+    cargar_cpts(in);
+}
+
+namespace {
+
+// Una línea de cpts.txt ya analizada. Los números se convierten aquí una
+// sola vez: las copias de una PLATE reutilizan la línea y solo cambian
+// los nombres (ver renombrar).
+struct LineaCpt{
+    enum class Clase{ Nodo, Valores, Padres, Tabla, Modelo, Gaussiana, Defecto, Fin, Prior, Fila };
+    Clase clase = Clase::Fila;
+    int ln = 0;
+    std::string texto;                  // NODE: nombre; TREE/NOISY-OR/NOISY-MAX: la palabra clave
+    std::vector<std::string> nombres;   // VALUES / PARENTS
+    std::vector<std::pair<std::string,std::string>> asign; // fila: pares (padre, valor)
+    bool sin_dos_puntos = false;        // fila sin ':' (error al aplicarla)
+    bool sin_igual = false;             // fila: algún padre sin '=' (solo vale en NOISY-OR/MAX)
+    bool fuga = false;                  // LEAK: (si no, DEFAULT:)
+    bool con_varianza = false;          // fila "media coef_1 ... coef_k ; varianza"
+    std::vector<double> numeros;        // p:, DEFAULT/LEAK, probabilidades o media y coeficientes
+    double varianza = 0;
+};
+
+// cuerpo de una PLATE analizado una vez: líneas y PLATE internas
+struct ElementoCpt{
+    bool es_plantilla = false;
+    LineaCpt linea;
+    Plantilla plantilla;
+    std::vector<ElementoCpt> cuerpo;    // de la PLATE interna
+    Nodo* primero = nullptr;            // NODE: el nodo de la primera copia
+};
+
+// índices de las PLATE que encierran una línea, de fuera hacia dentro
+using Indices = std::vector<std::pair<const Plantilla*, long>>;
+
+// std::stod solo diría "stod": el error nombra la línea y el texto
+double numero(const std::string& x, int ln){
+    try{ return std::stod(x); }
+    catch(const std::exception&){
+        throw std::runtime_error("Número inválido en línea "+std::to_string(ln)+": "+x);
+    }
+}
+
+std::vector<double> numeros(const std::string& s, int ln){
+    std::vector<double> v;
+    for(auto& x: dividir(s, ' '))
+        if(!x.empty()) v.push_back(numero(x, ln));
+    return v;
+}
+
+LineaCpt analizar_linea(const std::string& t, int ln){
+    using Clase = LineaCpt::Clase;
+    LineaCpt l;
+    l.ln = ln;
+    if(t.rfind("NODE ",0)==0){
+        l.clase = Clase::Nodo;
+        l.texto = recortar(t.substr(5));
+    }
+    // "VALUES: true false" -> ["true", "false"]
+    else if(t.rfind("VALUES:",0)==0){
+        l.clase = Clase::Valores;
+        l.nombres = dividir(recortar(t.substr(7)), ' ');
+    }
+    else if(t.rfind("PARENTS:",0)==0){
+        l.clase = Clase::Padres;
+        for(auto& pn: dividir(recortar(t.substr(8)), ' '))
+            if(!pn.empty()) l.nombres.push_back(pn);
+    }
+    else if(t=="TABLE") l.clase = Clase::Tabla;
+    else if(t=="TREE" || t=="NOISY-OR" || t=="NOISY-MAX"){
+        l.clase = Clase::Modelo;
+        l.texto = t;
+    }
+    else if(t=="GAUSSIAN") l.clase = Clase::Gaussiana;
+    else if(t.rfind("DEFAULT:",0)==0 || t.rfind("LEAK:",0)==0){
+        l.clase = Clase::Defecto;
+        l.fuga = (t[0]=='L');
+        l.numeros = numeros(recortar(t.substr(l.fuga? 5 : 8)), ln);
+    }
+    else if(t=="END") l.clase = Clase::Fin;
+    else if(t.rfind("p:",0)==0){
+        l.clase = Clase::Prior;
+        l.numeros = numeros(recortar(t.substr(2)), ln);
+    }
+    // fila condicional: "Padre1=valor1,Padre2=valor2: prob1 prob2 prob3"
+    else{
+        auto col = t.find(':');
+        if(col==std::string::npos){
+            l.sin_dos_puntos = true;
+            return l;
+        }
+        std::string izq = recortar(t.substr(0,col));
+        std::string der = recortar(t.substr(col+1));
+        // "*" en un TREE es el contexto vacío: coincide con todo; en
+        // NOISY-OR/MAX un padre sin '=' se refiere a todos sus valores activos
+        if(!izq.empty() && izq!="*"){
+            for(auto& kv: dividir(izq, ',')){
+                auto eq = kv.find('=');
+                if(eq==std::string::npos){
+                    l.asign.push_back({recortar(kv), "*"});
+                    l.sin_igual = true;
+                    continue;
+                }
+                l.asign.push_back({recortar(kv.substr(0,eq)), recortar(kv.substr(eq+1))});
+            }
+        }
+        // nodo continuo: "media coef_1 ... coef_k ; varianza"
+        auto pc = der.find(';');
+        if(pc!=std::string::npos){
+            l.con_varianza = true;
+            l.numeros = numeros(recortar(der.substr(0,pc)), ln);
+            l.varianza = numero(recortar(der.substr(pc+1)), ln);
+        }
+        else l.numeros = numeros(der, ln);
+    }
+    return l;
+}
+
+// la línea para unos índices concretos: solo cambian los nombres
+LineaCpt renombrar(const LineaCpt& l, const Indices& ix){
+    auto r = [&](std::string s){
+        for(const auto& p: ix) s = p.first->instanciar(s, p.second);
+        return s;
+    };
+    LineaCpt c = l;
+    c.texto = r(c.texto);
+    for(auto& n: c.nombres) n = r(n);
+    for(auto& a: c.asign){ a.first = r(a.first); a.second = r(a.second); }
+    return c;
+}
+
+std::vector<ElementoCpt> analizar_cuerpo(const Plantilla& p){
+    std::vector<ElementoCpt> r;
+    LectorPlantillas lector(p.cuerpo);
+    std::string l;
+    int ln = 0;
+    Plantilla interna;
+    while(lector.siguiente(l, ln, &interna)){
+        std::string t = recortar(l);
+        if(t.empty()||t[0]=='#') continue;
+        ElementoCpt e;
+        if(t.rfind("PLATE ",0)==0){
+            e.es_plantilla = true;
+            e.plantilla = std::move(interna);
+            e.cuerpo = analizar_cuerpo(e.plantilla);
+        }
+        else{
+            // el cuerpo se analiza una vez para todas las copias
+            try{ e.linea = analizar_linea(t, ln); }
+            catch(const std::runtime_error& ex){
+                throw std::runtime_error(std::string(ex.what())+" (PLATE "+p.var+" de la línea "+
+                                         std::to_string(p.ln)+", todas las copias)");
+            }
+        }
+        r.push_back(std::move(e));
+    }
+    return r;
+}
+
+// copias que genera un cuerpo de PLATE contando las anidadas, acotado
+// para no desbordar (basta con saber si pasa de MAX_COPIAS_PLANTILLA)
+long long copias_anidadas(const std::vector<ElementoCpt>& cuerpo){
+    long long n = 0;
+    for(const ElementoCpt& e: cuerpo)
+        if(e.es_plantilla)
+            n = std::min(n + e.plantilla.num_copias()*(1+copias_anidadas(e.cuerpo)),
+                         (long long)MAX_COPIAS_PLANTILLA+1);
+    return n;
+}
+
+// "i=3, j=2": la copia a la que pertenece una línea, para los errores
+std::string nombre_copia(const Indices& ix){
+    std::string s;
+    for(const auto& p: ix) s += (s.empty()? "" : ", ")+p.first->var+"="+std::to_string(p.second);
+    return s;
+}
+
+// Aplica las líneas de cpts.txt a la red. Las PLATE se analizan una vez y
+// cada copia aplica las mismas líneas renombradas; al finalizar, una copia
+// cuya carga coincide con la de la primera copia toma su representación
+// (y sus arreglos internados) en lugar de construirla otra vez.
+class CargadorCpts{
+public:
+    explicit CargadorCpts(RedBayesiana& rb): rb_(rb) {}
+    void cargar(std::istream& in);
+
+private:
+    RedBayesiana& rb_;
+    Nodo* actual = nullptr;         // puntero al nodo que estamos procesando actualmente
+    std::vector<Nodo*> padres;      // vector de punteros a los padres del nodo actual
+    long instancia = 0;             // copia de PLATE (de primer nivel) que se aplica; 0 = fuera
+    long instancias = 0;
+    long instancia_actual = 0;      // la que abrió `actual`
+    long long copias_plantilla = 0; // ver MAX_COPIAS_PLANTILLA
+    // una copia solo reutiliza si su NODE se abre una vez y todas sus
+    // líneas vienen de la misma copia de la PLATE
+    std::unordered_map<const Nodo*, int> aperturas;
+    std::unordered_set<const Nodo*> mezclados;
+    std::vector<std::pair<Nodo*,Nodo*>> copias; // (copia, nodo de la primera copia)
+
+    void aplicar(const LineaCpt& l, ElementoCpt* origen);
+    void instanciar(std::vector<ElementoCpt>& cuerpo, Indices& ix);
+    void finalizar();
+};
+
+void CargadorCpts::cargar(std::istream& in){
     std::string linea; // buffer para cada línea
     int ln=0; // contador de líneas
-    Nodo* actual=nullptr; // puntero al nodo que estamos procesando actualmente
-    std::vector<Nodo*> padres; // vector de punteros a los padres del nodo actual
+    Plantilla p;
     
-    // leemos el archivo línea por línea
-    while(std::getline(in, linea)){
-        ++ln; // incrementamos el contador de línea
+    // leemos el archivo línea por línea; una PLATE se devuelve sin expandir
+    LectorPlantillas lector(in);
+    while(lector.siguiente(linea, ln, &p)){
         std::string t = recortar(linea); // recortamos espacios
         
         // ignoramos líneas vacías y comentarios
         if(t.empty()||t[0]=='#') continue;
         
-        // procesamos según el tipo de línea que encontremos
-        
-        // --- Línea NODE: inicio de definición de un nodo ---
-        if(t.rfind("NODE ",0)==0){
-            // extraemos el nombre del nodo (todo después de "NODE ")
-            std::string nombre = recortar(t.substr(5));
-            // obtenemos o creamos el nodo
-            actual = obtener_o_crear(nombre); 
-            // limpiamos el vector de padres para este nuevo nodo
-            padres.clear();
-            // creamos la tabla de probabilidad si aún no existe
-            if(!actual->cpt) 
-                actual->cpt = std::make_unique<TablaProbabilidad>();
-        }
-        
-        // --- Línea VALUES: define los posibles valores del nodo ---
-        else if(t.rfind("VALUES:",0)==0){
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("VALUES sin NODE en línea "+std::to_string(ln));
-            // extraemos la parte después de "VALUES:"
-            std::string rest = recortar(t.substr(7)); 
-            // dividimos los valores por espacios y los guardamos
-            // por ejemplo: "VALUES: true false" -> ["true", "false"]
-            actual->valores = dividir(rest, ' ');
+        if(t.rfind("PLATE ",0)==0){
+            // el cuerpo se analiza una vez; cada copia solo renombra
+            std::vector<ElementoCpt> cuerpo = analizar_cuerpo(p);
+            copias_plantilla += p.num_copias()*(1+copias_anidadas(cuerpo));
+            if(copias_plantilla>MAX_COPIAS_PLANTILLA)
+                throw std::runtime_error("Más de "+std::to_string(MAX_COPIAS_PLANTILLA)+
+                                         " copias de PLATE en total, en línea "+std::to_string(p.ln));
+            for(long k=p.desde; k<=p.hasta; ++k){
+                instancia = ++instancias;
+                Indices ix{{&p, k}};
+                instanciar(cuerpo, ix);
+            }
+            instancia = 0;
+            continue;
         }
-        
-        // --- Línea PARENTS: define los padres del nodo ---
-        else if(t.rfind("PARENTS:",0)==0){
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("PARENTS sin NODE en línea "+std::to_string(ln));
-            // extraemos los nombres de los padres
-            std::string rest = recortar(t.substr(8)); 
-            auto nombres = dividir(rest,' '); // dividimos por espacios
-            padres.clear(); // limpiamos el vector de padres
-            // obtenemos o creamos cada nodo padre
-            for(auto &pn: nombres){ 
-                if(pn.empty()) continue; // saltamos strings vacíos
-                padres.push_back(obtener_o_crear(pn)); 
+        aplicar(analizar_linea(t, ln), nullptr);
+    }
+    finalizar();
+}
+
+void CargadorCpts::instanciar(std::vector<ElementoCpt>& cuerpo, Indices& ix){
+    for(ElementoCpt& e: cuerpo){
+        if(!e.es_plantilla){
+            try{ aplicar(renombrar(e.linea, ix), &e); }
+            catch(const std::runtime_error& ex){
+                throw std::runtime_error(std::string(ex.what())+" (copia "+nombre_copia(ix)+")");
             }
+            continue;
         }
-        
-        // --- Línea TABLE: inicio de la tabla de probabilidades ---
-        else if(t=="TABLE"){
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("TABLE sin NODE en línea "+std::to_string(ln));
-            
-            // Llegamos a la sección TABLE: aquí sabemos que las filas
-            // siguientes dependen de los padres declarados anteriormente.
-            // Inicializamos la TablaProbabilidad con la variable objetivo (`actual`)
-            // y el vector `padres` en el orden que fueron declarados.
-            // Esto prepara la estructura interna de la tabla para recibir filas.
-            actual->cpt->establecer(actual, padres);
+        for(long k=e.plantilla.desde; k<=e.plantilla.hasta; ++k){
+            ix.push_back({&e.plantilla, k});
+            instanciar(e.cuerpo, ix);
+            ix.pop_back();
         }
-        
-        // --- Línea END: fin de definición del nodo ---
-        else if(t=="END"){
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("END sin NODE en línea "+std::to_string(ln));
-            
-            // finalizamos la configuración de la CPT del nodo actual
-            // esto asegura que todos los datos estén correctamente establecidos
-            actual->cpt->establecer(actual, padres);
-            
-            // limpiamos las variables para procesar el siguiente nodo
-            actual=nullptr; 
-            padres.clear();
+    }
+}
+
+void CargadorCpts::aplicar(const LineaCpt& l, ElementoCpt* origen){
+    using Clase = LineaCpt::Clase;
+    const int ln = l.ln;
+    if(l.clase!=Clase::Nodo && actual && instancia!=instancia_actual) mezclados.insert(actual);
+    
+    // procesamos según el tipo de línea que encontremos
+    switch(l.clase){
+    
+    // --- Línea NODE: inicio de definición de un nodo ---
+    case Clase::Nodo:
+        // obtenemos o creamos el nodo
+        actual = rb_.obtener_o_crear(l.texto);
+        // limpiamos el vector de padres para este nuevo nodo
+        padres.clear();
+        // creamos la tabla de probabilidad si aún no existe
+        if(!actual->cpt && !actual->gauss) 
+            actual->cpt = std::make_unique<TablaProbabilidad>();
+        ++aperturas[actual];
+        instancia_actual = instancia;
+        // copia de una PLATE: se recuerda el nodo de la primera copia
+        if(origen){
+            if(!origen->primero) origen->primero = actual;
+            else if(origen->primero!=actual) copias.push_back({actual, origen->primero});
         }
+        break;
+    
+    // --- Línea VALUES: define los posibles valores del nodo ---
+    case Clase::Valores:
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("VALUES sin NODE en línea "+std::to_string(ln));
+        actual->valores = l.nombres;
+        break;
+    
+    // --- Línea PARENTS: define los padres del nodo ---
+    case Clase::Padres:
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("PARENTS sin NODE en línea "+std::to_string(ln));
+        padres.clear(); // limpiamos el vector de padres
+        // obtenemos o creamos cada nodo padre
+        for(auto &pn: l.nombres) 
+            padres.push_back(rb_.obtener_o_crear(pn)); 
+        break;
+    
+    // --- Línea TABLE: inicio de la tabla de probabilidades ---
+    case Clase::Tabla:
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("TABLE sin NODE en línea "+std::to_string(ln));
+        if(actual->gauss)
+            throw std::runtime_error("TABLE en un nodo continuo, línea "+std::to_string(ln));
+        
+        // Llegamos a la sección TABLE: aquí sabemos que las filas
+        // siguientes dependen de los padres declarados anteriormente.
+        // Inicializamos la TablaProbabilidad con la variable objetivo (`actual`)
+        // y el vector `padres` en el orden que fueron declarados.
+        // Esto prepara la estructura interna de la tabla para recibir filas.
+        actual->cpt->establecer(actual, padres);
+        actual->cpt->tipo = TablaProbabilidad::Tipo::Tabla;
+        break;
+    
+    // --- Líneas TREE / NOISY-OR / NOISY-MAX: modelos locales compactos ---
+    // TREE: reglas "Padre=v,... : probs" con contexto parcial, se usa la
+    //       primera que coincide ("*" coincide con todo)
+    // NOISY-OR:  "Padre : p" o "Padre=v : p" (probabilidad de activar al hijo)
+    // NOISY-MAX: "Padre=v : p1 ... pr" (distribución del hijo si solo ese padre está activo)
+    case Clase::Modelo:
+        if(!actual) 
+            throw std::runtime_error(l.texto+" sin NODE en línea "+std::to_string(ln));
+        if(actual->gauss)
+            throw std::runtime_error(l.texto+" en un nodo continuo, línea "+std::to_string(ln));
+        actual->cpt->establecer(actual, padres);
+        actual->cpt->tipo = (l.texto=="TREE")? TablaProbabilidad::Tipo::Arbol :
+                            (l.texto=="NOISY-OR")? TablaProbabilidad::Tipo::NoisyOr : 
+                                                   TablaProbabilidad::Tipo::NoisyMax;
+        break;
+    
+    // --- Línea GAUSSIAN: nodo continuo con densidad gaussiana lineal condicional ---
+    // filas "PadreDiscreto=v,... : media coef_1 ... coef_k ; varianza", con un
+    // coeficiente por padre continuo (en el orden de PARENTS); sin contexto
+    // (o "*") la fila vale para las combinaciones que no tengan la suya
+    case Clase::Gaussiana:{
+        if(!actual) 
+            throw std::runtime_error("GAUSSIAN sin NODE en línea "+std::to_string(ln));
+        if(!actual->valores.empty())
+            throw std::runtime_error("Un nodo continuo no lleva VALUES: "+actual->nombre);
+        // TABLE/TREE/NOISY/p:/DEFAULT ya dejaron un modelo discreto
+        const TablaProbabilidad* T = actual->cpt.get();
+        if(T && (T->variable || !T->carga.empty() || !T->carga_defecto.empty()))
+            throw std::runtime_error("GAUSSIAN en un nodo con CPT discreta, línea "+std::to_string(ln));
+        actual->cpt.reset();
+        actual->gauss = std::make_unique<GaussianaCondicional>();
+        actual->gauss->establecer(actual, padres);
+        break;
+    }
+    
+    // --- Líneas DEFAULT: / LEAK: fila por defecto o fuga del noisy ---
+    case Clase::Defecto:{
+        if(!actual) 
+            throw std::runtime_error("DEFAULT/LEAK sin NODE en línea "+std::to_string(ln));
+        if(actual->gauss)
+            throw std::runtime_error("DEFAULT/LEAK en un nodo continuo, línea "+std::to_string(ln));
+        TablaProbabilidad& T = *actual->cpt;
+        bool noisy = (T.tipo==TablaProbabilidad::Tipo::NoisyOr || T.tipo==TablaProbabilidad::Tipo::NoisyMax);
+        if(l.fuga!=noisy) 
+            throw std::runtime_error("LEAK solo en NOISY-OR/MAX y DEFAULT solo en TABLE/TREE, línea "+std::to_string(ln));
+        // una TABLE con DEFAULT pasa a guardar solo sus filas explícitas
+        if(T.tipo==TablaProbabilidad::Tipo::Tabla) T.tipo = TablaProbabilidad::Tipo::PorDefecto;
+        T.carga_defecto = l.numeros;
+        break;
+    }
+    
+    // --- Línea END: fin de definición del nodo ---
+    case Clase::Fin:
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("END sin NODE en línea "+std::to_string(ln));
         
-        // --- Línea p:: probabilidad prior para nodos sin padres ---
-        else if(t.rfind("p:",0)==0){
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("p: sin NODE en línea "+std::to_string(ln));
-            
-            // extraemos los números después de "p:"
-            auto toks = dividir(recortar(t.substr(2)), ' ');
-            
-            // convertimos cada token string a double y lo guardamos
-            std::vector<double> probs; 
-            probs.reserve(toks.size());
-            for(auto &x: toks) 
-                probs.push_back(std::stod(x));
-            
-            // Caso especial: fila `p:` para nodos sin padres (distribución prior)
-            // estos nodos raíz tienen probabilidades incondicionales
-            // establecemos con vector de padres vacío
-            actual->cpt->establecer(actual, {});
-            
-            // creamos un vector vacío de asignaciones de padres
-            std::vector<std::pair<std::string,std::string>> vacio;
-            
-            // agregamos la fila con las probabilidades para cada valor del nodo
-            // como no hay padres, solo hay una fila en la CPT
-            actual->cpt->agregar_fila(vacio, actual->valores, probs);
+        // finalizamos la configuración de la CPT del nodo actual
+        // esto asegura que todos los datos estén correctamente establecidos
+        if(actual->gauss) actual->gauss->establecer(actual, padres);
+        else actual->cpt->establecer(actual, padres);
+        
+        // limpiamos las variables para procesar el siguiente nodo
+        actual=nullptr; 
+        padres.clear();
+        break;
+    
+    // --- Línea p:: probabilidad prior para nodos sin padres ---
+    case Clase::Prior:
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("p: sin NODE en línea "+std::to_string(ln));
+        if(actual->gauss)
+            throw std::runtime_error("p: en un nodo continuo, línea "+std::to_string(ln));
+        
+        // Caso especial: fila `p:` para nodos sin padres (distribución prior)
+        // estos nodos raíz tienen probabilidades incondicionales
+        // establecemos con vector de padres vacío
+        actual->cpt->establecer(actual, {});
+        
+        // como no hay padres, solo hay una fila en la CPT
+        actual->cpt->agregar_fila({}, actual->valores, l.numeros);
+        break;
+    
+    // --- Línea de probabilidad condicional: contiene condiciones y probabilidades ---
+    case Clase::Fila:{
+        // verificamos que estemos procesando un nodo
+        if(!actual) 
+            throw std::runtime_error("Fila sin NODE en línea "+std::to_string(ln));
+        if(l.sin_dos_puntos) 
+            throw std::runtime_error("Falta ':' en línea "+std::to_string(ln));
+        
+        // en NOISY-OR/MAX un padre sin '=' se refiere a todos sus valores activos
+        const bool noisy = actual->cpt && (actual->cpt->tipo==TablaProbabilidad::Tipo::NoisyOr ||
+                                           actual->cpt->tipo==TablaProbabilidad::Tipo::NoisyMax);
+        if(l.sin_igual && !noisy) 
+            throw std::runtime_error("Falta '=' en línea "+std::to_string(ln));
+        
+        // nodo continuo: "media coef_1 ... coef_k ; varianza"
+        if(actual->gauss){
+            if(!l.con_varianza) 
+                throw std::runtime_error("Falta '; varianza' en línea "+std::to_string(ln));
+            actual->gauss->agregar_fila(l.asign, l.numeros, l.varianza);
+            break;
         }
+        if(l.con_varianza)
+            throw std::runtime_error("'; varianza' en un nodo discreto, línea "+std::to_string(ln));
         
-        // --- Línea de probabilidad condicional: contiene condiciones y probabilidades ---
-        else{
-            // verificamos que estemos procesando un nodo
-            if(!actual) 
-                throw std::runtime_error("Fila sin NODE en línea "+std::to_string(ln));
-            
-            // buscamos el separador ':' que divide condiciones de probabilidades
-            // formato: "Padre1=valor1,Padre2=valor2: prob1 prob2 prob3"
-            auto col = t.find(':'); 
-            if(col==std::string::npos) 
-                throw std::runtime_error("Falta ':' en línea "+std::to_string(ln));
-            
-            // izq contiene las condiciones de los padres (antes del ':')
-            std::string izq = recortar(t.substr(0,col));
-            // der contiene las probabilidades (después del ':')
-            std::string der = recortar(t.substr(col+1));
-            
-            // vector que contendrá las asignaciones de los padres
-            // cada par es (nombre_padre, valor)
-            std::vector<std::pair<std::string,std::string>> asign;
-            
-            // procesamos las condiciones de los padres si existen
-            if(!izq.empty()){
-                // dividimos las asignaciones por comas
-                // ej: "A=true,B=false" -> ["A=true", "B=false"]
-                auto pares = dividir(izq, ',');
-                
-                // procesamos cada par variable=valor
-                for(auto &kv: pares){
-                    // buscamos el '=' en cada par
-                    auto eq = kv.find('='); 
-                    if(eq==std::string::npos) 
-                        throw std::runtime_error("Falta '=' en línea "+std::to_string(ln));
-                    
-                    // extraemos nombre de variable (antes del '=')
-                    std::string k = recortar(kv.substr(0,eq)); 
-                    // extraemos valor (después del '=')
-                    std::string v = recortar(kv.substr(eq+1));
-                    
-                    // guardamos el par (variable, valor)
-                    asign.push_back({k,v});
-                }
-            }
-            
-            // parseamos las probabilidades desde la parte derecha
-            auto toks = dividir(der, ' ');
-            std::vector<double> probs; 
-            for(auto &x: toks) 
-                if(!x.empty()) // ignoramos tokens vacíos
-                    probs.push_back(std::stod(x));
-            
-            // Añadimos la fila a la tabla de probabilidad condicional
-            // asign especifica la combinación de valores de los padres
-            // probs contiene las probabilidades para cada valor del nodo actual
-            // dada esa combinación de valores de padres
-            // Ejemplo: si asign = [(A,true), (B,false)] y el nodo tiene valores [v1,v2,v3]
-            // entonces probs = [P(v1|A=true,B=false), P(v2|A=true,B=false), P(v3|A=true,B=false)]
-            actual->cpt->agregar_fila(asign, actual->valores, probs);
+        // Añadimos la fila a la tabla de probabilidad condicional
+        // asign especifica la combinación de valores de los padres
+        // numeros contiene las probabilidades para cada valor del nodo actual
+        // dada esa combinación de valores de padres
+        // Ejemplo: si asign = [(A,true), (B,false)] y el nodo tiene valores [v1,v2,v3]
+        // entonces numeros = [P(v1|A=true,B=false), P(v2|A=true,B=false), P(v3|A=true,B=false)]
+        actual->cpt->agregar_fila(l.asign, actual->valores, l.numeros);
+        break;
+    }
+    }
+}
+
+// al terminar de leer el archivo, todas las CPTs están cargadas y ya
+// se conocen los dominios de todos los padres: pasamos cada tabla a su
+// representación final (densa o compacta), que es la que usan los
+// motores de inferencia
+void CargadorCpts::finalizar(){
+    // copias de PLATE que toman la representación de su primera copia;
+    // se decide antes de finalizar nada, porque finalizar() vacía la carga
+    auto sin_mezcla = [&](const Nodo* X){
+        return aperturas[X]==1 && !mezclados.count(X) && X->cpt && X->cpt->variable;
+    };
+    std::vector<std::pair<Nodo*,Nodo*>> reutilizan;
+    std::unordered_set<const Nodo*> reutiliza;
+    for(const auto& c: copias)
+        if(sin_mezcla(c.first) && sin_mezcla(c.second) && c.first->cpt->misma_carga(*c.second->cpt)){
+            reutilizan.push_back(c);
+            reutiliza.insert(c.first);
         }
+    auto comprobar_padres = [](const Nodo* X){
+        for(const Nodo* p: X->cpt->padres)
+            if(p->gauss)
+                throw std::runtime_error("El nodo discreto "+X->nombre+" no puede tener un padre continuo: "+p->nombre);
+    };
+    for(auto &kv: rb_.nodos){
+        Nodo* X = kv.second.get();
+        if(X->gauss){ X->gauss->finalizar(); continue; }
+        if(X->cpt && X->cpt->variable && !reutiliza.count(X)){
+            comprobar_padres(X);
+            X->cpt->finalizar();
+        }
+    }
+    for(const auto& c: reutilizan){
+        comprobar_padres(c.first);
+        c.first->cpt->copiar_representacion(*c.second->cpt);
     }
-    // al terminar de leer el archivo, todas las CPTs están cargadas
+}
+
+} // namespace
+
+void RedBayesiana::cargar_cpts(std::istream& in){
+    CargadorCpts(*this).cargar(in);
+    // los padres de las CPTs también cuentan en el análisis del grafo
+    invalidar_grafo();
 }
 
 // imprime la estructura de la red en orden topológico
 // muestra cada nodo con sus predecesores (padres) de forma legible
 void RedBayesiana::imprimir_estructura(std::ostream& os) const{
-    // calculamos el orden topológico para imprimir en orden lógico
-    // usamos el mismo algoritmo de Kahn que en la inferencia
-    
-    // mapa de grados de entrada (número de padres no procesados)
-    std::unordered_map<Nodo*,int> indeg; 
-    // cola de nodos listos para procesar (sin padres pendientes)
-    std::queue<Nodo*> q; 
-    // vector resultado con el orden topológico
-    std::vector<Nodo*> topo;
-    
-    // inicializamos los grados de entrada de todos los nodos
-    for(auto &kv: nodos){ 
-        auto* n = kv.second.get(); 
-        // el grado de entrada es el número de padres
-        indeg[n]=(int)n->padres.size(); 
-        // si no tiene padres, puede procesarse inmediatamente
-        if(indeg[n]==0) q.push(n);
-    } 
-    
-    // procesamos nodos en orden topológico
-    while(!q.empty()){ 
-        // extraemos el siguiente nodo sin padres pendientes
-        auto* u=q.front(); 
-        q.pop(); 
-        // lo agregamos al resultado
-        topo.push_back(u); 
-        // decrementamos el grado de entrada de sus hijos
-        for(auto* v: u->hijos){ 
-            // si un hijo llega a grado 0, lo encolamos
-            if(--indeg[v]==0) q.push(v);
-        } 
-    }
+    // el orden topológico viene del análisis del grafo (calculado una vez)
+    const std::vector<Nodo*>& topo = grafo().orden;
     
     // imprimimos encabezado
     os << "Estructura (predecesores):\n";
@@ -342,36 +667,16 @@ void RedBayesiana::imprimir_estructura(std::ostream& os) const{
 // imprime las tablas de probabilidad condicional de todos los nodos
 // las imprime en orden topológico para facilitar la lectura
 void RedBayesiana::imprimir_cpts(std::ostream& os) const{
-    // calculamos orden topológico (mismo algoritmo que en imprimir_estructura)
-    // lo hacemos de nuevo porque este método es independiente
-    
-    // estructuras para el algoritmo de Kahn
-    std::unordered_map<Nodo*,int> indeg; 
-    std::queue<Nodo*> q; 
-    std::vector<Nodo*> topo;
-    
-    // inicializamos grados de entrada
-    for(auto &kv: nodos){ 
-        auto* n = kv.second.get(); 
-        indeg[n]=(int)n->padres.size(); 
-        if(indeg[n]==0) q.push(n);
-    } 
-    
-    // calculamos el orden topológico
-    while(!q.empty()){ 
-        auto* u=q.front(); 
-        q.pop(); 
-        topo.push_back(u); 
-        for(auto* v: u->hijos){ 
-            if(--indeg[v]==0) q.push(v);
-        } 
-    }
+    // mismo orden topológico que imprimir_estructura (análisis en caché)
+    const std::vector<Nodo*>& topo = grafo().orden;
     
     // imprimimos la CPT de cada nodo en orden topológico
     for(auto* n: topo){ 
-        // solo imprimimos si el nodo tiene una CPT definida
+        // solo imprimimos si el nodo tiene una CPT (o densidad) definida
         if(n->cpt) 
             n->cpt->imprimir(os); 
+        else if(n->gauss)
+            n->gauss->imprimir(os);
         // agregamos línea en blanco para separar visualmente las CPTs
         os << "\n"; 
     }
@@ -3,10 +3,13 @@
 
 // incluir nodo.h (ahora con tabla_probabilidad.h disponible)
 #include "nodo.h"
+#include "grafo.h"
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include <istream>
 #include <ostream>
 
 struct RedBayesiana{
@@ -18,11 +21,32 @@ struct RedBayesiana{
     // Devuelve nullptr si no existe.
     Nodo* obtener(const std::string& nombre) const;
 
+    // Modifican la estructura manteniendo padres/hijos coherentes e
+    // invalidan el análisis del grafo. Quien toque Nodo::padres/hijos o
+    // los padres de una CPT directamente debe llamar a invalidar_grafo().
+    void agregar_arco(Nodo* padre, Nodo* hijo);
+    void quitar_arco(Nodo* padre, Nodo* hijo);
+    void invalidar_grafo();
+
+    // Análisis del grafo (orden topológico, ancestros, descendientes, manto
+    // de Markov, grafo moral). Se calcula al primer uso y se reutiliza
+    // hasta el siguiente cambio de estructura; asigna Nodo::id. Lanza si
+    // el grafo tiene un ciclo. Es seguro llamarlo desde varios hilos
+    // mientras nadie modifique la red.
+    const AnalisisGrafo& grafo() const;
+
     void cargar_estructura(const std::string& ruta);
     void cargar_cpts(const std::string& ruta);
+    void cargar_estructura(std::istream& in);
+    void cargar_cpts(std::istream& in);
 
     void imprimir_estructura(std::ostream& os) const;
     void imprimir_cpts(std::ostream& os) const;
+
+private:
+    mutable std::shared_ptr<const AnalisisGrafo> analisis_;
+    // serializa el cálculo del análisis (y la escritura de Nodo::id)
+    std::unique_ptr<std::mutex> calculo_ = std::make_unique<std::mutex>();
 };
 
 #endif // RED_BAYESIANA_H
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "servicio.h"
+#include <algorithm>
+
+const char* nombre_estado(EstadoConsulta e){
+    switch(e){
+    case EstadoConsulta::Exacta:     return "exacta";
+    case EstadoConsulta::Aproximada: return "aproximada";
+    case EstadoConsulta::Plazo:      return "plazo agotado";
+    case EstadoConsulta::Cancelada:  return "cancelada";
+    default:                         return "error";
+    }
+}
+
+ServicioConsultas::ServicioConsultas(const ModeloVivo& modelo, unsigned hilos)
+    : modelo_(modelo){
+    if(hilos==0) hilos = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned t=0;t<hilos;++t) trabajadores_.emplace_back([this]{
+        for(;;){
+            std::function<void()> tarea;
+            {
+                std::unique_lock<std::mutex> lk(mutex_);
+                hay_trabajo_.wait(lk, [this]{ return parar_ || !cola_.empty(); });
+                if(cola_.empty()) return; // parar_ y nada pendiente
+                tarea = std::move(cola_.front());
+                cola_.pop_front();
+            }
+            tarea();
+        }
+    });
+}
+
+ServicioConsultas::~ServicioConsultas(){
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        parar_ = true;
+    }
+    hay_trabajo_.notify_all();
+    for(auto& t: trabajadores_) t.join();
+}
+
+ConsultaEnCurso ServicioConsultas::enviar(const std::string& variable,
+                                          const std::unordered_map<std::string,std::string>& evidencia,
+                                          const OpcionesConsulta& op){
+    using reloj = std::chrono::steady_clock;
+    const auto inicio = reloj::now();
+    auto cancelada = std::make_shared<std::atomic<bool>>(false);
+    LimiteConsulta limite;
+    limite.cancelada = cancelada.get();
+    auto plazo = reloj::time_point::max();
+    if(op.plazo.count()>0){
+        plazo = inicio + op.plazo;
+        limite.plazo = plazo;
+        if(op.respaldo)
+            limite.plazo = inicio + std::chrono::duration_cast<reloj::duration>(op.plazo*(1.0-op.reserva_respaldo));
+    }
+
+    // packaged_task no es copiable y std::function exige copia: se comparte
+    auto tarea = std::make_shared<std::packaged_task<ResultadoConsulta()>>(
+        [this, variable, evidencia, op, limite, plazo, cancelada, inicio]{
+        ResultadoConsulta r;
+        std::shared_ptr<const Instantanea> m = modelo_.instantanea();
+        if(!m){
+            r.mensaje = "no hay ningún modelo publicado";
+            return r;
+        }
+        r.version = m->version;
+        try{
+            r.distribucion = m->motor.consultar_enumeracion(variable, evidencia, nullptr, &limite);
+            r.estado = EstadoConsulta::Exacta;
+        }catch(const ConsultaInterrumpida& ex){
+            r.mensaje = ex.what();
+            if(!ex.por_plazo) r.estado = EstadoConsulta::Cancelada;
+            else if(!op.respaldo) r.estado = EstadoConsulta::Plazo;
+            else{
+                // la mejor respuesta disponible: una estimación de coste acotado
+                try{
+                    OpcionesMuestreo om;
+                    om.adaptativo = false;
+                    om.muestras = op.muestras_respaldo;
+                    om.hilos = 1;
+                    om.plazo = plazo;
+                    ResultadoMuestreo e = m->muestreo().consultar(variable, evidencia, om);
+                    r.distribucion = std::move(e.distribucion);
+                    r.error_estandar = std::move(e.error_estandar);
+                    r.estado = EstadoConsulta::Aproximada;
+                }catch(const std::exception& ex2){
+                    r.estado = EstadoConsulta::Plazo;
+                    r.mensaje += std::string("; respaldo: ") + ex2.what();
+                }
+            }
+        }catch(const std::exception& ex){
+            r.estado = EstadoConsulta::Error;
+            r.mensaje = ex.what();
+        }
+        r.segundos = std::chrono::duration<double>(reloj::now()-inicio).count();
+        return r;
+    });
+
+    ConsultaEnCurso c{tarea->get_future(), cancelada};
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        cola_.emplace_back([tarea]{ (*tarea)(); });
+    }
+    hay_trabajo_.notify_one();
+    return c;
+}
@@ -0,0 +1,85 @@
+#ifndef SERVICIO_H
+#define SERVICIO_H
+#include "modelo_vivo.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class EstadoConsulta{
+    Exacta,      // enumeración completa
+    Aproximada,  // venció el plazo: estimación por ponderación por verosimilitud
+    Plazo,       // venció el plazo y no se pidió respaldo
+    Cancelada,
+    Error        // `mensaje` explica el fallo (variable desconocida, P(e)=0, ...)
+};
+
+struct OpcionesConsulta{
+    std::chrono::milliseconds plazo{0}; // desde el envío, cola incluida (0 = sin plazo)
+    bool respaldo = true;               // al vencer el plazo, estimar por muestreo (LW)
+    double reserva_respaldo = 0.25;     // fracción final del plazo reservada al respaldo
+    size_t muestras_respaldo = 20000;   // máximo de muestras del respaldo (un solo hilo)
+};
+
+struct ResultadoConsulta{
+    EstadoConsulta estado = EstadoConsulta::Error;
+    std::vector<std::pair<std::string,double>> distribucion;
+    std::vector<double> error_estandar; // solo en Aproximada
+    std::string mensaje;
+    double segundos = 0;                // desde el envío hasta la respuesta
+    uint64_t version = 0;               // versión del modelo que la respondió
+};
+
+const char* nombre_estado(EstadoConsulta e);
+
+// Consulta enviada: el resultado llega por el future y cancelar() pide
+// que se abandone (si aún está en cola no llega a ejecutarse).
+struct ConsultaEnCurso{
+    std::future<ResultadoConsulta> resultado;
+    std::shared_ptr<std::atomic<bool>> cancelada;
+    void cancelar() { cancelada->store(true, std::memory_order_relaxed); }
+};
+
+// Servicio de consultas asíncronas sobre un ModeloVivo. enviar() no
+// bloquea: la consulta entra en una cola que atienden `hilos`
+// trabajadores. Cada consulta toma la instantánea vigente al empezar y
+// termina sobre ella aunque entretanto se publique otra. El plazo y la
+// cancelación se comprueban dentro de la enumeración (LimiteConsulta).
+// Con respaldo, la enumeración exacta dispone del plazo menos
+// `reserva_respaldo`; si no termina, el resto se usa para estimar por
+// ponderación por verosimilitud, que se corta al llegar al plazo. Sin
+// respaldo la enumeración usa todo el plazo y se responde con estado Plazo.
+//
+// El modelo debe vivir más que el servicio. El destructor atiende las
+// consultas pendientes y espera a los trabajadores.
+class ServicioConsultas{
+public:
+    explicit ServicioConsultas(const ModeloVivo& modelo, unsigned hilos = 0);
+    ~ServicioConsultas();
+    ServicioConsultas(const ServicioConsultas&) = delete;
+    ServicioConsultas& operator=(const ServicioConsultas&) = delete;
+
+    ConsultaEnCurso enviar(const std::string& variable,
+                           const std::unordered_map<std::string,std::string>& evidencia,
+                           const OpcionesConsulta& op = {});
+
+    size_t hilos() const { return trabajadores_.size(); }
+
+private:
+    const ModeloVivo& modelo_;
+    std::mutex mutex_;
+    std::condition_variable hay_trabajo_;
+    std::deque<std::function<void()>> cola_;
+    bool parar_ = false;
+    std::vector<std::thread> trabajadores_;
+};
+
+#endif // SERVICIO_H
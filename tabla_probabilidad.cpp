@@ -1,8 +1,10 @@
 #include "tabla_probabilidad.h"
 #include "nodo.h"
-#include "util.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <sstream>
 #include <stdexcept>
 
 // establece la configuración básica de la tabla de probabilidad condicional
@@ -34,7 +36,9 @@ void TablaProbabilidad::agregar_fila(
 
     // validación: el número de probabilidades debe coincidir con el número de valores
     // si la variable tiene 3 valores posibles, necesitamos exactamente 3 probabilidades
-    if(probabilidades.size()!=valores_var.size()) 
+    // (en NOISY-OR cada fila da un solo número: la probabilidad de activar al hijo)
+    const size_t esperadas = (tipo==Tipo::NoisyOr)? 1 : valores_var.size();
+    if(probabilidades.size()!=esperadas) 
         throw std::runtime_error("#probs != #valores en agregar_fila()");
     
     // verificamos que las probabilidades sumen aproximadamente 1.0
@@ -51,20 +55,488 @@ void TablaProbabilidad::agregar_fila(
         // std::cerr << "[AVISO] La fila no normaliza a 1: " << suma << " ";
     }
     
-    // agregamos una entrada en la tabla para cada valor posible de la variable
-    // cada entrada mapea (asignación_padres + variable=valor) -> probabilidad
-    for(size_t i=0;i<valores_var.size();++i){
-        // copiamos las asignaciones de los padres
-        auto todo = asig_padres;
-        // agregamos la asignación de la variable objetivo con su valor específico
-        todo.push_back({variable->nombre, valores_var[i]});
+    // guardamos la fila tal cual: los dominios de los padres pueden no
+    // conocerse todavía (se declaran más adelante en el archivo), así que
+    // la conversión a índices se hace en finalizar()
+    carga.push_back({asig_padres, probabilidades});
+}
+
+// posición de un padre dentro de `padres` a partir de su nombre
+size_t TablaProbabilidad::indice_padre(const std::string& nombre) const{
+    for(size_t k=0;k<padres.size();++k) 
+        if(padres[k]->nombre==nombre) return k;
+    throw std::runtime_error("CPT de " + variable->nombre + ": " + nombre + " no es padre");
+}
+
+// índice de un valor dentro del dominio de X
+size_t TablaProbabilidad::indice_valor(const Nodo* X, const std::string& valor) const{
+    for(size_t j=0;j<X->valores.size();++j) 
+        if(X->valores[j]==valor) return j;
+    throw std::runtime_error("Valor desconocido en CPT de " + variable->nombre + ": " + X->nombre + "=" + valor);
+}
+
+// convierte las filas leídas en la representación del tipo de la tabla
+// se llama al terminar la carga, cuando ya se conocen los dominios de
+// todos los padres (pueden declararse después que el hijo en el archivo)
+void TablaProbabilidad::finalizar(){
+    // si ya está lista y no hay filas nuevas, no hay nada que hacer
+    if(finalizada() && carga.empty() && carga_defecto.empty()) return;
+    
+    const size_t r = variable->valores.size();
+    if(r==0) 
+        throw std::runtime_error("Variable sin VALUES: " + variable->nombre);
+    
+    // número de combinaciones de padres; las representaciones compactas
+    // nunca reservan filas*columnas, pero el índice de fila debe caber
+    cards.clear();
+    filas = 1;
+    for(Nodo* p: padres){
+        if(p->valores.empty()) 
+            throw std::runtime_error("Padre sin VALUES: " + p->nombre + " en CPT de " + variable->nombre);
+        if(filas > SIZE_MAX / p->valores.size()) 
+            throw std::runtime_error("Demasiadas combinaciones de padres en CPT de " + variable->nombre);
+        cards.push_back(p->valores.size());
+        filas *= p->valores.size();
+    }
+    columnas = r;
+    std::vector<double> d;
+    datos.clear(); filas_explicitas.clear(); defecto.clear();
+    precision = Precision::Doble; datos_simple.clear(); datos_log16.clear(); paso_log = 0;
+    reglas.clear(); acumuladas.clear(); fuga.clear();
+    
+    // paso de cada padre en el índice de fila
+    std::vector<size_t> paso(padres.size(), 1);
+    for(size_t k=padres.size(); k-- > 1; ) paso[k-1] = paso[k]*cards[k];
+    
+    // índice de fila de una asignación completa de los padres
+    auto fila_de = [&](const FilaCarga& f){
+        std::vector<bool> visto(padres.size(), false);
+        size_t fila = 0;
+        for(const auto& kv: f.contexto){
+            size_t k = indice_padre(kv.first);
+            visto[k] = true;
+            fila += indice_valor(padres[k], kv.second)*paso[k];
+        }
+        for(size_t k=0;k<padres.size();++k) 
+            if(!visto[k]) 
+                throw std::runtime_error("Fila incompleta en CPT de " + variable->nombre + ": falta " + padres[k]->nombre);
+        return fila;
+    };
+    // fila por defecto (DEFAULT:), del mismo tamaño que las demás
+    auto fila_defecto = [&](){
+        if(!carga_defecto.empty() && carga_defecto.size()!=r) 
+            throw std::runtime_error("#probs != #valores en DEFAULT de " + variable->nombre);
+        defecto = carga_defecto;
+    };
+    
+    switch(tipo){
+    case Tipo::Tabla:
+        // las entradas que no aparecen en el archivo quedan como NAN
+        d.assign(filas*r, NAN);
+        for(const FilaCarga& f: carga){
+            size_t fila = fila_de(f);
+            for(size_t j=0;j<r;++j) d[fila*r+j] = f.probs[j];
+        }
+        break;
+        
+    case Tipo::PorDefecto:
+        // solo las filas escritas; el resto comparte la fila por defecto
+        for(const FilaCarga& f: carga){
+            filas_explicitas[fila_de(f)] = d.size()/r;
+            d.insert(d.end(), f.probs.begin(), f.probs.end());
+        }
+        fila_defecto();
+        break;
+        
+    case Tipo::Arbol:
+        // cada regla es una hoja del árbol: contexto parcial -> distribución
+        for(const FilaCarga& f: carga){
+            Regla g;
+            for(const auto& kv: f.contexto){
+                size_t k = indice_padre(kv.first);
+                g.contexto.push_back({k, indice_valor(padres[k], kv.second)});
+            }
+            g.fila = d.size()/r;
+            d.insert(d.end(), f.probs.begin(), f.probs.end());
+            reglas.push_back(std::move(g));
+        }
+        preparar_reglas();
+        fila_defecto();
+        break;
         
-        // empaquetamos la clave completa como string y guardamos la probabilidad
-        // empaquetar_clave convierte el vector de pares en un string único
-        // que sirve como clave en el unordered_map
-        // Ejemplo: [(A,true), (B,false), (C,v1)] -> "A=true,B=false,C=v1"
-        tabla[empaquetar_clave(todo)] = probabilidades[i];
+    case Tipo::NoisyOr:
+    case Tipo::NoisyMax:{
+        if(tipo==Tipo::NoisyOr && r!=2) 
+            throw std::runtime_error("NOISY-OR requiere una variable binaria: " + variable->nombre);
+        // distribución de una fila -> acumulada P(Y<=y); en NOISY-OR la
+        // fila es la probabilidad p de activar al hijo: (1-p, p)
+        auto acumular = [&](const std::vector<double>& p, std::vector<double>::iterator destino){
+            std::vector<double> d = (tipo==Tipo::NoisyOr)? std::vector<double>{1.0-p[0], p[0]} : p;
+            if(d.size()!=r) 
+                throw std::runtime_error("#probs != #valores en CPT de " + variable->nombre);
+            double s = 0;
+            for(size_t y=0;y<r;++y){ s += d[y]; destino[y] = s; }
+            destino[r-1] = 1.0;
+        };
+        // un padre sin parámetros no tiene efecto: acumulada 1 en todos los grados
+        for(size_t k=0;k<padres.size();++k) 
+            acumuladas.push_back(std::vector<double>(cards[k]*r, 1.0));
+        for(const FilaCarga& f: carga){
+            if(f.contexto.size()!=1) 
+                throw std::runtime_error("NOISY: cada fila debe nombrar un solo padre en CPT de " + variable->nombre);
+            size_t k = indice_padre(f.contexto[0].first);
+            const std::string& v = f.contexto[0].second;
+            // "*": el mismo parámetro para todos los valores activos del padre
+            size_t j0 = 1, j1 = cards[k];
+            if(v!="*"){
+                j0 = indice_valor(padres[k], v); j1 = j0+1;
+                if(j0==0) 
+                    throw std::runtime_error("NOISY: " + padres[k]->nombre + "=" + v + " es el valor inactivo");
+            }
+            for(size_t j=j0;j<j1;++j) acumular(f.probs, acumuladas[k].begin()+j*r);
+        }
+        // sin LEAK el hijo queda en su primer valor si no hay padres activos
+        fuga.assign(r, 1.0);
+        if(!carga_defecto.empty()) acumular(carga_defecto, fuga.begin());
+        break;
+    }
     }
+    
+    // se interna al final: si otra tabla tiene los mismos números, esta
+    // comparte su copia y `d` se libera
+    datos = std::move(d);
+    // las filas de carga ya no se necesitan
+    carga.clear();
+    carga_defecto.clear();
+}
+
+bool TablaProbabilidad::misma_carga(const TablaProbabilidad& otra) const{
+    if(!variable || !otra.variable || tipo!=otra.tipo || variable->valores!=otra.variable->valores) return false;
+    if(padres.size()!=otra.padres.size() || carga.size()!=otra.carga.size() || carga_defecto!=otra.carga_defecto)
+        return false;
+    for(size_t k=0;k<padres.size();++k)
+        if(padres[k]->valores!=otra.padres[k]->valores) return false;
+    // posición del padre nombrado (padres.size() si no es padre)
+    auto posicion = [](const TablaProbabilidad& T, const std::string& nombre){
+        size_t k = 0;
+        while(k<T.padres.size() && T.padres[k]->nombre!=nombre) ++k;
+        return k;
+    };
+    for(size_t i=0;i<carga.size();++i){
+        const FilaCarga& a = carga[i];
+        const FilaCarga& b = otra.carga[i];
+        if(a.probs!=b.probs || a.contexto.size()!=b.contexto.size()) return false;
+        for(size_t j=0;j<a.contexto.size();++j){
+            size_t k = posicion(*this, a.contexto[j].first);
+            if(k==padres.size() || k!=posicion(otra, b.contexto[j].first) ||
+               a.contexto[j].second!=b.contexto[j].second) return false;
+        }
+    }
+    return true;
+}
+
+void TablaProbabilidad::copiar_representacion(const TablaProbabilidad& otra){
+    tipo = otra.tipo;
+    datos = otra.datos;
+    precision = otra.precision;
+    datos_simple = otra.datos_simple;
+    datos_log16 = otra.datos_log16;
+    paso_log = otra.paso_log;
+    columnas = otra.columnas;
+    filas = otra.filas;
+    cards = otra.cards;
+    filas_explicitas = otra.filas_explicitas;
+    defecto = otra.defecto;
+    reglas = otra.reglas;
+    acumuladas = otra.acumuladas;
+    fuga = otra.fuga;
+    carga.clear();
+    carga_defecto.clear();
+}
+
+void TablaProbabilidad::preparar_reglas(){
+    // paso de cada padre en el índice de fila (el último es el menos significativo)
+    std::vector<size_t> paso(cards.size(), 1);
+    for(size_t k=cards.size(); k-- > 1; ) paso[k-1] = paso[k]*cards[k];
+    for(Regla& g: reglas){
+        g.condiciones.clear();
+        for(const auto& c: g.contexto) g.condiciones.push_back({paso[c.first], cards[c.first], c.second});
+    }
+}
+
+// probabilidad de las representaciones compactas: se calcula al vuelo a
+// partir de los índices de los padres codificados en `fila`
+double TablaProbabilidad::prob_compacta(size_t fila, size_t valor) const{
+    switch(tipo){
+    case Tipo::PorDefecto:{
+        auto it = filas_explicitas.find(fila);
+        if(it!=filas_explicitas.end()) return dato(it->second*columnas+valor);
+        return defecto.empty()? NAN : defecto[valor];
+    }
+    case Tipo::Arbol:{
+        // la primera regla cuyo contexto coincide decide la distribución
+        for(const Regla& g: reglas){
+            bool coincide = true;
+            for(const Regla::Condicion& c: g.condiciones) 
+                if((fila/c.paso)%c.card!=c.valor){ coincide = false; break; }
+            if(coincide) return dato(g.fila*columnas+valor);
+        }
+        return defecto.empty()? NAN : defecto[valor];
+    }
+    case Tipo::NoisyOr:
+    case Tipo::NoisyMax:{
+        // P(Y<=y | pa) = fuga(y) * Π_{k activo} C_k(y | pa_k)
+        // y P(Y=y | pa) = P(Y<=y | pa) - P(Y<=y-1 | pa)
+        double F = fuga[valor], F_ant = valor? fuga[valor-1] : 0.0;
+        for(size_t k=cards.size(); k-- > 0; ){
+            size_t j = fila%cards[k]; 
+            fila /= cards[k];
+            if(j==0) continue; // padre inactivo
+            const double* c = &acumuladas[k][j*columnas];
+            F *= c[valor];
+            if(valor) F_ant *= c[valor-1];
+        }
+        return std::max(0.0, F-F_ant);
+    }
+    default:
+        return dato(fila*columnas+valor);
+    }
+}
+
+double TablaProbabilidad::entradas_densas() const{
+    double n = (double)columnas;
+    for(size_t c: cards) n *= (double)c;
+    return n;
+}
+
+void TablaProbabilidad::exigir_densa(const std::string& motor) const{
+    const double n = entradas_densas();
+    if(n <= MAX_ENTRADAS_DENSAS) return;
+    std::ostringstream os;
+    os << motor<<" necesita la CPT completa de "<<variable->nombre<<": "<<n
+       << " entradas (máximo "<<MAX_ENTRADAS_DENSAS<<")";
+    if(tipo==Tipo::NoisyOr || tipo==Tipo::NoisyMax) os << "; CONSULTAR, CONSULTAR_VE y LBP la descomponen";
+    throw std::runtime_error(os.str());
+}
+
+// número de probabilidades almacenadas por la representación
+size_t TablaProbabilidad::num_parametros() const{
+    if(tipo==Tipo::NoisyOr || tipo==Tipo::NoisyMax){
+        size_t n = columnas; // fuga
+        for(size_t c: cards) n += (c-1)*columnas;
+        return n;
+    }
+    return num_datos() + defecto.size();
+}
+
+size_t TablaProbabilidad::num_datos() const{
+    switch(precision){
+    case Precision::Simple: return datos_simple.size();
+    case Precision::Log16:  return datos_log16.size();
+    default:                return datos.size();
+    }
+}
+
+double TablaProbabilidad::decodificar_log16(uint16_t c) const{
+    if(c==LOG16_CERO) return 0.0;
+    if(c==LOG16_NAN) return NAN;
+    return std::exp(-(double)c*paso_log);
+}
+
+// Log16 guarda -ln p en pasos uniformes: el paso se elige para que el
+// menor p>0 de la tabla caiga en el último código útil, así el error
+// relativo es el mismo en toda la escala (y las entradas 1 son exactas).
+// 0 y NAN tienen códigos propios.
+void TablaProbabilidad::compactar(Precision p){
+    if(p==precision) return;
+    std::vector<double> d(num_datos());
+    for(size_t i=0;i<d.size();++i) d[i] = dato(i);
+    datos_simple.clear();
+    datos_log16.clear();
+    datos.clear();
+    paso_log = 0;
+    precision = p;
+
+    switch(p){
+    case Precision::Doble:
+        datos = std::move(d);
+        break;
+    case Precision::Simple:
+        datos_simple = std::vector<float>(d.begin(), d.end());
+        break;
+    case Precision::Log16:{
+        const double max_codigo = LOG16_NAN-1;
+        double mayor = 0; // mayor -ln p entre las entradas positivas
+        for(double x: d) 
+            if(x>0 && !std::isnan(x)) mayor = std::max(mayor, -std::log(x));
+        paso_log = mayor/max_codigo; // 0 si solo hay ceros y unos: exacta
+        std::vector<uint16_t> c(d.size());
+        for(size_t i=0;i<d.size();++i){
+            const double x = d[i];
+            if(std::isnan(x)) c[i] = LOG16_NAN;
+            else if(x<=0) c[i] = LOG16_CERO;
+            else c[i] = (uint16_t)std::min(max_codigo, std::round(-std::log(x)/paso_log));
+        }
+        datos_log16 = std::move(c);
+        break;
+    }
+    }
+}
+
+size_t TablaProbabilidad::bytes_parametros(std::unordered_set<const void*>* vistos) const{
+    auto contar = [&](const void* p, size_t bytes) -> size_t {
+        return (!p || (vistos && !vistos->insert(p).second))? 0 : bytes;
+    };
+    size_t n = contar(datos.data(), datos.size()*sizeof(double))
+             + contar(datos_simple.data(), datos_simple.size()*sizeof(float))
+             + contar(datos_log16.data(), datos_log16.size()*sizeof(uint16_t))
+             + (defecto.size()+fuga.size())*sizeof(double);
+    for(const auto& a: acumuladas) n += a.size()*sizeof(double);
+    return n;
+}
+
+double TablaProbabilidad::cota_error_relativo() const{
+    switch(precision){
+    case Precision::Simple: return std::ldexp(1.0, -24);
+    case Precision::Log16:  return std::expm1(paso_log/2);
+    default:                return 0.0;
+    }
+}
+
+// instancia la evidencia en la tabla: devuelve la subtabla densa que
+// corresponde a los valores observados, indexada solo por las variables
+// libres. Se hace una vez por consulta, así el bucle interno de la
+// inferencia nunca vuelve a mirar la evidencia y trabaja sobre tablas
+// más pequeñas.
+std::vector<double> TablaProbabilidad::reducir(const std::vector<int>& ev_padres, int ev_var) const{
+    const size_t r = variable->valores.size();
+    double entradas = ev_var<0? (double)r : 1.0;
+    for(size_t k=0;k<padres.size();++k) if(ev_padres[k]<0) entradas *= (double)padres[k]->valores.size();
+    if(entradas > MAX_ENTRADAS_DENSAS){
+        std::ostringstream os;
+        os << "La CPT de "<<variable->nombre<<" reducida por la evidencia necesita "<<entradas
+           << " entradas (máximo "<<MAX_ENTRADAS_DENSAS<<")";
+        throw std::runtime_error(os.str());
+    }
+    
+    // paso (stride) de cada padre en el índice de fila completo
+    std::vector<size_t> paso(padres.size(), 1);
+    for(size_t k=padres.size(); k-- > 1; ) 
+        paso[k-1] = paso[k]*padres[k]->valores.size();
+    
+    // fila base fijada por los padres observados y lista de padres libres
+    size_t base = 0, tam = (ev_var<0)? r : 1;
+    std::vector<size_t> libres;
+    for(size_t k=0;k<padres.size();++k){
+        if(ev_padres[k]>=0) base += (size_t)ev_padres[k]*paso[k];
+        else { libres.push_back(k); tam *= padres[k]->valores.size(); }
+    }
+    
+    std::vector<double> res; 
+    res.reserve(tam);
+    std::vector<size_t> idx(libres.size(), 0);
+    for(bool fin=false; !fin; ){
+        size_t fila = base;
+        for(size_t l=0;l<libres.size();++l) fila += idx[l]*paso[libres[l]];
+        
+        // copiamos la fila completa (variable libre) o solo el valor observado
+        size_t j0 = ev_var<0? 0 : (size_t)ev_var, j1 = ev_var<0? r : (size_t)ev_var+1;
+        for(size_t j=j0; j<j1; ++j){
+            double v = prob(fila, j);
+            if(std::isnan(v)) 
+                throw std::runtime_error("Fila CPT no encontrada para " + variable->nombre);
+            res.push_back(v);
+        }
+        
+        // odómetro sobre los padres libres: termina al dar la vuelta completa
+        fin = true;
+        for(size_t l=libres.size(); l-- > 0; ){
+            if(++idx[l] < padres[libres[l]]->valores.size()){ fin = false; break; }
+            idx[l] = 0;
+        }
+    }
+    return res;
+}
+
+// instancia la evidencia aprovechando la estructura del modelo local.
+// En noisy-OR/MAX, P(Y=primer valor | pa) = fuga(0) * Π_k C_k(0 | pa_k) es
+// un producto de funciones de un solo padre: con esa evidencia (hallazgo
+// negativo) el factor se parte en un factor unario por padre libre y una
+// constante, y la inferencia nunca construye la tabla sobre todos los
+// padres. En el resto de casos se devuelve la tabla reducida completa.
+std::vector<TablaProbabilidad::FactorLocal> TablaProbabilidad::factorizar(
+    const std::vector<int>& ev_padres, int ev_var, bool auxiliar) const{
+    
+    std::vector<FactorLocal> res;
+    const bool noisy = (tipo==Tipo::NoisyOr || tipo==Tipo::NoisyMax);
+    if(noisy && auxiliar){
+        // tamaño de la tabla reducida frente al de la descomposición
+        const double c = (double)columnas;
+        double densa = ev_var<0? c : 1.0, descompuesta = c + (ev_var<0? c*c : c);
+        for(size_t k=0;k<padres.size();++k){
+            if(ev_padres[k]>=0) continue;
+            densa *= (double)cards[k];
+            descompuesta += (double)cards[k]*c;
+        }
+        if(densa > descompuesta){
+            FactorLocal base;
+            base.con_auxiliar = true;
+            base.valores = fuga;
+            for(size_t k=0;k<padres.size();++k){
+                const std::vector<double>& a = acumuladas[k];
+                if(ev_padres[k]>=0){
+                    for(size_t y=0;y<columnas;++y) base.valores[y] *= a[(size_t)ev_padres[k]*columnas+y];
+                    continue;
+                }
+                // C_k(pa_k, Y'): la fila 0 (padre inactivo) vale 1
+                FactorLocal f;
+                f.padres_libres.push_back(k);
+                f.con_auxiliar = true;
+                f.valores = a;
+                res.push_back(std::move(f));
+            }
+            res.push_back(std::move(base));
+            FactorLocal d;
+            d.con_variable = (ev_var<0);
+            d.con_auxiliar = true;
+            const size_t y0 = ev_var<0? 0 : (size_t)ev_var, y1 = ev_var<0? columnas : y0+1;
+            d.valores.assign((y1-y0)*columnas, 0.0);
+            for(size_t y=y0; y<y1; ++y){
+                double* fila = &d.valores[(y-y0)*columnas];
+                fila[y] = 1.0;
+                if(y>0) fila[y-1] = -1.0;
+            }
+            res.push_back(std::move(d));
+            return res;
+        }
+    }
+    if(noisy && !auxiliar && ev_var==0){
+        FactorLocal cte;
+        cte.valores.push_back(fuga[0]);
+        for(size_t k=0;k<padres.size();++k){
+            const std::vector<double>& c = acumuladas[k];
+            // padre observado: su término entra en la constante
+            if(ev_padres[k]>=0){
+                cte.valores[0] *= c[(size_t)ev_padres[k]*columnas];
+                continue;
+            }
+            FactorLocal f;
+            f.padres_libres.push_back(k);
+            f.valores.resize(cards[k]);
+            for(size_t j=0;j<cards[k];++j) f.valores[j] = c[j*columnas];
+            res.push_back(std::move(f));
+        }
+        res.push_back(std::move(cte));
+        return res;
+    }
+    
+    FactorLocal f;
+    for(size_t k=0;k<padres.size();++k) 
+        if(ev_padres[k]<0) f.padres_libres.push_back(k);
+    f.con_variable = (ev_var<0);
+    f.valores = reducir(ev_padres, ev_var);
+    res.push_back(std::move(f));
+    return res;
 }
 
 // consulta la probabilidad condicional P(variable=valor | padres=valores_padres)
@@ -80,41 +552,37 @@ double TablaProbabilidad::condicionada(
     const std::unordered_map<std::string,std::string>& evidencia,
     const std::string& valor) const{
     
-    // construimos el vector de asignaciones que servirá como clave de búsqueda
-    // primero incluimos las asignaciones de los padres, luego la de la variable
-    std::vector<std::pair<std::string,std::string>> asignaciones;
-    // reservamos espacio: necesitamos espacio para todos los padres + 1 (la variable)
-    asignaciones.reserve(padres.size()+1);
+    // posición de un valor dentro de un dominio (npos si no pertenece)
+    auto posicion = [](const std::vector<std::string>& dom, const std::string& v){
+        for(size_t i=0;i<dom.size();++i) if(dom[i]==v) return i;
+        return std::string::npos;
+    };
     
-    // extraemos el valor de cada padre desde el mapa de evidencia
+    // calculamos el índice de fila a partir de los valores de los padres
+    size_t fila = 0;
     for(Nodo* p: padres){
         // buscamos el valor del padre en la evidencia
         auto it = evidencia.find(p->nombre);
         
         // si falta algún padre en la evidencia, no podemos calcular la probabilidad
-        // esto es un error porque necesitamos conocer todos los padres para
-        // hacer la consulta condicional
         if(it==evidencia.end()) 
             throw std::runtime_error("Evidencia incompleta: falta " + p->nombre);
         
-        // agregamos el par (nombre_padre, valor_padre) a las asignaciones
-        asignaciones.push_back({p->nombre, it->second});
+        size_t k = posicion(p->valores, it->second);
+        if(k==std::string::npos) 
+            throw std::runtime_error("Fila CPT no encontrada para " + variable->nombre);
+        fila = fila*p->valores.size() + k;
     }
     
-    // agregamos la asignación de la variable objetivo con el valor consultado
-    asignaciones.push_back({variable->nombre, valor});
-    
-    // buscamos en la tabla usando la clave empaquetada
-    // la clave codifica toda la combinación de valores: padres + variable
-    auto it = tabla.find(empaquetar_clave(asignaciones));
+    // columna: índice del valor consultado de la variable
+    size_t j = posicion(variable->valores, valor);
     
-    // si no encontramos la entrada, significa que esa combinación
-    // no fue definida en el archivo de CPTs, lo cual es un error
-    if(it==tabla.end()) 
+    // si la combinación no fue definida en el archivo de CPTs es un error
+    if(j==std::string::npos || std::isnan(prob(fila, j))) 
         throw std::runtime_error("Fila CPT no encontrada para " + variable->nombre);
     
     // retornamos la probabilidad almacenada para esta combinación
-    return it->second;
+    return prob(fila, j);
 }
 
 // imprime la tabla de probabilidad condicional en formato legible
@@ -143,6 +611,75 @@ void TablaProbabilidad::imprimir(std::ostream& os) const{
     }
     os << "\n";
 
+    // las representaciones compactas se imprimen tal como se definen, sin
+    // recorrer todas las combinaciones de padres
+    if(tipo!=Tipo::Tabla){
+        const size_t r = columnas;
+        auto fila = [&](const double* p){
+            for(size_t j=0;j<r;++j){ if(j) os << " "; os << p[j]; }
+            os << "\n";
+        };
+        // fila f de `datos`, decodificada si está compactada
+        auto fila_datos = [&](size_t f){
+            std::vector<double> d(r);
+            for(size_t j=0;j<r;++j) d[j] = dato(f*r+j);
+            fila(d.data());
+        };
+        const char* nombres[] = {"tabla", "tabla con fila por defecto", "árbol de contextos", "noisy-OR", "noisy-MAX"};
+        os << "Representación: " << nombres[(int)tipo] << " (" << num_parametros() 
+           << " parámetros para " << filas << " filas)\n";
+        
+        if(tipo==Tipo::PorDefecto){
+            // filas explícitas en orden de índice, decodificando los padres
+            std::vector<std::pair<size_t,size_t>> orden(filas_explicitas.begin(), filas_explicitas.end());
+            std::sort(orden.begin(), orden.end());
+            for(const auto& fe: orden){
+                std::vector<size_t> idx(cards.size());
+                size_t f = fe.first;
+                for(size_t k=cards.size(); k-- > 0; ){ idx[k] = f%cards[k]; f /= cards[k]; }
+                os << " ";
+                for(size_t k=0;k<idx.size();++k) 
+                    os << (k?",":"") << padres[k]->nombre << "=" << padres[k]->valores[idx[k]];
+                os << " : ";
+                fila_datos(fe.second);
+            }
+        }
+        else if(tipo==Tipo::Arbol){
+            for(const Regla& g: reglas){
+                os << " ";
+                if(g.contexto.empty()) os << "*";
+                for(size_t k=0;k<g.contexto.size();++k){
+                    const Nodo* p = padres[g.contexto[k].first];
+                    os << (k?",":"") << p->nombre << "=" << p->valores[g.contexto[k].second];
+                }
+                os << " : ";
+                fila_datos(g.fila);
+            }
+        }
+        else{
+            // NOISY: distribución de cada valor activo (diferencias de la acumulada)
+            auto dist = [&](const double* c){
+                std::vector<double> d(r);
+                for(size_t y=0;y<r;++y) d[y] = c[y] - (y? c[y-1] : 0.0);
+                return d;
+            };
+            for(size_t k=0;k<padres.size();++k){
+                for(size_t j=1;j<cards[k];++j){
+                    std::vector<double> d = dist(&acumuladas[k][j*r]);
+                    os << " " << padres[k]->nombre << "=" << padres[k]->valores[j] << " : ";
+                    if(tipo==Tipo::NoisyOr) os << d[1] << "\n";
+                    else fila(d.data());
+                }
+            }
+            std::vector<double> d = dist(fuga.data());
+            os << " <fuga> : ";
+            if(tipo==Tipo::NoisyOr) os << d[1] << "\n";
+            else fila(d.data());
+        }
+        if(!defecto.empty()){ os << " <defecto> : "; fila(defecto.data()); }
+        return;
+    }
+
     // generamos todas las combinaciones posibles de valores de padres
     // para imprimirlas en orden sistemático
     // cada padre tiene un dominio (conjunto de valores posibles)
@@ -157,7 +694,8 @@ void TablaProbabilidad::imprimir(std::ostream& os) const{
     
     // función lambda recursiva que genera todas las combinaciones usando backtracking
     // i: índice del padre actual que estamos asignando
-    std::function<void(size_t)> bt = [&](size_t i){
+    // fila: índice de fila en la tabla densa acumulado hasta el padre i
+    std::function<void(size_t,size_t)> bt = [&](size_t i, size_t fila){
         // caso base: si ya asignamos todos los padres
         if(i==padres.size()){
             // imprimimos la combinación actual de valores de padres
@@ -178,16 +716,9 @@ void TablaProbabilidad::imprimir(std::ostream& os) const{
             // para esta combinación de padres, imprimimos las probabilidades
             // de cada valor posible de la variable
             for(size_t j=0;j<variable->valores.size();++j){
-                // construimos la clave completa: asignaciones_padres + variable=valor_j
-                auto todo = asign; 
-                todo.push_back({variable->nombre, variable->valores[j]});
-                
-                // empaquetamos la clave y buscamos en la tabla
-                std::string clave = empaquetar_clave(todo);
-                
-                // obtenemos la probabilidad si existe, sino usamos NAN (Not A Number)
-                // NAN indica que esa entrada no fue definida en la tabla
-                double p = tabla.count(clave)? tabla.at(clave): NAN;
+                // leemos la entrada de la tabla densa; NAN (Not A Number)
+                // indica que esa entrada no fue definida en el archivo
+                double p = prob(fila, j);
                 
                 // imprimimos la probabilidad separada por espacios
                 if(j) os << " ";
@@ -199,11 +730,11 @@ void TablaProbabilidad::imprimir(std::ostream& os) const{
         
         // caso recursivo: probamos cada valor posible del padre i
         // esto genera todas las combinaciones mediante backtracking
-        for(const std::string& v : dominios[i]){ 
+        for(size_t k=0;k<dominios[i].size();++k){ 
             // agregamos la asignación padre_i = v
-            asign.push_back({padres[i]->nombre, v}); 
+            asign.push_back({padres[i]->nombre, dominios[i][k]}); 
             // recursión: procesamos el siguiente padre
-            bt(i+1); 
+            bt(i+1, fila*dominios[i].size()+k); 
             // backtrack: removemos la asignación para probar el siguiente valor
             asign.pop_back(); 
         }
@@ -211,5 +742,5 @@ void TablaProbabilidad::imprimir(std::ostream& os) const{
     
     // iniciamos el backtracking desde el padre 0
     // esto generará e imprimirá todas las combinaciones posibles
-    bt(0);
+    bt(0, 0);
 }
\ No newline at end of file
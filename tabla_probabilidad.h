@@ -1,25 +1,183 @@
 #ifndef TABLA_PROBABILIDAD_H
 #define TABLA_PROBABILIDAD_H
+#include "compartido.h"
+#include <cstdint>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <utility>
 #include <ostream>
+#include <unordered_set>
 
 struct Nodo;
 
+// Modelo local P(variable | padres). Todas las representaciones comparten
+// la misma interfaz: prob(fila, valor) con la fila indexada por la
+// combinación de padres (el primer padre es el más significativo).
+//  - Tabla:      tabla densa completa (filas x columnas).
+//  - PorDefecto: solo las filas escritas en el archivo más una fila por
+//                defecto para todas las demás combinaciones.
+//  - Arbol:      reglas con contexto parcial (Padre=valor,...) que se
+//                prueban en orden; la primera que coincide da la fila.
+//  - NoisyOr / NoisyMax: un parámetro por padre activo y una fuga. El
+//                primer valor de cada variable es el estado "inactivo"
+//                y los valores del hijo se consideran ordenados (grados).
+// Las representaciones compactas no materializan la tabla: prob() la
+// calcula al vuelo, con memoria lineal en el número de padres.
 struct TablaProbabilidad{
+    enum class Tipo{ Tabla, PorDefecto, Arbol, NoisyOr, NoisyMax };
+    // Cómo se guardan las entradas de `datos` (ver compactar()):
+    //  - Doble:   double, sin pérdida.
+    //  - Simple:  float; error relativo <= 2^-24 por entrada.
+    //  - Log16:   un código de 16 bits por entrada, p = exp(-código·paso_log),
+    //             con el paso ajustado al menor p>0 de la tabla; error
+    //             relativo <= exp(paso_log/2)-1 (ver cota_error_relativo()).
+    // La lectura siempre devuelve double y la inferencia acumula en double.
+    enum class Precision{ Doble, Simple, Log16 };
+
     Nodo* variable = nullptr;                 // variable objetivo
     std::vector<Nodo*> padres;                // orden de padres
-    std::unordered_map<std::string,double> tabla; // clave compacta (padres+var)
+    Tipo tipo = Tipo::Tabla;
+
+    // filas tal como se leen del archivo; finalizar() las convierte a la
+    // representación de `tipo` y las libera. En NOISY-OR/MAX el contexto
+    // es un solo padre (valor "*" = todos sus valores activos).
+    struct FilaCarga{
+        std::vector<std::pair<std::string,std::string>> contexto;
+        std::vector<double> probs;
+    };
+    std::vector<FilaCarga> carga;
+    std::vector<double> carga_defecto;        // DEFAULT: / LEAK:
+
+    // Tabla: datos densos, una fila por combinación de padres y una
+    // columna por valor (entradas no definidas en NAN).
+    // PorDefecto/Arbol: solo las filas explícitas, en orden de aparición.
+    // Los arreglos son inmutables e internados: las tablas con los mismos
+    // números (copias de una PLATE) comparten una sola copia.
+    ArregloCompartido<double> datos;
+    Precision precision = Precision::Doble;
+    ArregloCompartido<float> datos_simple;    // `datos` en Precision::Simple
+    ArregloCompartido<uint16_t> datos_log16;  // `datos` en Precision::Log16
+    double paso_log = 0;                      // Log16: p = exp(-código·paso_log)
+    static constexpr uint16_t LOG16_CERO = 0xFFFF, LOG16_NAN = 0xFFFE;
+    size_t columnas = 0;                      // número de valores de la variable
+    size_t filas = 0;                         // número de combinaciones de padres
+    std::vector<size_t> cards;                // cardinalidad de cada padre
+
+    std::unordered_map<size_t,size_t> filas_explicitas; // PorDefecto: fila -> fila en datos
+    std::vector<double> defecto;              // PorDefecto/Arbol: fila por defecto (vacía = NAN)
+    struct Regla{
+        std::vector<std::pair<size_t,size_t>> contexto; // (padre, índice de valor)
+        size_t fila;                                    // fila en datos
+        // el contexto en términos del índice de fila, para probarlo sin
+        // decodificar los padres: (fila/paso) % card == valor
+        struct Condicion{ size_t paso, card, valor; };
+        std::vector<Condicion> condiciones;
+    };
+    std::vector<Regla> reglas;                // Arbol
+    // NoisyOr/NoisyMax: distribución acumulada P(Y<=y) cuando solo el padre
+    // k toma su valor j: acumuladas[k][j*columnas+y] (j=0 no tiene efecto)
+    std::vector<std::vector<double>> acumuladas;
+    std::vector<double> fuga;                 // acumulada de la fuga (todos inactivos)
 
     void establecer(Nodo* var, const std::vector<Nodo*>& padres_);
     void agregar_fila(const std::vector<std::pair<std::string,std::string>>& asig_padres,
                       const std::vector<std::string>& valores_var,
                       const std::vector<double>& probabilidades);
+    // convierte `carga` en la representación de `tipo` (requiere los
+    // dominios de padres y variable)
+    void finalizar();
+    // Para las copias de una PLATE: ¿daría finalizar() lo mismo que en
+    // `otra` (sin finalizar todavía)? Mismo tipo, mismos dominios de la
+    // variable y de cada padre, y cada fila nombra los mismos padres (por
+    // posición) con los mismos valores y números.
+    bool misma_carga(const TablaProbabilidad& otra) const;
+    // toma la representación ya finalizada de `otra` (ver misma_carga):
+    // los arreglos internados se comparten sin volver a construirlos
+    void copiar_representacion(const TablaProbabilidad& otra);
+    // calcula Regla::condiciones a partir de `contexto` y `cards`
+    // (finalizar() y la carga binaria la llaman)
+    void preparar_reglas();
+    bool finalizada() const { return columnas>0; }
+    size_t num_filas() const { return filas; }
+    // Mayor tabla densa que se construye (la CPT completa o una reducción
+    // por la evidencia): por encima, los motores lanzan un error de tamaño
+    // en vez de reservarla.
+    static constexpr double MAX_ENTRADAS_DENSAS = double(1<<26);
+    // entradas de la tabla completa (filas × columnas), sin desbordar
+    double entradas_densas() const;
+    // lanza si la tabla completa supera MAX_ENTRADAS_DENSAS; `motor` va en el mensaje
+    void exigir_densa(const std::string& motor) const;
+    double prob(size_t fila, size_t valor) const {
+        return tipo==Tipo::Tabla && precision==Precision::Doble? datos[fila*columnas+valor] 
+                                                               : prob_compacta(fila, valor);
+    }
+    // número de parámetros almacenados (para comparar con filas*columnas)
+    size_t num_parametros() const;
+
+    // entrada i de `datos` decodificada, en cualquier precisión
+    double dato(size_t i) const {
+        switch(precision){
+        case Precision::Simple: return datos_simple[i];
+        case Precision::Log16:  return decodificar_log16(datos_log16[i]);
+        default:                return datos[i];
+        }
+    }
+    size_t num_datos() const;
+    // Recodifica `datos` en la precisión pedida y libera la copia anterior.
+    // Pasar de una precisión reducida a otra parte de los valores ya
+    // redondeados (los errores se acumulan); Doble solo vuelve a double.
+    void compactar(Precision p);
+    // bytes que ocupan los parámetros (datos, defecto, acumuladas, fuga).
+    // Con `vistos`, los arreglos compartidos ya contados en otra tabla no
+    // se vuelven a sumar (y se agregan al conjunto).
+    size_t bytes_parametros(std::unordered_set<const void*>* vistos = nullptr) const;
+    // cota del error relativo por entrada de la precisión actual (0 = exacta)
+    double cota_error_relativo() const;
+    double decodificar_log16(uint16_t c) const;
+    // Instancia la evidencia en la tabla. `ev_padres[k]` es el índice del
+    // valor observado del padre k (o -1) y `ev_var` el de la variable.
+    // Devuelve la tabla densa sobre las variables no observadas, en el
+    // mismo orden (padres libres y luego la variable si está libre).
+    std::vector<double> reducir(const std::vector<int>& ev_padres, int ev_var) const;
+
+    // Factor resultante de instanciar la evidencia: tabla densa sobre los
+    // padres `padres_libres` (índices en `padres`), la variable si
+    // `con_variable` y la variable auxiliar Y' si `con_auxiliar`, en ese
+    // orden. Y' tiene los mismos valores que la variable.
+    struct FactorLocal{
+        std::vector<size_t> padres_libres;
+        bool con_variable = false;
+        bool con_auxiliar = false;
+        std::vector<double> valores;
+    };
+    // Como reducir(), pero aprovecha la estructura del modelo: un
+    // noisy-OR/MAX con el hijo observado en su primer valor se factoriza
+    // en un factor unario por padre libre (más una constante), en lugar
+    // de una tabla exponencial en el número de padres.
+    //
+    // Con `auxiliar`, un noisy-OR/MAX se descompone con cualquier evidencia
+    // por diferencias acumuladas:
+    //   P(Y=y | pa) = Σ_y' Δ(y, y')·fuga(y')·Π_k C_k(y' | pa_k)
+    // con Δ(y, y') = 1 si y'=y, -1 si y'=y-1 y 0 si no. Quedan un factor
+    // C_k(pa_k, Y') por padre libre, la fuga (con los padres observados) y
+    // Δ(Y, Y'): tamaño lineal en el número de padres. El producto de los
+    // factores sumado sobre Y' es la tabla reducida. Solo se descompone
+    // cuando la tabla reducida sería mayor, y la forma de los factores
+    // depende de qué está observado, no de los valores (un plan compilado
+    // para un patrón sirve para todas sus consultas). Los factores pueden
+    // tener entradas negativas.
+    std::vector<FactorLocal> factorizar(const std::vector<int>& ev_padres, int ev_var,
+                                        bool auxiliar = false) const;
+
     double condicionada(const std::unordered_map<std::string,std::string>& evidencia,
                         const std::string& valor) const; // P(var=valor | padres)
     void imprimir(std::ostream& os) const;
+
+private:
+    double prob_compacta(size_t fila, size_t valor) const;
+    size_t indice_padre(const std::string& nombre) const;
+    size_t indice_valor(const Nodo* X, const std::string& valor) const;
 };
 
-#endif // TABLA_PROBABILIDAD_H
\ No newline at end of file
+#endif // TABLA_PROBABILIDAD_H
@@ -1,5 +1,6 @@
 #include "util.h"
 #include <algorithm>
+#include <stdexcept>
 
 std::string recortar(const std::string& s){
     size_t a = s.find_first_not_of(" \t\r\n");
@@ -22,4 +23,79 @@ std::string empaquetar_clave(const std::vector<std::pair<std::string,std::string
     std::sort(tmp.begin(), tmp.end());
     std::string res; for(size_t i=0;i<tmp.size();++i){ if(i) res+=","; res+=tmp[i]; }
     return res;
-}
\ No newline at end of file
+}
+
+bool LectorPlantillas::leer(std::string& linea, int& ln){
+    if(!pendientes_.empty()){
+        ln = pendientes_.front().first;
+        linea = std::move(pendientes_.front().second);
+        pendientes_.pop_front();
+        return true;
+    }
+    if(!in_ || !std::getline(*in_, linea)) return false;
+    ln = ++ln_;
+    linea = recortar(linea);
+    return true;
+}
+
+std::string Plantilla::instanciar(const std::string& s, long k) const{
+    const std::string marca = "["+var+"]", indice = "["+std::to_string(k)+"]";
+    std::string r = s;
+    for(size_t p = r.find(marca); p!=std::string::npos; p = r.find(marca, p+indice.size()))
+        r.replace(p, marca.size(), indice);
+    return r;
+}
+
+bool LectorPlantillas::siguiente(std::string& linea, int& ln, Plantilla* sin_expandir){
+    while(leer(linea, ln)){
+        if(linea=="ENDPLATE")
+            throw std::runtime_error("ENDPLATE sin PLATE en línea "+std::to_string(ln));
+        if(linea.rfind("PLATE ",0)!=0) return true;
+
+        // "PLATE i = a..b"
+        Plantilla pl;
+        const int ln_plate = pl.ln = ln;
+        auto error = [&]{ return std::runtime_error("Formato inválido de PLATE en línea "+std::to_string(ln_plate)+
+                                                    " (se espera PLATE i = 1..N): "+linea); };
+        auto eq = linea.find('='), puntos = linea.find("..");
+        if(eq==std::string::npos || puntos==std::string::npos || puntos<eq) throw error();
+        pl.var = recortar(linea.substr(6, eq-6));
+        try{
+            pl.desde = std::stol(recortar(linea.substr(eq+1, puntos-eq-1)));
+            pl.hasta = std::stol(recortar(linea.substr(puntos+2)));
+        }catch(const std::exception&){ throw error(); }
+        if(pl.var.empty() || pl.var.find_first_of(" \t[]")!=std::string::npos) throw error();
+        if(pl.hasta<pl.desde)
+            throw std::runtime_error("PLATE vacía en línea "+std::to_string(ln_plate)+": "+
+                                     std::to_string(pl.desde)+".."+std::to_string(pl.hasta));
+        // resta sin signo: hasta >= desde, así que no desborda
+        if((unsigned long)pl.hasta-(unsigned long)pl.desde >= (unsigned long)MAX_COPIAS_PLANTILLA)
+            throw std::runtime_error("PLATE con más de "+std::to_string(MAX_COPIAS_PLANTILLA)+
+                                     " copias en línea "+std::to_string(ln_plate));
+
+        // el cuerpo llega hasta su ENDPLATE (las plantillas internas se
+        // copian tal cual y se expanden al volver a leerlas)
+        for(int nivel = 1;;){
+            std::string l;
+            int n = 0;
+            if(!leer(l, n)) throw std::runtime_error("PLATE sin ENDPLATE en línea "+std::to_string(ln_plate));
+            if(l.rfind("PLATE ",0)==0) ++nivel;
+            else if(l=="ENDPLATE" && --nivel==0) break;
+            pl.cuerpo.push_back({n, std::move(l)});
+        }
+        if(sin_expandir){
+            ln = ln_plate;
+            *sin_expandir = std::move(pl);
+            return true;
+        }
+        copias_ += pl.num_copias();
+        if(copias_>MAX_COPIAS_PLANTILLA)
+            throw std::runtime_error("Más de "+std::to_string(MAX_COPIAS_PLANTILLA)+
+                                     " copias de PLATE en total, en línea "+std::to_string(ln_plate));
+        std::vector<std::pair<int,std::string>> copias;
+        for(long k=pl.desde; k<=pl.hasta; ++k)
+            for(const auto& c: pl.cuerpo) copias.push_back({c.first, pl.instanciar(c.second, k)});
+        pendientes_.insert(pendientes_.begin(), copias.begin(), copias.end());
+    }
+    return false;
+}
@@ -1,5 +1,7 @@
 #ifndef UTIL_H
 #define UTIL_H
+#include <deque>
+#include <istream>
 #include <string>
 #include <vector>
 #include <utility>
@@ -8,4 +10,49 @@ std::string recortar(const std::string& s);
 std::vector<std::string> dividir(const std::string& s, char sep);
 std::string empaquetar_clave(const std::vector<std::pair<std::string,std::string>>& asignaciones);
 
+// Plantilla de subred repetida:
+//   PLATE i = 1..N
+//   Estacion -> Sensor[i]
+//   ENDPLATE
+// El cuerpo se guarda tal cual (con sus PLATE internas) junto con la
+// línea del archivo de cada renglón.
+struct Plantilla{
+    std::string var;
+    long desde = 0, hasta = 0;
+    int ln = 0;                                      // línea del PLATE
+    std::vector<std::pair<int,std::string>> cuerpo;
+    // `s` con cada "[var]" cambiado por "[k]"
+    std::string instanciar(const std::string& s, long k) const;
+    long num_copias() const { return hasta-desde+1; }
+};
+
+// Tope de copias de PLATE por archivo, contando las anidadas (una PLATE
+// de 1..1000 con otra de 1..1000 dentro son 1000 + 1000·1000). Un rango
+// mayor es casi siempre una errata y la expansión no terminaría.
+constexpr long MAX_COPIAS_PLANTILLA = 1000000;
+
+// Lee las líneas (recortadas) de estructura.txt o cpts.txt y expande las
+// plantillas: repite el cuerpo para i = 1..N cambiando cada "[i]" por
+// "[1]", "[2]"... Las plantillas se pueden anidar (Lectura[i][j]); `ln`
+// es la línea del archivo de donde viene cada línea expandida, para los
+// mensajes de error.
+class LectorPlantillas{
+public:
+    explicit LectorPlantillas(std::istream& in): in_(&in) {}
+    // lee el cuerpo de una plantilla (con las líneas originales)
+    explicit LectorPlantillas(const std::vector<std::pair<int,std::string>>& lineas)
+        : pendientes_(lineas.begin(), lineas.end()) {}
+    // Con `sin_expandir`, una PLATE no se expande: se devuelve su cabecera
+    // en `linea` y la plantilla en *sin_expandir, para quien sepa
+    // instanciar el cuerpo sin volver a leerlo como texto.
+    bool siguiente(std::string& linea, int& ln, Plantilla* sin_expandir = nullptr);
+
+private:
+    std::istream* in_ = nullptr;
+    int ln_ = 0;
+    long long copias_ = 0;                              // copias expandidas (ver MAX_COPIAS_PLANTILLA)
+    std::deque<std::pair<int,std::string>> pendientes_; // copias ya expandidas
+    bool leer(std::string& linea, int& ln);
+};
+
 #endif // UTIL_H
\ No newline at end of file